@@ -0,0 +1,28 @@
+#
+# - Find LuaJIT library and headers
+# This module defines the following variables:
+#
+# LUAJIT_FOUND        - true if LuaJIT was found
+# LUAJIT_INCLUDE_DIR  - include search path
+# LUAJIT_LIBRARIES    - libraries to link with
+
+find_path(LUAJIT_INCLUDE_DIR
+  NAMES luajit.h
+  HINTS
+    $ENV{LUAJIT_DIR}
+  PATH_SUFFIXES include/luajit-2.1 include/luajit-2.0 include/luajit include
+)
+
+find_library(LUAJIT_LIBRARIES
+  NAMES luajit-5.1 luajit lua51
+  HINTS
+    $ENV{LUAJIT_DIR}
+  PATH_SUFFIXES lib
+)
+
+# handle the QUIET and REQUIRED arguments and set LUAJIT_FOUND to TRUE if
+# all listed variables are true
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(LuaJIT DEFAULT_MSG LUAJIT_LIBRARIES LUAJIT_INCLUDE_DIR)
+
+mark_as_advanced(LUAJIT_INCLUDE_DIR LUAJIT_LIBRARIES)
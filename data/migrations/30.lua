@@ -1,3 +1,13 @@
 function onUpdateDatabase()
-	return false
+	print("> Updating database to version 30 (tile_store rows keyed by tile)")
+	db.query("ALTER TABLE `tile_store` ADD `tile_id` bigint(20) unsigned NOT NULL DEFAULT '0'")
+	-- the data of a row starts with the tile position: x (uint16), y (uint16), z (uint8)
+	db.query("UPDATE `tile_store` SET `tile_id` = \z
+			ASCII(SUBSTRING(`data`, 1, 1)) | \z
+			(ASCII(SUBSTRING(`data`, 2, 1)) << 8) | \z
+			(ASCII(SUBSTRING(`data`, 3, 1)) << 16) | \z
+			(ASCII(SUBSTRING(`data`, 4, 1)) << 24) | \z
+			(ASCII(SUBSTRING(`data`, 5, 1)) << 32)")
+	db.query("ALTER TABLE `tile_store` ADD UNIQUE KEY `tile_id` (`tile_id`)")
+	return true
 end
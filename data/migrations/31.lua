@@ -0,0 +1,14 @@
+function onUpdateDatabase()
+	print("> Updating database to version 31 (tile_store quarantine)")
+	-- rows of tile_store whose position is no longer a house tile are moved here when the map is loaded
+	db.query([[
+		CREATE TABLE IF NOT EXISTS `tile_store_quarantine` (
+			`house_id` int(11) NOT NULL,
+			`tile_id` bigint(20) unsigned NOT NULL,
+			`data` longblob NOT NULL,
+			`time` bigint(20) NOT NULL DEFAULT '0',
+			KEY `tile_id` (`tile_id`)
+		) ENGINE=InnoDB DEFAULT CHARACTER SET=utf8;
+	]])
+	return true
+end
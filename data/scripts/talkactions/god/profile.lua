@@ -0,0 +1,31 @@
+local profile = TalkAction("/profile")
+
+function profile.onSay(player, words, param)
+	if not player:getGroup():getAccess() or player:getAccountType() < ACCOUNT_TYPE_GOD then
+		return true
+	end
+
+	logCommand(player, words, param)
+
+	param = param:lower()
+	if param == "start" or param == "lines" then
+		if Game.startLuaProfiler(param == "lines") then
+			player:sendTextMessage(MESSAGE_INFO_DESCR, "Lua profiler started.")
+		else
+			player:sendCancelMessage("Lua profiler is already running.")
+		end
+	elseif param == "stop" then
+		local name = Game.stopLuaProfiler()
+		if name then
+			player:sendTextMessage(MESSAGE_INFO_DESCR, string.format("Lua profiler stopped, results written to %s_*.", name))
+		else
+			player:sendCancelMessage("Lua profiler is not running.")
+		end
+	else
+		player:sendCancelMessage("Usage: /profile start, /profile lines or /profile stop.")
+	end
+	return false
+end
+
+profile:separator(" ")
+profile:register()
@@ -744,6 +744,9 @@ void Combat::doCombatArea(Creature* caster, const Position& pos, const AreaComba
 	SpectatorVector spectators;
 	g_game().map.getSpectators(spectators, pos, true, true, rangeX, rangeX, rangeY, rangeY);
 
+	//every hit of this cast reuses these spectators, health bars are sent once the whole area is resolved
+	g_game().beginCombatBatch(spectators, pos, rangeX, rangeY);
+
 	postCombatEffects(caster, pos, params);
 
 	for (Tile* tile : tileList) {
@@ -778,6 +781,8 @@ void Combat::doCombatArea(Creature* caster, const Position& pos, const AreaComba
 			}
 		}
 	}
+
+	g_game().endCombatBatch();
 }
 
 void Combat::executeTargetCombat(Creature* caster, Creature* target) const
@@ -889,8 +894,7 @@ void ValueCallback::getMinMaxValues(Player* player, CombatDamage& damage, bool u
 
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	int parameters = 1;
 	switch (type) {
@@ -1048,41 +1052,58 @@ AreaCombat::AreaCombat(const AreaCombat& rhs)
 		} else {
 			areas[i].clear();
 		}
+		offsets[i] = rhs.offsets[i];
 	}
 }
 
 void AreaCombat::getList(const Position& centerPos, const Position& targetPos, std::vector<Tile*>& list) const
 {
-	const MatrixArea* area = getArea(centerPos, targetPos);
-	if (!area) {
+	const std::vector<AreaOffset>& areaOffsets = offsets[getDirection(centerPos, targetPos)];
+	if (areaOffsets.empty()) {
 		return;
 	}
-	
+
+	list.reserve(list.size() + areaOffsets.size());
+
+	for (const AreaOffset& offset : areaOffsets) {
+		Position tmpPos(targetPos.x + offset.x, targetPos.y + offset.y, targetPos.z);
+		if (g_game().isSightClear(targetPos, tmpPos, true)) {
+			Tile* tile = g_game().map.getTile(tmpPos);
+			if (!tile) {
+				tile = new StaticTile(tmpPos.x, tmpPos.y, tmpPos.z);
+				g_game().map.setTile(tmpPos, tile);
+			}
+			list.push_back(tile);
+		}
+	}
+}
+
+void AreaCombat::compileArea(Direction dir)
+{
+	std::vector<AreaOffset>& areaOffsets = offsets[dir];
+	areaOffsets.clear();
+
+	const MatrixArea& area = areas[dir];
+	if (!area.isInitialized()) {
+		areaOffsets.shrink_to_fit();
+		return;
+	}
+
 	uint32_t centerY, centerX;
-	area->getCenter(centerY, centerX);
-
-	uint32_t rows = area->getRows();
-	uint32_t cols = area->getCols();
-	list.reserve(static_cast<size_t>(rows * cols));
-
-	Position tmpPos(targetPos.x - centerX, targetPos.y - centerY, targetPos.z);
-	for (uint32_t y = 0; y < rows; ++y) {
-		for (uint32_t x = 0; x < cols; ++x) {
-			if (area->getValue(y, x) != 0) {
-				if (g_game().isSightClear(targetPos, tmpPos, true)) {
-					Tile* tile = g_game().map.getTile(tmpPos);
-					if (!tile) {
-						tile = new StaticTile(tmpPos.x, tmpPos.y, tmpPos.z);
-						g_game().map.setTile(tmpPos, tile);
-					}
-					list.push_back(tile);
-				}
+	area.getCenter(centerY, centerX);
+
+	// walk the matrix row by row once, so casts only visit the active cells in the same order
+	for (uint32_t y = 0; y < area.getRows(); ++y) {
+		for (uint32_t x = 0; x < area.getCols(); ++x) {
+			if (area.getValue(y, x)) {
+				areaOffsets.push_back({
+					static_cast<int16_t>(static_cast<int32_t>(x) - static_cast<int32_t>(centerX)),
+					static_cast<int16_t>(static_cast<int32_t>(y) - static_cast<int32_t>(centerY))
+				});
 			}
-			tmpPos.x++;
 		}
-		tmpPos.x -= cols;
-		tmpPos.y++;
 	}
+	areaOffsets.shrink_to_fit();
 }
 
 void AreaCombat::copyArea(const MatrixArea* input, MatrixArea* output, MatrixOperation_t op)
@@ -1238,6 +1259,11 @@ void AreaCombat::setupArea(const std::list<uint32_t>& list, uint32_t rows)
 	MatrixArea* westArea = &areas[DIRECTION_WEST];
 	westArea->setupArea(area->getCols(), area->getRows());
 	AreaCombat::copyArea(area, westArea, MATRIXOPERATION_ROTATE270);
+
+	compileArea(DIRECTION_NORTH);
+	compileArea(DIRECTION_SOUTH);
+	compileArea(DIRECTION_EAST);
+	compileArea(DIRECTION_WEST);
 }
 
 void AreaCombat::setupArea(int32_t length, int32_t spread)
@@ -1335,6 +1361,11 @@ void AreaCombat::setupExtArea(const std::list<uint32_t>& list, uint32_t rows)
 	MatrixArea* seArea = &areas[DIRECTION_SOUTHEAST];
 	seArea->setupArea(area->getRows(), area->getCols());
 	AreaCombat::copyArea(swArea, seArea, MATRIXOPERATION_MIRROR);
+
+	compileArea(DIRECTION_NORTHWEST);
+	compileArea(DIRECTION_NORTHEAST);
+	compileArea(DIRECTION_SOUTHWEST);
+	compileArea(DIRECTION_SOUTHEAST);
 }
 
 //**********************************************************//
@@ -163,6 +163,11 @@ class MatrixArea
 		uint32_t cols;
 };
 
+struct AreaOffset {
+	int16_t x;
+	int16_t y;
+};
+
 class AreaCombat
 {
 	public:
@@ -174,6 +179,9 @@ class AreaCombat
 		AreaCombat& operator=(const AreaCombat&) = delete;
 
 		void getList(const Position& centerPos, const Position& targetPos, std::vector<Tile*>& list) const;
+		const std::vector<AreaOffset>& getOffsets(Direction dir) const {
+			return offsets[dir];
+		}
 
 		void setupArea(const std::list<uint32_t>& list, uint32_t rows);
 		void setupArea(int32_t length, int32_t spread);
@@ -194,7 +202,7 @@ class AreaCombat
 		MatrixArea* createArea(Direction dir, const std::list<uint32_t>& list, uint32_t rows);
 		static void copyArea(const MatrixArea* input, MatrixArea* output, MatrixOperation_t op);
 
-		MatrixArea* getArea(const Position& centerPos, const Position& targetPos) const {
+		Direction getDirection(const Position& centerPos, const Position& targetPos) const {
 			int32_t dx = Position::getOffsetX(targetPos, centerPos);
 			int32_t dy = Position::getOffsetY(targetPos, centerPos);
 
@@ -220,15 +228,14 @@ class AreaCombat
 					dir = DIRECTION_SOUTHEAST;
 				}
 			}
-
-			const MatrixArea& area = areas[dir];
-			if (area.isInitialized()) {
-				return const_cast<MatrixArea*>(&area);
-			}
-			return nullptr;
+			return dir;
 		}
 
+		void compileArea(Direction dir);
+
 		MatrixArea areas[DIRECTION_LAST + 1];
+		// Active cells of each matrix relative to the target position, in client draw order
+		std::vector<AreaOffset> offsets[DIRECTION_LAST + 1];
 		bool hasExtArea = false;
 };
 
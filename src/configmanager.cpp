@@ -146,6 +146,9 @@ bool ConfigManager::load()
 	boolean[CLASSIC_EQUIPMENT_SLOTS] = getGlobalBoolean(L, "classicEquipmentSlots", false);
 	boolean[CLASSIC_ATTACK_SPEED] = getGlobalBoolean(L, "classicAttackSpeed", false);
 	boolean[SCRIPTS_CONSOLE_LOGS] = getGlobalBoolean(L, "showScriptsLogInConsole", true);
+	boolean[MAP_SNAPSHOT] = getGlobalBoolean(L, "useMapSnapshot", false);
+	boolean[LAZY_MAP_LOADING] = getGlobalBoolean(L, "lazyMapLoading", false);
+	boolean[LUA_BYTECODE_CACHE] = getGlobalBoolean(L, "luaBytecodeCache", true);
 
 	string[DEFAULT_PRIORITY] = getGlobalString(L, "defaultPriority", "high");
 	string[SERVER_NAME] = getGlobalString(L, "serverName", "");
@@ -185,6 +188,8 @@ bool ConfigManager::load()
 	integer[CHECK_EXPIRED_MARKET_OFFERS_EACH_MINUTES] = getGlobalNumber(L, "checkExpiredMarketOffersEachMinutes", 60);
 	integer[MAX_MARKET_OFFERS_AT_A_TIME_PER_PLAYER] = getGlobalNumber(L, "maxMarketOffersAtATimePerPlayer", 100);
 	integer[MAX_PACKETS_PER_SECOND] = getGlobalNumber(L, "maxPacketsPerSecond", 25);
+	integer[MAP_WARMUP_SECTORS] = getGlobalNumber(L, "mapWarmupSectors", 0);
+	integer[LUA_WORKER_THREADS] = getGlobalNumber(L, "luaWorkerThreads", 2);
 	#if GAME_FEATURE_STORE > 0
 	integer[STORE_COIN_PACKAGES] = getGlobalNumber(L, "storeCoinPackages", 25);
 	#endif
@@ -52,6 +52,9 @@ class ConfigManager
 			CLASSIC_EQUIPMENT_SLOTS,
 			CLASSIC_ATTACK_SPEED,
 			SCRIPTS_CONSOLE_LOGS,
+			MAP_SNAPSHOT,
+			LAZY_MAP_LOADING,
+			LUA_BYTECODE_CACHE,
 
 			LAST_BOOLEAN_CONFIG /* this must be the last one */
 		};
@@ -113,6 +116,8 @@ class ConfigManager
 			MAX_MARKET_OFFERS_AT_A_TIME_PER_PLAYER,
 			EXP_FROM_PLAYERS_LEVEL_RANGE,
 			MAX_PACKETS_PER_SECOND,
+			MAP_WARMUP_SECTORS,
+			LUA_WORKER_THREADS,
 			#if GAME_FEATURE_STORE > 0
 			STORE_COIN_PACKAGES,
 			#endif
@@ -117,40 +117,6 @@ Attr_ReadValue Container::readAttr(AttrTypes_t attr, PropStream& propStream)
 	return Item::readAttr(attr, propStream);
 }
 
-bool Container::unserializeItemNode(OTB::Loader& loader, const OTB::Node& node, PropStream& propStream, bool _legacy)
-{
-	bool ret = Item::unserializeItemNode(loader, node, propStream, _legacy);
-	if (!ret) {
-		return false;
-	}
-
-	for (auto& itemNode : node.children) {
-		//load container items
-		if (itemNode.type != OTBM_ITEM) {
-			// unknown type
-			return false;
-		}
-
-		PropStream itemPropStream;
-		if (!loader.getProps(itemNode, itemPropStream)) {
-			return false;
-		}
-
-		Item* item = (_legacy ? Item::CreateItem_legacy(itemPropStream) : Item::CreateItem(itemPropStream));
-		if (!item) {
-			return false;
-		}
-
-		if (!item->unserializeItemNode(loader, itemNode, itemPropStream, _legacy)) {
-			return false;
-		}
-
-		addItem(item);
-		updateItemWeight(item->getWeight());
-	}
-	return true;
-}
-
 void Container::updateItemWeight(int32_t diff)
 {
 	totalWeight += diff;
@@ -243,6 +209,8 @@ void Container::onAddContainerItem(Item* item)
 
 void Container::onUpdateContainerItem(uint32_t index, Item* oldItem, Item* newItem)
 {
+	notifyTileChanged();
+
 	SpectatorVector spectators;
 	g_game().map.getSpectators(spectators, getPosition(), false, true, 2, 2, 2, 2);
 
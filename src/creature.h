@@ -27,6 +27,7 @@
 #include "tile.h"
 #include "enums.h"
 #include "creatureevent.h"
+#include "creaturehandles.h"
 
 using ConditionList = std::vector<Condition*>;
 using CreatureEventList = std::vector<CreatureEvent*>;
@@ -151,6 +152,10 @@ class Creature : virtual public Thing
 		uint32_t getID() const {
 			return id;
 		}
+		//resolves through Game::getCreatureByHandle while the creature is in the game, 0 otherwise
+		CreatureHandle getHandle() const {
+			return handle;
+		}
 		virtual void removeList() = 0;
 		virtual void addList() = 0;
 
@@ -401,11 +406,10 @@ class Creature : virtual public Thing
 		virtual void onWalk();
 		virtual bool getNextStep(Direction& dir, uint32_t& flags);
 
-		void onAddTileItem(const Tile* tile, const Position& pos);
-		virtual void onUpdateTileItem(const Tile* tile, const Position& pos, const Item* oldItem,
-		                              const ItemType& oldType, const Item* newItem, const ItemType& newType);
-		virtual void onRemoveTileItem(const Tile* tile, const Position& pos, const ItemType& iType,
-		                              const Item* item);
+		virtual void onUpdateTileItem(const Tile*, const Position&, const Item*,
+		                              const ItemType&, const Item*, const ItemType&) {}
+		virtual void onRemoveTileItem(const Tile*, const Position&, const ItemType&,
+		                              const Item*) {}
 
 		virtual void onCreatureAppear(Creature* creature, bool isLogin);
 		virtual void onRemoveCreature(Creature* creature, bool isLogout);
@@ -489,6 +493,10 @@ class Creature : virtual public Thing
 		virtual bool useCacheMap() const {
 			return false;
 		}
+		//creatures with the same profile share the walk cache kept by the map sectors
+		virtual uint8_t getWalkProfile() const {
+			return 0;
+		}
 
 		struct CountBlock_t {
 			int32_t total;
@@ -518,6 +526,7 @@ class Creature : virtual public Thing
 		uint64_t eventWalk = 0;
 
 		uint64_t lastStep = 0;
+		CreatureHandle handle = 0;
 		uint32_t referenceCounter = 0;
 		uint32_t id = 0;
 		uint32_t scriptEventsBitField = 0;
@@ -543,7 +552,7 @@ class Creature : virtual public Thing
 		Direction direction = DIRECTION_SOUTH;
 		Skulls_t skull = SKULL_NONE;
 
-		bool localMapCache[mapWalkHeight][mapWalkWidth] = {{ false }};
+		uint8_t walkProfile = 0;
 		bool isInternalRemoved = false;
 		bool isMapLoaded = false;
 		bool isUpdatingPath = false;
@@ -570,8 +579,6 @@ class Creature : virtual public Thing
 		}
 
 		void updateMapCache();
-		void updateTileCache(const Tile* tile, int32_t dx, int32_t dy);
-		void updateTileCache(const Tile* tile, const Position& pos);
 		void onCreatureDisappear(const Creature* creature, bool isLogout);
 		virtual void doAttacking(uint32_t) {}
 		virtual bool hasExtraSwing() {
@@ -305,7 +305,7 @@ bool CreatureEvent::executeOnLogin(Player* player) const
 
 	scriptInterface->pushFunction(scriptId);
 	LuaScriptInterface::pushUserdata(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 	return scriptInterface->callFunction(1);
 }
 
@@ -324,7 +324,7 @@ bool CreatureEvent::executeOnLogout(Player* player) const
 
 	scriptInterface->pushFunction(scriptId);
 	LuaScriptInterface::pushUserdata(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 	return scriptInterface->callFunction(1);
 }
 
@@ -432,7 +432,7 @@ bool CreatureEvent::executeAdvance(Player* player, skills_t skill, uint32_t oldL
 
 	scriptInterface->pushFunction(scriptId);
 	LuaScriptInterface::pushUserdata(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 	lua_pushnumber(L, static_cast<uint32_t>(skill));
 	lua_pushnumber(L, oldLevel);
 	lua_pushnumber(L, newLevel);
@@ -476,7 +476,7 @@ void CreatureEvent::executeModalWindow(Player* player, uint32_t modalWindowId, u
 	scriptInterface->pushFunction(scriptId);
 
 	LuaScriptInterface::pushUserdata(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	lua_pushnumber(L, modalWindowId);
 	lua_pushnumber(L, buttonId);
@@ -500,7 +500,7 @@ bool CreatureEvent::executeTextEdit(Player* player, Item* item, const std::strin
 	scriptInterface->pushFunction(scriptId);
 
 	LuaScriptInterface::pushUserdata(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::setMetatable(L, -1, LuaData_Player);
 
 	LuaScriptInterface::pushThing(L, item);
 	LuaScriptInterface::pushString(L, text);
@@ -604,8 +604,7 @@ void CreatureEvent::executeExtendedOpcode(Player* player, uint8_t opcode, const
 
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	lua_pushnumber(L, opcode);
 	LuaScriptInterface::pushString(L, buffer);
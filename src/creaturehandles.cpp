@@ -0,0 +1,51 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "creaturehandles.h"
+
+CreatureHandle CreatureHandleTable::add(Creature* creature)
+{
+	uint32_t index;
+	if (freeSlots.empty()) {
+		index = static_cast<uint32_t>(slots.size());
+		slots.emplace_back();
+	} else {
+		index = freeSlots.front();
+		freeSlots.pop_front();
+	}
+
+	Slot& slot = slots[index];
+	slot.creature = creature;
+	return (static_cast<CreatureHandle>(slot.generation) << 32) | index;
+}
+
+void CreatureHandleTable::remove(CreatureHandle handle)
+{
+	uint32_t index = static_cast<uint32_t>(handle);
+	if (index >= slots.size() || slots[index].generation != (handle >> 32)) {
+		return;
+	}
+
+	Slot& slot = slots[index];
+	slot.creature = nullptr;
+	slot.generation = slot.generation % ((1U << CREATURE_HANDLE_GENERATION_BITS) - 1) + 1;
+	freeSlots.push_back(index);
+}
@@ -0,0 +1,72 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_CREATUREHANDLES_H_8E4B2D7A1C5F4A9B8D3E6C0F2A7B5D1E
+#define FS_CREATUREHANDLES_H_8E4B2D7A1C5F4A9B8D3E6C0F2A7B5D1E
+
+class Creature;
+
+//slot index in the low 32 bits and the generation of the slot above them, 0 is never a handle
+using CreatureHandle = uint64_t;
+
+//generations wrap at this many bits, so handles stay exact in a double (Lua 5.1 and LuaJIT numbers)
+static constexpr uint32_t CREATURE_HANDLE_GENERATION_BITS = 21;
+
+/*
+ * Resolves creatures without hashing: a handle is the index of the slot a creature was put in
+ * plus the generation the slot had at that time. Removing the creature bumps the generation,
+ * so every handle still held by scheduled tasks or scripts resolves to nullptr from then on.
+ * Freed slots are reused oldest first, which keeps a single slot from cycling its generations.
+ * Handles are always above the 32 bit creature ids, functions can take either of them.
+ */
+class CreatureHandleTable
+{
+	public:
+		CreatureHandle add(Creature* creature);
+		void remove(CreatureHandle handle);
+
+		Creature* get(CreatureHandle handle) const {
+			uint32_t index = static_cast<uint32_t>(handle);
+			if (index >= slots.size()) {
+				return nullptr;
+			}
+
+			const Slot& slot = slots[index];
+			return slot.generation == (handle >> 32) ? slot.creature : nullptr;
+		}
+
+		size_t size() const {
+			return slots.size() - freeSlots.size();
+		}
+
+		static bool isHandle(uint64_t value) {
+			return value > std::numeric_limits<uint32_t>::max();
+		}
+
+	private:
+		struct Slot {
+			Creature* creature = nullptr;
+			uint32_t generation = 1;
+		};
+
+		std::vector<Slot> slots;
+		std::deque<uint32_t> freeSlots;
+};
+
+#endif
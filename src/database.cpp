@@ -308,6 +308,18 @@ bool DBInsert::addRow(std::ostringstream& row)
 	return ret;
 }
 
+void DBInsert::upsert(const std::vector<std::string>& columns)
+{
+	upsertQuery = " ON DUPLICATE KEY UPDATE ";
+	for (const std::string& column : columns) {
+		if (&column != &columns.front()) {
+			upsertQuery.push_back(',');
+		}
+		upsertQuery.append(1, '`').append(column).append("` = VALUES(`").append(column).append("`)");
+	}
+	length = query.length() + upsertQuery.length() + values.length();
+}
+
 bool DBInsert::execute()
 {
 	if (values.empty()) {
@@ -315,8 +327,8 @@ bool DBInsert::execute()
 	}
 
 	// executes buffer
-	bool res = dtb->executeQuery(query + values);
+	bool res = dtb->executeQuery(query + values + upsertQuery);
 	values.clear();
-	length = query.length();
+	length = query.length() + upsertQuery.length();
 	return res;
 }
@@ -221,12 +221,15 @@ class DBInsert
 		explicit DBInsert(Database* dtb, std::string query);
 		bool addRow(const std::string& row);
 		bool addRow(std::ostringstream& row);
+		//turns the statement into an upsert that overwrites columns of rows with a duplicate key
+		void upsert(const std::vector<std::string>& columns);
 		bool execute();
 
 	private:
 		Database* dtb;
 		std::string query;
 		std::string values;
+		std::string upsertQuery;
 		size_t length;
 };
 
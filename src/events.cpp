@@ -24,6 +24,7 @@
 #include "item.h"
 #include "player.h"
 
+#include <fstream>
 #include <set>
 
 Events::Events() :
@@ -60,68 +61,68 @@ bool Events::load()
 		}
 
 		const std::string& methodName = eventNode.attribute("method").as_string();
-		const int32_t event = scriptInterface.getMetaEvent(className, methodName);
+		const EventCallback callback = getCallback(scriptInterface.getMetaEvent(className, methodName));
 		if (!tfs_strcmp(className.c_str(), "Creature")) {
 			if (!tfs_strcmp(methodName.c_str(), "onChangeOutfit")) {
-				info.creatureOnChangeOutfit = event;
+				info.creatureOnChangeOutfit = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onAreaCombat")) {
-				info.creatureOnAreaCombat = event;
+				info.creatureOnAreaCombat = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onTargetCombat")) {
-				info.creatureOnTargetCombat = event;
+				info.creatureOnTargetCombat = callback;
 			} else {
 				std::cout << "[Warning - Events::load] Unknown creature method: " << methodName << std::endl;
 			}
 		} else if (!tfs_strcmp(className.c_str(), "Party")) {
 			if (!tfs_strcmp(methodName.c_str(), "onJoin")) {
-				info.partyOnJoin = event;
+				info.partyOnJoin = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onLeave")) {
-				info.partyOnLeave = event;
+				info.partyOnLeave = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onDisband")) {
-				info.partyOnDisband = event;
+				info.partyOnDisband = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onShareExperience")) {
-				info.partyOnShareExperience = event;
+				info.partyOnShareExperience = callback;
 			} else {
 				std::cout << "[Warning - Events::load] Unknown party method: " << methodName << std::endl;
 			}
 		} else if (!tfs_strcmp(className.c_str(), "Player")) {
 			if (!tfs_strcmp(methodName.c_str(), "onBrowseField")) {
-				info.playerOnBrowseField = event;
+				info.playerOnBrowseField = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onLook")) {
-				info.playerOnLook = event;
+				info.playerOnLook = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onLookInBattleList")) {
-				info.playerOnLookInBattleList = event;
+				info.playerOnLookInBattleList = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onLookInTrade")) {
-				info.playerOnLookInTrade = event;
+				info.playerOnLookInTrade = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onLookInShop")) {
-				info.playerOnLookInShop = event;
+				info.playerOnLookInShop = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onTradeRequest")) {
-				info.playerOnTradeRequest = event;
+				info.playerOnTradeRequest = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onTradeAccept")) {
-				info.playerOnTradeAccept = event;
+				info.playerOnTradeAccept = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onMoveItem")) {
-				info.playerOnMoveItem = event;
+				info.playerOnMoveItem = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onItemMoved")) {
-				info.playerOnItemMoved = event;
+				info.playerOnItemMoved = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onMoveCreature")) {
-				info.playerOnMoveCreature = event;
+				info.playerOnMoveCreature = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onReportRuleViolation")) {
-				info.playerOnReportRuleViolation = event;
+				info.playerOnReportRuleViolation = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onReportBug")) {
-				info.playerOnReportBug = event;
+				info.playerOnReportBug = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onTurn")) {
-				info.playerOnTurn = event;
+				info.playerOnTurn = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onGainExperience")) {
-				info.playerOnGainExperience = event;
+				info.playerOnGainExperience = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onLoseExperience")) {
-				info.playerOnLoseExperience = event;
+				info.playerOnLoseExperience = callback;
 			} else if (!tfs_strcmp(methodName.c_str(), "onGainSkillTries")) {
-				info.playerOnGainSkillTries = event;
+				info.playerOnGainSkillTries = callback;
 			} else {
 				std::cout << "[Warning - Events::load] Unknown player method: " << methodName << std::endl;
 			}
 		} else if (!tfs_strcmp(className.c_str(), "Monster")) {
 			if (!tfs_strcmp(methodName.c_str(), "onDropLoot")) {
-				info.monsterOnDropLoot = event;
+				info.monsterOnDropLoot = callback;
 			} else {
 				std::cout << "[Warning - Events::load] Unknown monster method: " << methodName << std::endl;
 			}
@@ -132,24 +133,200 @@ bool Events::load()
 	return true;
 }
 
+bool Events::parseTrivialMethod(const std::string& source, TrivialMethod& method)
+{
+	//names, keywords and numbers are single tokens, strings and operators make the method non trivial
+	std::vector<std::string> tokens;
+	for (size_t i = 0, size = source.size(); i < size; ) {
+		char c = source[i];
+		if (c == '-' && i + 1 < size && source[i + 1] == '-') {
+			if (i + 2 < size && source[i + 2] == '[') {
+				//possibly a block comment, its end is not looked for
+				return false;
+			}
+
+			size_t lineEnd = source.find('\n', i);
+			i = lineEnd == std::string::npos ? size : lineEnd;
+		} else if (std::isspace(static_cast<unsigned char>(c))) {
+			++i;
+		} else if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.') {
+			size_t begin = i;
+			while (i < size && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_' || source[i] == '.')) {
+				++i;
+			}
+			tokens.emplace_back(source, begin, i - begin);
+		} else if (c == ':' || c == '(' || c == ')' || c == ',') {
+			tokens.emplace_back(1, c);
+			++i;
+		} else {
+			return false;
+		}
+	}
+
+	//function Class:method(params) [return value] end
+	size_t index = 0;
+	auto next = [&]() -> const std::string& {
+		static const std::string none;
+		return index < tokens.size() ? tokens[index++] : none;
+	};
+
+	if (next() != "function" || next().empty()) {
+		return false;
+	}
+
+	bool hasSelf = true;
+	if (index < tokens.size() && tokens[index] == ":") {
+		++index;
+		if (next().empty()) {
+			return false;
+		}
+		hasSelf = false;
+	}
+
+	if (next() != "(") {
+		return false;
+	}
+
+	std::vector<std::string> params;
+	if (index < tokens.size() && tokens[index] == ")") {
+		++index;
+	} else {
+		while (true) {
+			const std::string& param = next();
+			if (param.empty() || param == "," || param == ")") {
+				return false;
+			}
+			params.push_back(param);
+
+			const std::string& separator = next();
+			if (separator == ")") {
+				break;
+			} else if (separator != ",") {
+				return false;
+			}
+		}
+	}
+
+	if (hasSelf) {
+		if (params.empty()) {
+			return false;
+		}
+		params.erase(params.begin());
+	}
+
+	method = {};
+	if (index < tokens.size() && tokens[index] == "return") {
+		++index;
+		method.value = next();
+		if (method.value.empty() || method.value == "end") {
+			return false;
+		}
+	}
+
+	if (next() != "end" || index != tokens.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < params.size(); ++i) {
+		if (params[i] == method.value) {
+			method.argument = static_cast<int32_t>(i + 1);
+			break;
+		}
+	}
+	return true;
+}
+
+EventCallback Events::getCallback(int32_t scriptId)
+{
+	EventCallback callback;
+	callback.scriptId = scriptId;
+	if (scriptId == -1) {
+		return callback;
+	}
+
+	lua_State* L = scriptInterface.getLuaState();
+	if (!scriptInterface.pushFunction(scriptId)) {
+		lua_pop(L, 1);
+		return callback;
+	}
+
+	lua_Debug ar;
+	lua_getinfo(L, ">S", &ar);
+	if (ar.source[0] != '@' || ar.linedefined <= 0) {
+		return callback;
+	}
+
+	std::ifstream file(ar.source + 1);
+	std::string source, line;
+	for (int lineNumber = 1; lineNumber <= ar.lastlinedefined && std::getline(file, line); ++lineNumber) {
+		if (lineNumber >= ar.linedefined) {
+			source += line;
+			source.push_back('\n');
+		}
+	}
+
+	TrivialMethod method;
+	if (!parseTrivialMethod(source, method)) {
+		return callback;
+	}
+
+	if (method.argument != -1) {
+		callback.returnedArgument = method.argument;
+		return callback;
+	}
+
+	const std::string& value = method.value;
+	if (value.empty() || value == "nil" || value == "false") {
+		callback.boolean = false;
+	} else if (value == "true") {
+		callback.boolean = true;
+	} else if (std::isdigit(static_cast<unsigned char>(value.front()))) {
+		char* end;
+		callback.number = std::strtod(value.c_str(), &end);
+		if (*end != '\0') {
+			return callback;
+		}
+		callback.boolean = true;
+	} else if (LuaScriptInterface::getRegisteredGlobal(value, callback.number)) {
+		//only enums registered by the server, and only while the datapack has not reassigned them
+		lua_getglobal(L, value.c_str());
+		bool unchanged = lua_type(L, -1) == LUA_TNUMBER && lua_tonumber(L, -1) == callback.number;
+		lua_pop(L, 1);
+		if (!unchanged) {
+			callback.number = 0;
+			return callback;
+		}
+		callback.boolean = true;
+	} else {
+		return callback;
+	}
+
+	callback.constant = true;
+	return callback;
+}
+
 // Creature
 bool Events::eventCreatureOnChangeOutfit(Creature* creature, const Outfit_t& outfit)
 {
 	// Creature:onChangeOutfit(outfit) or Creature.onChangeOutfit(self, outfit)
-	if (info.creatureOnChangeOutfit == -1) {
+	if (!info.creatureOnChangeOutfit.isScripted()) {
 		return true;
 	}
 
+	if (info.creatureOnChangeOutfit.isConstant()) {
+		return info.creatureOnChangeOutfit.boolean;
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventCreatureOnChangeOutfit] Call stack overflow" << std::endl;
 		return false;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.creatureOnChangeOutfit, &scriptInterface);
+	env->setScriptId(info.creatureOnChangeOutfit.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.creatureOnChangeOutfit);
+	scriptInterface.pushFunction(info.creatureOnChangeOutfit.scriptId);
 
 	LuaScriptInterface::pushUserdata<Creature>(L, creature);
 	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -162,20 +339,24 @@ bool Events::eventCreatureOnChangeOutfit(Creature* creature, const Outfit_t& out
 ReturnValue Events::eventCreatureOnAreaCombat(Creature* creature, Tile* tile, bool aggressive)
 {
 	// Creature:onAreaCombat(tile, aggressive) or Creature.onAreaCombat(self, tile, aggressive)
-	if (info.creatureOnAreaCombat == -1) {
+	if (!info.creatureOnAreaCombat.isScripted()) {
 		return RETURNVALUE_NOERROR;
 	}
 
+	if (info.creatureOnAreaCombat.isConstant()) {
+		return static_cast<ReturnValue>(info.creatureOnAreaCombat.number);
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventCreatureOnAreaCombat] Call stack overflow" << std::endl;
 		return RETURNVALUE_NOTPOSSIBLE;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.creatureOnAreaCombat, &scriptInterface);
+	env->setScriptId(info.creatureOnAreaCombat.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.creatureOnAreaCombat);
+	scriptInterface.pushFunction(info.creatureOnAreaCombat.scriptId);
 
 	if (creature) {
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
@@ -184,8 +365,7 @@ ReturnValue Events::eventCreatureOnAreaCombat(Creature* creature, Tile* tile, bo
 		lua_pushnil(L);
 	}
 
-	LuaScriptInterface::pushUserdata<Tile>(L, tile);
-	LuaScriptInterface::setMetatable(L, -1, "Tile");
+	LuaScriptInterface::pushUserdata<Tile>(L, tile, LuaData_Tile);
 
 	LuaScriptInterface::pushBoolean(L, aggressive);
 
@@ -205,20 +385,24 @@ ReturnValue Events::eventCreatureOnAreaCombat(Creature* creature, Tile* tile, bo
 ReturnValue Events::eventCreatureOnTargetCombat(Creature* creature, Creature* target)
 {
 	// Creature:onTargetCombat(target) or Creature.onTargetCombat(self, target)
-	if (info.creatureOnTargetCombat == -1) {
+	if (!info.creatureOnTargetCombat.isScripted()) {
 		return RETURNVALUE_NOERROR;
 	}
 
+	if (info.creatureOnTargetCombat.isConstant()) {
+		return static_cast<ReturnValue>(info.creatureOnTargetCombat.number);
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventCreatureOnTargetCombat] Call stack overflow" << std::endl;
 		return RETURNVALUE_NOTPOSSIBLE;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.creatureOnTargetCombat, &scriptInterface);
+	env->setScriptId(info.creatureOnTargetCombat.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.creatureOnTargetCombat);
+	scriptInterface.pushFunction(info.creatureOnTargetCombat.scriptId);
 
 	if (creature) {
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
@@ -247,26 +431,29 @@ ReturnValue Events::eventCreatureOnTargetCombat(Creature* creature, Creature* ta
 bool Events::eventPartyOnJoin(Party* party, Player* player)
 {
 	// Party:onJoin(player) or Party.onJoin(self, player)
-	if (info.partyOnJoin == -1) {
+	if (!info.partyOnJoin.isScripted()) {
 		return true;
 	}
 
+	if (info.partyOnJoin.isConstant()) {
+		return info.partyOnJoin.boolean;
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventPartyOnJoin] Call stack overflow" << std::endl;
 		return false;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnJoin, &scriptInterface);
+	env->setScriptId(info.partyOnJoin.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnJoin);
+	scriptInterface.pushFunction(info.partyOnJoin.scriptId);
 
 	LuaScriptInterface::pushUserdata<Party>(L, party);
 	LuaScriptInterface::setMetatable(L, -1, "Party");
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	return scriptInterface.callFunction(2);
 }
@@ -274,26 +461,29 @@ bool Events::eventPartyOnJoin(Party* party, Player* player)
 bool Events::eventPartyOnLeave(Party* party, Player* player)
 {
 	// Party:onLeave(player) or Party.onLeave(self, player)
-	if (info.partyOnLeave == -1) {
+	if (!info.partyOnLeave.isScripted()) {
 		return true;
 	}
 
+	if (info.partyOnLeave.isConstant()) {
+		return info.partyOnLeave.boolean;
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventPartyOnLeave] Call stack overflow" << std::endl;
 		return false;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnLeave, &scriptInterface);
+	env->setScriptId(info.partyOnLeave.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnLeave);
+	scriptInterface.pushFunction(info.partyOnLeave.scriptId);
 
 	LuaScriptInterface::pushUserdata<Party>(L, party);
 	LuaScriptInterface::setMetatable(L, -1, "Party");
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	return scriptInterface.callFunction(2);
 }
@@ -301,20 +491,24 @@ bool Events::eventPartyOnLeave(Party* party, Player* player)
 bool Events::eventPartyOnDisband(Party* party)
 {
 	// Party:onDisband() or Party.onDisband(self)
-	if (info.partyOnDisband == -1) {
+	if (!info.partyOnDisband.isScripted()) {
 		return true;
 	}
 
+	if (info.partyOnDisband.isConstant()) {
+		return info.partyOnDisband.boolean;
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventPartyOnDisband] Call stack overflow" << std::endl;
 		return false;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnDisband, &scriptInterface);
+	env->setScriptId(info.partyOnDisband.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnDisband);
+	scriptInterface.pushFunction(info.partyOnDisband.scriptId);
 
 	LuaScriptInterface::pushUserdata<Party>(L, party);
 	LuaScriptInterface::setMetatable(L, -1, "Party");
@@ -325,7 +519,14 @@ bool Events::eventPartyOnDisband(Party* party)
 void Events::eventPartyOnShareExperience(Party* party, uint64_t& exp)
 {
 	// Party:onShareExperience(exp) or Party.onShareExperience(self, exp)
-	if (info.partyOnShareExperience == -1) {
+	if (!info.partyOnShareExperience.isScripted()) {
+		return;
+	}
+
+	if (info.partyOnShareExperience.isConstant()) {
+		exp = static_cast<uint64_t>(info.partyOnShareExperience.number);
+		return;
+	} else if (info.partyOnShareExperience.returnsArgument(1)) {
 		return;
 	}
 
@@ -335,10 +536,10 @@ void Events::eventPartyOnShareExperience(Party* party, uint64_t& exp)
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnShareExperience, &scriptInterface);
+	env->setScriptId(info.partyOnShareExperience.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnShareExperience);
+	scriptInterface.pushFunction(info.partyOnShareExperience.scriptId);
 
 	LuaScriptInterface::pushUserdata<Party>(L, party);
 	LuaScriptInterface::setMetatable(L, -1, "Party");
@@ -359,23 +560,26 @@ void Events::eventPartyOnShareExperience(Party* party, uint64_t& exp)
 bool Events::eventPlayerOnBrowseField(Player* player, const Position& position)
 {
 	// Player:onBrowseField(position) or Player.onBrowseField(self, position)
-	if (info.playerOnBrowseField == -1) {
+	if (!info.playerOnBrowseField.isScripted()) {
 		return true;
 	}
 
+	if (info.playerOnBrowseField.isConstant()) {
+		return info.playerOnBrowseField.boolean;
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventPlayerOnBrowseField] Call stack overflow" << std::endl;
 		return false;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnBrowseField, &scriptInterface);
+	env->setScriptId(info.playerOnBrowseField.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnBrowseField);
+	scriptInterface.pushFunction(info.playerOnBrowseField.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushPosition(L, position);
 
@@ -385,7 +589,11 @@ bool Events::eventPlayerOnBrowseField(Player* player, const Position& position)
 void Events::eventPlayerOnLook(Player* player, const Position& position, Thing* thing, uint8_t stackpos, int32_t lookDistance)
 {
 	// Player:onLook(thing, position, distance) or Player.onLook(self, thing, position, distance)
-	if (info.playerOnLook == -1) {
+	if (!info.playerOnLook.isScripted()) {
+		return;
+	}
+
+	if (info.playerOnLook.isConstant()) {
 		return;
 	}
 
@@ -395,13 +603,12 @@ void Events::eventPlayerOnLook(Player* player, const Position& position, Thing*
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnLook, &scriptInterface);
+	env->setScriptId(info.playerOnLook.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnLook);
+	scriptInterface.pushFunction(info.playerOnLook.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	if (Creature* creature = thing->getCreature()) {
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
@@ -422,7 +629,11 @@ void Events::eventPlayerOnLook(Player* player, const Position& position, Thing*
 void Events::eventPlayerOnLookInBattleList(Player* player, Creature* creature, int32_t lookDistance)
 {
 	// Player:onLookInBattleList(creature, position, distance) or Player.onLookInBattleList(self, creature, position, distance)
-	if (info.playerOnLookInBattleList == -1) {
+	if (!info.playerOnLookInBattleList.isScripted()) {
+		return;
+	}
+
+	if (info.playerOnLookInBattleList.isConstant()) {
 		return;
 	}
 
@@ -432,13 +643,12 @@ void Events::eventPlayerOnLookInBattleList(Player* player, Creature* creature, i
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnLookInBattleList, &scriptInterface);
+	env->setScriptId(info.playerOnLookInBattleList.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnLookInBattleList);
+	scriptInterface.pushFunction(info.playerOnLookInBattleList.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Creature>(L, creature);
 	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -451,7 +661,11 @@ void Events::eventPlayerOnLookInBattleList(Player* player, Creature* creature, i
 void Events::eventPlayerOnLookInTrade(Player* player, Player* partner, Item* item, int32_t lookDistance)
 {
 	// Player:onLookInTrade(partner, item, distance) or Player.onLookInTrade(self, partner, item, distance)
-	if (info.playerOnLookInTrade == -1) {
+	if (!info.playerOnLookInTrade.isScripted()) {
+		return;
+	}
+
+	if (info.playerOnLookInTrade.isConstant()) {
 		return;
 	}
 
@@ -461,16 +675,14 @@ void Events::eventPlayerOnLookInTrade(Player* player, Player* partner, Item* ite
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnLookInTrade, &scriptInterface);
+	env->setScriptId(info.playerOnLookInTrade.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnLookInTrade);
+	scriptInterface.pushFunction(info.playerOnLookInTrade.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
-	LuaScriptInterface::pushUserdata<Player>(L, partner);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, partner, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Item>(L, item);
 	LuaScriptInterface::setItemMetatable(L, -1, item);
@@ -483,23 +695,26 @@ void Events::eventPlayerOnLookInTrade(Player* player, Player* partner, Item* ite
 bool Events::eventPlayerOnLookInShop(Player* player, const ItemType* itemType, uint8_t count)
 {
 	// Player:onLookInShop(itemType, count) or Player.onLookInShop(self, itemType, count)
-	if (info.playerOnLookInShop == -1) {
+	if (!info.playerOnLookInShop.isScripted()) {
 		return true;
 	}
 
+	if (info.playerOnLookInShop.isConstant()) {
+		return info.playerOnLookInShop.boolean;
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventPlayerOnLookInShop] Call stack overflow" << std::endl;
 		return false;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnLookInShop, &scriptInterface);
+	env->setScriptId(info.playerOnLookInShop.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnLookInShop);
+	scriptInterface.pushFunction(info.playerOnLookInShop.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<const ItemType>(L, itemType);
 	LuaScriptInterface::setMetatable(L, -1, "ItemType");
@@ -512,23 +727,26 @@ bool Events::eventPlayerOnLookInShop(Player* player, const ItemType* itemType, u
 bool Events::eventPlayerOnMoveItem(Player* player, Item* item, uint16_t count, const Position& fromPosition, const Position& toPosition, Cylinder* fromCylinder, Cylinder* toCylinder)
 {
 	// Player:onMoveItem(item, count, fromPosition, toPosition) or Player.onMoveItem(self, item, count, fromPosition, toPosition, fromCylinder, toCylinder)
-	if (info.playerOnMoveItem == -1) {
+	if (!info.playerOnMoveItem.isScripted()) {
 		return true;
 	}
 
+	if (info.playerOnMoveItem.isConstant()) {
+		return info.playerOnMoveItem.boolean;
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventPlayerOnMoveItem] Call stack overflow" << std::endl;
 		return false;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnMoveItem, &scriptInterface);
+	env->setScriptId(info.playerOnMoveItem.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnMoveItem);
+	scriptInterface.pushFunction(info.playerOnMoveItem.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Item>(L, item);
 	LuaScriptInterface::setItemMetatable(L, -1, item);
@@ -546,7 +764,11 @@ bool Events::eventPlayerOnMoveItem(Player* player, Item* item, uint16_t count, c
 void Events::eventPlayerOnItemMoved(Player* player, Item* item, uint16_t count, const Position& fromPosition, const Position& toPosition, Cylinder* fromCylinder, Cylinder* toCylinder)
 {
 	// Player:onItemMoved(item, count, fromPosition, toPosition) or Player.onItemMoved(self, item, count, fromPosition, toPosition, fromCylinder, toCylinder)
-	if (info.playerOnItemMoved == -1) {
+	if (!info.playerOnItemMoved.isScripted()) {
+		return;
+	}
+
+	if (info.playerOnItemMoved.isConstant()) {
 		return;
 	}
 
@@ -556,13 +778,12 @@ void Events::eventPlayerOnItemMoved(Player* player, Item* item, uint16_t count,
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnItemMoved, &scriptInterface);
+	env->setScriptId(info.playerOnItemMoved.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnItemMoved);
+	scriptInterface.pushFunction(info.playerOnItemMoved.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Item>(L, item);
 	LuaScriptInterface::setItemMetatable(L, -1, item);
@@ -580,23 +801,26 @@ void Events::eventPlayerOnItemMoved(Player* player, Item* item, uint16_t count,
 bool Events::eventPlayerOnMoveCreature(Player* player, Creature* creature, const Position& fromPosition, const Position& toPosition)
 {
 	// Player:onMoveCreature(creature, fromPosition, toPosition) or Player.onMoveCreature(self, creature, fromPosition, toPosition)
-	if (info.playerOnMoveCreature == -1) {
+	if (!info.playerOnMoveCreature.isScripted()) {
 		return true;
 	}
 
+	if (info.playerOnMoveCreature.isConstant()) {
+		return info.playerOnMoveCreature.boolean;
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventPlayerOnMoveCreature] Call stack overflow" << std::endl;
 		return false;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnMoveCreature, &scriptInterface);
+	env->setScriptId(info.playerOnMoveCreature.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnMoveCreature);
+	scriptInterface.pushFunction(info.playerOnMoveCreature.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Creature>(L, creature);
 	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -610,7 +834,11 @@ bool Events::eventPlayerOnMoveCreature(Player* player, Creature* creature, const
 void Events::eventPlayerOnReportRuleViolation(Player* player, const std::string& targetName, uint8_t reportType, uint8_t reportReason, const std::string& comment, const std::string& translation)
 {
 	// Player:onReportRuleViolation(targetName, reportType, reportReason, comment, translation)
-	if (info.playerOnReportRuleViolation == -1) {
+	if (!info.playerOnReportRuleViolation.isScripted()) {
+		return;
+	}
+
+	if (info.playerOnReportRuleViolation.isConstant()) {
 		return;
 	}
 
@@ -620,13 +848,12 @@ void Events::eventPlayerOnReportRuleViolation(Player* player, const std::string&
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnReportRuleViolation, &scriptInterface);
+	env->setScriptId(info.playerOnReportRuleViolation.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnReportRuleViolation);
+	scriptInterface.pushFunction(info.playerOnReportRuleViolation.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushString(L, targetName);
 
@@ -642,23 +869,26 @@ void Events::eventPlayerOnReportRuleViolation(Player* player, const std::string&
 bool Events::eventPlayerOnReportBug(Player* player, const std::string& message, const Position& position, uint8_t category)
 {
 	// Player:onReportBug(message, position, category)
-	if (info.playerOnReportBug == -1) {
+	if (!info.playerOnReportBug.isScripted()) {
 		return true;
 	}
 
+	if (info.playerOnReportBug.isConstant()) {
+		return info.playerOnReportBug.boolean;
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventPlayerOnReportBug] Call stack overflow" << std::endl;
 		return false;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnReportBug, &scriptInterface);
+	env->setScriptId(info.playerOnReportBug.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnReportBug);
+	scriptInterface.pushFunction(info.playerOnReportBug.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushString(L, message);
 	LuaScriptInterface::pushPosition(L, position);
@@ -670,23 +900,26 @@ bool Events::eventPlayerOnReportBug(Player* player, const std::string& message,
 bool Events::eventPlayerOnTurn(Player* player, Direction direction)
 {
 	// Player:onTurn(direction) or Player.onTurn(self, direction)
-	if (info.playerOnTurn == -1) {
+	if (!info.playerOnTurn.isScripted()) {
 		return true;
 	}
 
+	if (info.playerOnTurn.isConstant()) {
+		return info.playerOnTurn.boolean;
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventPlayerOnTurn] Call stack overflow" << std::endl;
 		return false;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnTurn, &scriptInterface);
+	env->setScriptId(info.playerOnTurn.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnTurn);
+	scriptInterface.pushFunction(info.playerOnTurn.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	lua_pushnumber(L, direction);
 
@@ -696,26 +929,28 @@ bool Events::eventPlayerOnTurn(Player* player, Direction direction)
 bool Events::eventPlayerOnTradeRequest(Player* player, Player* target, Item* item)
 {
 	// Player:onTradeRequest(target, item)
-	if (info.playerOnTradeRequest == -1) {
+	if (!info.playerOnTradeRequest.isScripted()) {
 		return true;
 	}
 
+	if (info.playerOnTradeRequest.isConstant()) {
+		return info.playerOnTradeRequest.boolean;
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventPlayerOnTradeRequest] Call stack overflow" << std::endl;
 		return false;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnTradeRequest, &scriptInterface);
+	env->setScriptId(info.playerOnTradeRequest.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnTradeRequest);
+	scriptInterface.pushFunction(info.playerOnTradeRequest.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
-	LuaScriptInterface::pushUserdata<Player>(L, target);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, target, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Item>(L, item);
 	LuaScriptInterface::setItemMetatable(L, -1, item);
@@ -726,26 +961,28 @@ bool Events::eventPlayerOnTradeRequest(Player* player, Player* target, Item* ite
 bool Events::eventPlayerOnTradeAccept(Player* player, Player* target, Item* item, Item* targetItem)
 {
 	// Player:onTradeAccept(target, item, targetItem)
-	if (info.playerOnTradeAccept == -1) {
+	if (!info.playerOnTradeAccept.isScripted()) {
 		return true;
 	}
 
+	if (info.playerOnTradeAccept.isConstant()) {
+		return info.playerOnTradeAccept.boolean;
+	}
+
 	if (!scriptInterface.reserveScriptEnv()) {
 		std::cout << "[Error - Events::eventPlayerOnTradeAccept] Call stack overflow" << std::endl;
 		return false;
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnTradeAccept, &scriptInterface);
+	env->setScriptId(info.playerOnTradeAccept.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnTradeAccept);
+	scriptInterface.pushFunction(info.playerOnTradeAccept.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
-	LuaScriptInterface::pushUserdata<Player>(L, target);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, target, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<Item>(L, item);
 	LuaScriptInterface::setItemMetatable(L, -1, item);
@@ -760,7 +997,14 @@ void Events::eventPlayerOnGainExperience(Player* player, Creature* source, uint6
 {
 	// Player:onGainExperience(source, exp, rawExp)
 	// rawExp gives the original exp which is not multiplied
-	if (info.playerOnGainExperience == -1) {
+	if (!info.playerOnGainExperience.isScripted()) {
+		return;
+	}
+
+	if (info.playerOnGainExperience.isConstant()) {
+		exp = static_cast<uint64_t>(info.playerOnGainExperience.number);
+		return;
+	} else if (info.playerOnGainExperience.returnsArgument(2)) {
 		return;
 	}
 
@@ -770,13 +1014,12 @@ void Events::eventPlayerOnGainExperience(Player* player, Creature* source, uint6
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnGainExperience, &scriptInterface);
+	env->setScriptId(info.playerOnGainExperience.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnGainExperience);
+	scriptInterface.pushFunction(info.playerOnGainExperience.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	if (source) {
 		LuaScriptInterface::pushUserdata<Creature>(L, source);
@@ -801,7 +1044,14 @@ void Events::eventPlayerOnGainExperience(Player* player, Creature* source, uint6
 void Events::eventPlayerOnLoseExperience(Player* player, uint64_t& exp)
 {
 	// Player:onLoseExperience(exp)
-	if (info.playerOnLoseExperience == -1) {
+	if (!info.playerOnLoseExperience.isScripted()) {
+		return;
+	}
+
+	if (info.playerOnLoseExperience.isConstant()) {
+		exp = static_cast<uint64_t>(info.playerOnLoseExperience.number);
+		return;
+	} else if (info.playerOnLoseExperience.returnsArgument(1)) {
 		return;
 	}
 
@@ -811,13 +1061,12 @@ void Events::eventPlayerOnLoseExperience(Player* player, uint64_t& exp)
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnLoseExperience, &scriptInterface);
+	env->setScriptId(info.playerOnLoseExperience.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnLoseExperience);
+	scriptInterface.pushFunction(info.playerOnLoseExperience.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	lua_pushnumber(L, exp);
 
@@ -834,7 +1083,14 @@ void Events::eventPlayerOnLoseExperience(Player* player, uint64_t& exp)
 void Events::eventPlayerOnGainSkillTries(Player* player, skills_t skill, uint64_t& tries)
 {
 	// Player:onGainSkillTries(skill, tries)
-	if (info.playerOnGainSkillTries == -1) {
+	if (!info.playerOnGainSkillTries.isScripted()) {
+		return;
+	}
+
+	if (info.playerOnGainSkillTries.isConstant()) {
+		tries = static_cast<uint64_t>(info.playerOnGainSkillTries.number);
+		return;
+	} else if (info.playerOnGainSkillTries.returnsArgument(2)) {
 		return;
 	}
 
@@ -844,13 +1100,12 @@ void Events::eventPlayerOnGainSkillTries(Player* player, skills_t skill, uint64_
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnGainSkillTries, &scriptInterface);
+	env->setScriptId(info.playerOnGainSkillTries.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnGainSkillTries);
+	scriptInterface.pushFunction(info.playerOnGainSkillTries.scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	lua_pushnumber(L, skill);
 	lua_pushnumber(L, tries);
@@ -868,7 +1123,11 @@ void Events::eventPlayerOnGainSkillTries(Player* player, skills_t skill, uint64_
 void Events::eventMonsterOnDropLoot(Monster* monster, Container* corpse)
 {
 	// Monster:onDropLoot(corpse)
-	if (info.monsterOnDropLoot == -1) {
+	if (!info.monsterOnDropLoot.isScripted()) {
+		return;
+	}
+
+	if (info.monsterOnDropLoot.isConstant()) {
 		return;
 	}
 
@@ -878,16 +1137,14 @@ void Events::eventMonsterOnDropLoot(Monster* monster, Container* corpse)
 	}
 
 	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.monsterOnDropLoot, &scriptInterface);
+	env->setScriptId(info.monsterOnDropLoot.scriptId, &scriptInterface);
 
 	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.monsterOnDropLoot);
+	scriptInterface.pushFunction(info.monsterOnDropLoot.scriptId);
 
-	LuaScriptInterface::pushUserdata<Monster>(L, monster);
-	LuaScriptInterface::setMetatable(L, -1, "Monster");
+	LuaScriptInterface::pushUserdata<Monster>(L, monster, LuaData_Monster);
 
-	LuaScriptInterface::pushUserdata<Container>(L, corpse);
-	LuaScriptInterface::setMetatable(L, -1, "Container");
+	LuaScriptInterface::pushUserdata<Container>(L, corpse, LuaData_Container);
 
 	return scriptInterface.callVoidFunction(2);
 }
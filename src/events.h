@@ -26,40 +26,69 @@ class Party;
 class ItemType;
 class Tile;
 
+//Script method reduced to "return <value>" (or an empty body), see Events::parseTrivialMethod
+struct TrivialMethod {
+	//returned token, empty for an empty body
+	std::string value;
+	//position of the returned parameter after self, -1 if the value is not a parameter
+	int32_t argument = -1;
+};
+
+struct EventCallback {
+	int32_t scriptId = -1;
+	//the method only returns a constant, the hook returns it without calling into Lua
+	bool constant = false;
+	//the constant as getBoolean and getNumber would read it
+	bool boolean = false;
+	lua_Number number = 0;
+	//the method only returns this parameter unchanged
+	int32_t returnedArgument = -1;
+
+	bool isScripted() const {
+		return scriptId != -1;
+	}
+	bool isConstant() const {
+		return constant;
+	}
+	bool returnsArgument(int32_t argument) const {
+		return returnedArgument == argument;
+	}
+};
+
 class Events
 {
 	struct EventsInfo {
 		// Creature
-		int32_t creatureOnChangeOutfit = -1;
-		int32_t creatureOnAreaCombat = -1;
-		int32_t creatureOnTargetCombat = -1;
+		EventCallback creatureOnChangeOutfit;
+		EventCallback creatureOnAreaCombat;
+		EventCallback creatureOnTargetCombat;
 
 		// Party
-		int32_t partyOnJoin = -1;
-		int32_t partyOnLeave = -1;
-		int32_t partyOnDisband = -1;
-		int32_t partyOnShareExperience = -1;
+		EventCallback partyOnJoin;
+		EventCallback partyOnLeave;
+		EventCallback partyOnDisband;
+		EventCallback partyOnShareExperience;
 
 		// Player
-		int32_t playerOnBrowseField = -1;
-		int32_t playerOnLook = -1;
-		int32_t playerOnLookInBattleList = -1;
-		int32_t playerOnLookInTrade = -1;
-		int32_t playerOnLookInShop = -1;
-		int32_t playerOnMoveItem = -1;
-		int32_t playerOnItemMoved = -1;
-		int32_t playerOnMoveCreature = -1;
-		int32_t playerOnReportRuleViolation = -1;
-		int32_t playerOnReportBug = -1;
-		int32_t playerOnTurn = -1;
-		int32_t playerOnTradeRequest = -1;
-		int32_t playerOnTradeAccept = -1;
-		int32_t playerOnGainExperience = -1;
-		int32_t playerOnLoseExperience = -1;
-		int32_t playerOnGainSkillTries = -1;
+		EventCallback playerOnBrowseField;
+		EventCallback playerOnLook;
+		EventCallback playerOnLookInBattleList;
+		EventCallback playerOnLookInTrade;
+		EventCallback playerOnLookInShop;
+		EventCallback playerOnMoveItem;
+		EventCallback playerOnItemMoved;
+		EventCallback playerOnMoveCreature;
+		EventCallback playerOnReportRuleViolation;
+		EventCallback playerOnReportBug;
+		EventCallback playerOnTurn;
+		EventCallback playerOnTradeRequest;
+		EventCallback playerOnTradeAccept;
+		EventCallback playerOnGainExperience;
+		EventCallback playerOnLoseExperience;
+		EventCallback playerOnGainSkillTries;
 
 		// Monster
-		int32_t monsterOnDropLoot = -1;
+		EventCallback monsterOnDropLoot;
 	};
 
 	public:
@@ -77,6 +106,13 @@ class Events
 
 		bool load();
 
+		/**
+		  * Recognizes a method definition whose whole body is empty or a single return of a literal,
+		  * an upper case global or one of its parameters, e.g. "function Creature:onAreaCombat(tile, isAggressive)
+		  * return RETURNVALUE_NOERROR end". Anything else, including block comments, is reported as not trivial.
+		  */
+		static bool parseTrivialMethod(const std::string& source, TrivialMethod& method);
+
 		// Creature
 		bool eventCreatureOnChangeOutfit(Creature* creature, const Outfit_t& outfit);
 		ReturnValue eventCreatureOnAreaCombat(Creature* creature, Tile* tile, bool aggressive);
@@ -110,6 +146,8 @@ class Events
 		void eventMonsterOnDropLoot(Monster* monster, Container* corpse);
 
 	private:
+		EventCallback getCallback(int32_t scriptId);
+
 		LuaScriptInterface scriptInterface;
 		EventsInfo info;
 };
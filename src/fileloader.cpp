@@ -40,76 +40,119 @@ Loader::Loader(const std::string& fileName, const Identifier& acceptedIdentifier
 	}
 }
 
-using NodeStack = std::vector<Node*>;
-static Node& getCurrentNode(const NodeStack& nodeStack) {
-	if (nodeStack.empty()) {
-		throw InvalidOTBFormat{};
-	}
-	return *nodeStack.back();
+Node Loader::getRoot() const
+{
+	Node root;
+	readNode(fileContents.begin() + sizeof(Identifier), root);
+	return root;
 }
 
-const Node& Loader::parseTree()
+void Loader::readNode(ContentIt it, Node& node) const
 {
-	auto it = fileContents.begin() + sizeof(Identifier);
-	if (static_cast<uint8_t>(*it) != Node::START) {
+	auto end = fileContents.end();
+	if (static_cast<uint8_t>(*it) != Node::START || ++it == end) {
 		throw InvalidOTBFormat{};
 	}
-	root.type = *(++it);
-	root.propsBegin = ++it;
-	NodeStack parseStack;
-	parseStack.push_back(&root);
 
-	for (auto end = fileContents.end(); it != end; ++it) {
-		uint8_t nodeType = static_cast<uint8_t>(*it);
-		if (nodeType == Node::START) {
-			auto& currentNode = getCurrentNode(parseStack);
-			if (currentNode.children.empty()) {
-				currentNode.propsEnd = it;
+	node.type = *it;
+	node.propsBegin = ++it;
+	for (; it != end; ++it) {
+		uint8_t byte = static_cast<uint8_t>(*it);
+		if (byte == Node::START || byte == Node::END) {
+			node.propsEnd = it;
+			return;
+		} else if (byte == Node::ESCAPE) {
+			node.escaped = true;
+			if (++it == end) {
+				break;
 			}
-			currentNode.children.emplace_back();
-			auto& child = currentNode.children.back();
-			if (++it == fileContents.end()) {
-				throw InvalidOTBFormat{};
+		}
+	}
+	throw InvalidOTBFormat{};
+}
+
+ContentIt Loader::skipChildren(ContentIt it) const
+{
+	size_t depth = 0;
+	for (auto end = fileContents.end(); it != end; ++it) {
+		uint8_t byte = static_cast<uint8_t>(*it);
+		if (byte == Node::START) {
+			//the node type is not a marker even if it has the value of one
+			if (++it == end) {
+				break;
 			}
-			child.type = *it;
-			child.propsBegin = it + sizeof(Node::type);
-			parseStack.push_back(&child);
-		} else if (nodeType == Node::END) {
-			auto& currentNode = getCurrentNode(parseStack);
-			if (currentNode.children.empty()) {
-				currentNode.propsEnd = it;
+			++depth;
+		} else if (byte == Node::END) {
+			if (depth-- == 0) {
+				return it + 1;
 			}
-			parseStack.pop_back();
-		} else if (nodeType == Node::ESCAPE) {
-			if (++it == fileContents.end()) {
-				throw InvalidOTBFormat{};
+		} else if (byte == Node::ESCAPE) {
+			if (++it == end) {
+				break;
 			}
 		}
 	}
-	if (!parseStack.empty()) {
+	throw InvalidOTBFormat{};
+}
+
+void Loader::ChildIterator::read(ContentIt it)
+{
+	if (it == loader->fileContents.end()) {
 		throw InvalidOTBFormat{};
 	}
 
-	return root;
+	current = Node{};
+	if (static_cast<uint8_t>(*it) == Node::END) {
+		parent->end = it + 1;
+		parent = nullptr;
+		return;
+	}
+	loader->readNode(it, current);
 }
 
 bool Loader::getProps(const Node& node, PropStream& props)
 {
-	size_t size = std::distance(node.propsBegin, node.propsEnd);
+	if (node.propsBegin == node.propsEnd) {
+		return false;
+	}
+
+	//most nodes have nothing to unescape and are read in place
+	if (!node.escaped) {
+		props.init(node.propsBegin, std::distance(node.propsBegin, node.propsEnd));
+		return true;
+	}
+
+	propBuffer.clear();
+	size_t size = appendProps(node, propBuffer);
 	if (size == 0) {
 		return false;
 	}
-	if (propBuffer.size() < size) {
-		propBuffer.resize(size);
+	props.init(&propBuffer[0], size);
+	return true;
+}
+
+size_t Loader::appendProps(const Node& node, std::vector<char>& buffer)
+{
+	size_t size = std::distance(node.propsBegin, node.propsEnd);
+	if (size == 0) {
+		return 0;
+	}
+
+	size_t offset = buffer.size();
+	if (!node.escaped) {
+		buffer.insert(buffer.end(), node.propsBegin, node.propsEnd);
+		return size;
 	}
+
+	buffer.resize(offset + size);
 	bool lastEscaped = false;
 
-	auto escapedPropEnd = std::copy_if(node.propsBegin, node.propsEnd, propBuffer.begin(), [&lastEscaped](const char& byte) {
+	auto escapedPropEnd = std::copy_if(node.propsBegin, node.propsEnd, buffer.begin() + offset, [&lastEscaped](const char& byte) {
 		lastEscaped = byte == static_cast<char>(Node::ESCAPE) && !lastEscaped;
 		return !lastEscaped;
 	});
-	props.init(&propBuffer[0], std::distance(propBuffer.begin(), escapedPropEnd));
-	return true;
+	buffer.erase(escapedPropEnd, buffer.end());
+	return buffer.size() - offset;
 }
 
 } //namespace OTB
@@ -33,22 +33,14 @@ using Identifier = std::array<char, 4>;
 
 struct Node
 {
-	using ChildrenVector = std::vector<Node>;
-
-	Node() = default;
-
-	// non-copyable
-	Node(const Node&) = delete;
-	Node& operator=(const Node&) = delete;
-
-	// moveable
-	Node(Node&& rhs) noexcept : children(std::move(rhs.children)), propsBegin(rhs.propsBegin), propsEnd(rhs.propsEnd), type(rhs.type) {}
-	Node& operator=(const Node&&) = delete;
-
-	ChildrenVector children;
-	ContentIt      propsBegin;
-	ContentIt      propsEnd;
-	uint8_t           type;
+	ContentIt propsBegin = nullptr;
+	//the first child or the end marker starts here
+	ContentIt propsEnd = nullptr;
+	//past the end marker, only known once the children were walked
+	ContentIt end = nullptr;
+	uint8_t type = 0;
+	//the properties hold escaped bytes and have to be unescaped before they are read
+	bool escaped = false;
 	enum NodeChar: uint8_t
 	{
 		ESCAPE = 0xFD,
@@ -69,12 +61,81 @@ struct InvalidOTBFormat final : LoadError {
 
 class Loader {
 	MappedFile     fileContents;
-	Node              root;
 	std::vector<char> propBuffer;
+
+	void readNode(ContentIt it, Node& node) const;
+	ContentIt skipChildren(ContentIt it) const;
+
 public:
+	//streams the children of a node, a child whose own children were not walked is skipped on increment
+	class ChildIterator {
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = Node;
+			using difference_type = std::ptrdiff_t;
+			using pointer = Node*;
+			using reference = Node&;
+
+			ChildIterator() = default;
+			ChildIterator(const Loader& loader, Node& parent) : loader(&loader), parent(&parent) {
+				read(parent.propsEnd);
+			}
+
+			Node& operator*() {
+				return current;
+			}
+			Node* operator->() {
+				return &current;
+			}
+
+			ChildIterator& operator++() {
+				read(current.end ? current.end : loader->skipChildren(current.propsEnd));
+				return *this;
+			}
+
+			bool operator==(const ChildIterator& rhs) const {
+				return parent == rhs.parent && current.propsBegin == rhs.current.propsBegin;
+			}
+			bool operator!=(const ChildIterator& rhs) const {
+				return !(*this == rhs);
+			}
+
+		private:
+			void read(ContentIt it);
+
+			const Loader* loader = nullptr;
+			//reset once the end marker of the parent was reached
+			Node* parent = nullptr;
+			Node current;
+	};
+
+	class Children {
+		public:
+			Children(const Loader& loader, Node& parent) : loader(loader), parent(parent) {}
+
+			ChildIterator begin() const {
+				return {loader, parent};
+			}
+			ChildIterator end() const {
+				return {};
+			}
+
+		private:
+			const Loader& loader;
+			Node& parent;
+	};
+
 	Loader(const std::string& fileName, const Identifier& acceptedIdentifier);
+
+	//the node tree is read straight from the mapped file, so these are safe to call from any thread
+	Node getRoot() const;
+	Children children(Node& node) const {
+		return {*this, node};
+	}
+
 	bool getProps(const Node& node, PropStream& props);
-	const Node& parseTree();
+	//unescapes the properties of node at the end of buffer, safe to call from any thread
+	static size_t appendProps(const Node& node, std::vector<char>& buffer);
 };
 
 } //namespace OTB
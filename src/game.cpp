@@ -32,8 +32,11 @@
 #include "game.h"
 #include "globalevent.h"
 #include "iologindata.h"
+#include "iomap.h"
+#include "iomapsnapshot.h"
 #include "iomarket.h"
 #include "items.h"
+#include "luaworkers.h"
 #include "monster.h"
 #include "movement.h"
 #include "server.h"
@@ -71,6 +74,9 @@ void Game::start(ServiceManager* manager)
 
 	g_dispatcher().addEvent(EVENT_LIGHTINTERVAL, std::bind(&Game::checkLight, this));
 	g_dispatcher().addEvent(EVENT_CREATURE_THINK_INTERVAL, std::bind(&Game::checkCreatures, this, 0));
+	if (g_config().getNumber(ConfigManager::MAP_WARMUP_SECTORS) > 0) {
+		g_dispatcher().addEvent(EVENT_MAP_WARMUP_INTERVAL, std::bind(&Game::warmupMap, this));
+	}
 }
 
 GameState_t Game::getGameState() const
@@ -187,6 +193,17 @@ void Game::saveGameState()
 	}
 }
 
+void Game::preloadMainMap(const std::string& filename)
+{
+	const std::string fileName = "data/world/" + filename + ".otbm";
+
+	//a current snapshot is loaded instead, the OTBM is not parsed then
+	if (Map::isSnapshotEnabled() && IOMapSnapshot::isCurrent(fileName)) {
+		return;
+	}
+	IOMap::preloadMap(fileName);
+}
+
 bool Game::loadMainMap(const std::string& filename)
 {
 	Monster::despawnRange = g_config().getNumber(ConfigManager::DEFAULT_DESPAWNRANGE);
@@ -199,7 +216,7 @@ void Game::loadMap(const std::string& path)
 	map.loadMap(path, false);
 }
 
-Cylinder* Game::internalGetCylinder(Player* player, const Position& pos) const
+Cylinder* Game::internalGetCylinder(Player* player, const Position& pos)
 {
 	if (pos.x != 0xFFFF) {
 		return map.getTile(pos);
@@ -215,7 +232,7 @@ Cylinder* Game::internalGetCylinder(Player* player, const Position& pos) const
 	return player;
 }
 
-Thing* Game::internalGetThing(Player* player, const Position& pos, int32_t index, uint32_t spriteId, stackPosType_t type) const
+Thing* Game::internalGetThing(Player* player, const Position& pos, int32_t index, uint32_t spriteId, stackPosType_t type)
 {
 	if (pos.x != 0xFFFF) {
 		Tile* tile = map.getTile(pos);
@@ -2381,6 +2398,7 @@ void Game::playerWriteItem(Player* player, uint32_t windowTextId, const std::str
 		writeItem->resetWriter();
 		writeItem->resetDate();
 	}
+	writeItem->notifyTileChanged();
 
 	uint16_t newId = Item::items[writeItem->getID()].writeOnceItemId;
 	if (newId != 0) {
@@ -2961,6 +2979,12 @@ void Game::playerLookAt(Player* player, const Position& pos, uint8_t stackPos)
 		return;
 	}
 
+	//the look event hands the thing to scripts, which may change it or ask for its position
+	Item* item = thing->getItem();
+	if (item && item->isShared()) {
+		thing = map.getTile(pos)->unshareGround();
+	}
+
 	Position thingPos = thing->getPosition();
 	if (!player->canSee(thingPos)) {
 		player->sendCancelMessage(RETURNVALUE_NOTPOSSIBLE);
@@ -3378,12 +3402,12 @@ void Game::playerSpeakToNpc(Player* player, const std::string& text)
 
 //--
 bool Game::canThrowObjectTo(const Position& fromPos, const Position& toPos, bool checkLineOfSight /*= true*/,
-                            int32_t rangex /*= Map::maxClientViewportX*/, int32_t rangey /*= Map::maxClientViewportY*/) const
+                            int32_t rangex /*= Map::maxClientViewportX*/, int32_t rangey /*= Map::maxClientViewportY*/)
 {
 	return map.canThrowObjectTo(fromPos, toPos, checkLineOfSight, rangex, rangey);
 }
 
-bool Game::isSightClear(const Position& fromPos, const Position& toPos, bool floorCheck) const
+bool Game::isSightClear(const Position& fromPos, const Position& toPos, bool floorCheck)
 {
 	return map.isSightClear(fromPos, toPos, floorCheck);
 }
@@ -3449,26 +3473,26 @@ bool Game::internalCreatureSay(Creature* creature, SpeakClasses type, const std:
 	return true;
 }
 
-void Game::checkCreatureWalk(uint32_t creatureId)
+void Game::checkCreatureWalk(CreatureHandle handle)
 {
-	Creature* creature = getCreatureByID(creatureId);
+	Creature* creature = getCreatureByHandle(handle);
 	if (creature && creature->getHealth() > 0) {
 		creature->onWalk();
 		cleanup();
 	}
 }
 
-void Game::updateCreatureWalk(uint32_t creatureId)
+void Game::updateCreatureWalk(CreatureHandle handle)
 {
-	Creature* creature = getCreatureByID(creatureId);
+	Creature* creature = getCreatureByHandle(handle);
 	if (creature && creature->getHealth() > 0) {
 		creature->goToFollowCreature();
 	}
 }
 
-void Game::checkCreatureAttack(uint32_t creatureId)
+void Game::checkCreatureAttack(CreatureHandle handle)
 {
-	Creature* creature = getCreatureByID(creatureId);
+	Creature* creature = getCreatureByHandle(handle);
 	if (creature && creature->getHealth() > 0) {
 		creature->onAttacking(0);
 	}
@@ -3797,7 +3821,7 @@ bool Game::combatChangeHealth(Creature* attacker, Creature* target, CombatDamage
 			message.primary.color = COLOR_PASTELRED;
 
 			SpectatorVector spectators;
-			map.getSpectators(spectators, targetPos, false, true);
+			getCombatSpectators(spectators, targetPos, false);
 			for (Creature* spectator : spectators) {
 				Player* tmpPlayer = spectator->getPlayer();
 				if (tmpPlayer == attackerPlayer && attackerPlayer != targetPlayer) {
@@ -3911,7 +3935,7 @@ bool Game::combatChangeHealth(Creature* attacker, Creature* target, CombatDamage
 				}
 
 				targetPlayer->drainMana(attacker, manaDamage);
-				map.getSpectators(spectators, targetPos, true, true);
+				getCombatSpectators(spectators, targetPos, true);
 				addMagicEffect(spectators, targetPos, CONST_ME_LOSEENERGY);
 
 				std::stringstream ss;
@@ -4005,7 +4029,7 @@ bool Game::combatChangeHealth(Creature* attacker, Creature* target, CombatDamage
 		}
 
 		if (spectators.empty()) {
-			map.getSpectators(spectators, targetPos, true, true);
+			getCombatSpectators(spectators, targetPos, true);
 		}
 
 		message.primary.value = damage.primary.value;
@@ -4095,11 +4119,15 @@ bool Game::combatChangeHealth(Creature* attacker, Creature* target, CombatDamage
 			}
 
 			//Dispatch creature death event to the first safe cpu cycle
-			g_dispatcher().addTask(std::bind(&Game::checkCreatureDeath, this, target->getID()));
+			g_dispatcher().addTask(std::bind(&Game::checkCreatureDeath, this, target->getHandle()));
 		}
 
 		target->drainHealth(attacker, realDamage);
-		addCreatureHealth(spectators, target);
+		if (combatBatch.depth != 0) {
+			combatBatch.healthUpdates.push_back(target->getID());
+		} else {
+			addCreatureHealth(spectators, target);
+		}
 	}
 
 	return true;
@@ -4199,7 +4227,7 @@ bool Game::combatChangeMana(Creature* attacker, Creature* target, CombatDamage&
 		message.primary.color = COLOR_BLUE;
 
 		SpectatorVector spectators;
-		map.getSpectators(spectators, targetPos, false, true);
+		getCombatSpectators(spectators, targetPos, false);
 		for (Creature* spectator : spectators) {
 			Player* tmpPlayer = spectator->getPlayer();
 			if (tmpPlayer == attackerPlayer && attackerPlayer != targetPlayer) {
@@ -4244,14 +4272,101 @@ bool Game::combatChangeMana(Creature* attacker, Creature* target, CombatDamage&
 	return true;
 }
 
+void Game::beginCombatBatch(const SpectatorVector& spectators, const Position& centerPos, int32_t rangeX, int32_t rangeY)
+{
+	if (combatBatch.depth++ != 0) {
+		//nested area combat (e.g. cast from a script) joins the outer batch
+		return;
+	}
+
+	combatBatch.centerPos = centerPos;
+	combatBatch.rangeX = rangeX;
+	combatBatch.rangeY = rangeY;
+	combatBatch.spectators = spectators;
+}
+
+void Game::endCombatBatch()
+{
+	if (--combatBatch.depth != 0) {
+		return;
+	}
+
+	std::vector<uint32_t> healthUpdates = std::move(combatBatch.healthUpdates);
+	combatBatch.healthUpdates.clear();
+	if (healthUpdates.empty()) {
+		return;
+	}
+
+	std::sort(healthUpdates.begin(), healthUpdates.end());
+	healthUpdates.erase(std::unique(healthUpdates.begin(), healthUpdates.end()), healthUpdates.end());
+
+	std::vector<std::pair<const Creature*, uint8_t>> targets;
+	targets.reserve(healthUpdates.size());
+	for (uint32_t creatureId : healthUpdates) {
+		const Creature* target = getCreatureByID(creatureId);
+		if (!target || target->isRemoved()) {
+			continue;
+		}
+
+		if (!combatBatch.covers(target->getPosition())) {
+			//moved away while the batch was open (teleported by a script), fall back to a regular update
+			addCreatureHealth(target);
+			continue;
+		}
+		targets.emplace_back(target, updatePartyHealth(target));
+	}
+
+	for (Creature* spectator : combatBatch.spectators) {
+		Player* tmpPlayer = spectator->getPlayer();
+		if (!tmpPlayer || tmpPlayer->isRemoved()) {
+			continue;
+		}
+
+		const Position& spectatorPos = tmpPlayer->getPosition();
+		for (const auto& it : targets) {
+			if (Creature::canSee(spectatorPos, it.first->getPosition(), Map::maxViewportX, Map::maxViewportY)) {
+				tmpPlayer->sendCreatureHealth(it.first, it.second);
+			}
+		}
+	}
+}
+
+void Game::getCombatSpectators(SpectatorVector& spectators, const Position& pos, bool multifloor)
+{
+	if (combatBatch.depth == 0 || !combatBatch.covers(pos)) {
+		map.getSpectators(spectators, pos, multifloor, true);
+		return;
+	}
+
+	for (Creature* spectator : combatBatch.spectators) {
+		if (spectator->isRemoved()) {
+			continue;
+		}
+
+		const Position& spectatorPos = spectator->getPosition();
+		if (!multifloor && spectatorPos.z != pos.z) {
+			continue;
+		}
+
+		if (Creature::canSee(spectatorPos, pos, Map::maxViewportX, Map::maxViewportY)) {
+			spectators.emplace_back(spectator);
+		}
+	}
+}
+
 void Game::addCreatureHealth(const Creature* target)
 {
+	if (combatBatch.depth != 0) {
+		combatBatch.healthUpdates.push_back(target->getID());
+		return;
+	}
+
 	SpectatorVector spectators;
 	map.getSpectators(spectators, target->getPosition(), true, true);
 	addCreatureHealth(spectators, target);
 }
 
-void Game::addCreatureHealth(const SpectatorVector& spectators, const Creature* target)
+uint8_t Game::updatePartyHealth(const Creature* target)
 {
 	uint8_t healthPercent = std::ceil((static_cast<double>(target->getHealth()) / std::max<int32_t>(target->getMaxHealth(), 1)) * 100);
 	#if GAME_FEATURE_PARTY_LIST > 0
@@ -4267,7 +4382,12 @@ void Game::addCreatureHealth(const SpectatorVector& spectators, const Creature*
 		}
 	}
 	#endif
+	return healthPercent;
+}
 
+void Game::addCreatureHealth(const SpectatorVector& spectators, const Creature* target)
+{
+	uint8_t healthPercent = updatePartyHealth(target);
 	for (Creature* spectator : spectators) {
 		if (Player* tmpPlayer = spectator->getPlayer()) {
 			tmpPlayer->sendCreatureHealth(target, healthPercent);
@@ -4288,7 +4408,7 @@ void Game::addPlayerMana(const Player* target)
 void Game::addMagicEffect(const Position& pos, uint8_t effect)
 {
 	SpectatorVector spectators;
-	map.getSpectators(spectators, pos, true, true);
+	getCombatSpectators(spectators, pos, true);
 	addMagicEffect(spectators, pos, effect);
 }
 
@@ -4395,6 +4515,14 @@ void Game::internalDecayItem(Item* item)
 	}
 }
 
+void Game::warmupMap()
+{
+	//sectors of a lazily loaded map are built a few at a time, item creation has to stay on the dispatcher
+	if (map.loadPendingSectors(g_config().getNumber(ConfigManager::MAP_WARMUP_SECTORS)) != 0) {
+		g_dispatcher().addEvent(EVENT_MAP_WARMUP_INTERVAL, std::bind(&Game::warmupMap, this));
+	}
+}
+
 void Game::checkLight()
 {
 	g_dispatcher().addEvent(EVENT_LIGHTINTERVAL, std::bind(&Game::checkLight, this));
@@ -4463,6 +4591,7 @@ void Game::shutdown()
 {
 	std::cout << "Shutting down..." << std::flush;
 
+	g_luaWorkers().shutdown();
 	g_databaseTasks().shutdown();
 	g_dispatcher().shutdown();
 	map.spawns.clear();
@@ -5417,9 +5546,9 @@ void Game::updatePlayerEvent(uint32_t playerId)
 	player->resetScheduledUpdates();
 }
 
-void Game::checkCreatureDeath(uint32_t creatureId)
+void Game::checkCreatureDeath(CreatureHandle handle)
 {
-	Creature* creature = getCreatureByID(creatureId);
+	Creature* creature = getCreatureByHandle(handle);
 	if (!creature) {
 		return;
 	}
@@ -5435,6 +5564,7 @@ void Game::addPlayer(Player* player)
 	mappedPlayerNames[lowercase_name] = player;
 	wildcardTree.insert(lowercase_name);
 	players[player->getID()] = player;
+	player->handle = creatureHandles.add(player);
 }
 
 void Game::removePlayer(Player* player)
@@ -5443,26 +5573,34 @@ void Game::removePlayer(Player* player)
 	mappedPlayerNames.erase(lowercase_name);
 	wildcardTree.remove(lowercase_name);
 	players.erase(player->getID());
+	creatureHandles.remove(player->handle);
+	player->handle = 0;
 }
 
 void Game::addNpc(Npc* npc)
 {
 	npcs[npc->getID()] = npc;
+	npc->handle = creatureHandles.add(npc);
 }
 
 void Game::removeNpc(Npc* npc)
 {
 	npcs.erase(npc->getID());
+	creatureHandles.remove(npc->handle);
+	npc->handle = 0;
 }
 
 void Game::addMonster(Monster* monster)
 {
 	monsters[monster->getID()] = monster;
+	monster->handle = creatureHandles.add(monster);
 }
 
 void Game::removeMonster(Monster* monster)
 {
 	monsters.erase(monster->getID());
+	creatureHandles.remove(monster->handle);
+	monster->handle = 0;
 }
 
 Guild* Game::getGuild(uint32_t id) const
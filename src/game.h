@@ -72,6 +72,7 @@ enum LightState_t {
 };
 
 static constexpr int32_t EVENT_LIGHTINTERVAL = 10000;
+static constexpr int32_t EVENT_MAP_WARMUP_INTERVAL = 1000;
 
 /**
   * Main Game class.
@@ -99,6 +100,7 @@ class Game
 		void forceAddCondition(uint32_t creatureId, Condition* condition);
 		void forceRemoveCondition(uint32_t creatureId, ConditionType_t type);
 
+		void preloadMainMap(const std::string& filename);
 		bool loadMainMap(const std::string& filename);
 		void loadMap(const std::string& path);
 
@@ -117,9 +119,9 @@ class Game
 			return worldType;
 		}
 
-		Cylinder* internalGetCylinder(Player* player, const Position& pos) const;
+		Cylinder* internalGetCylinder(Player* player, const Position& pos);
 		Thing* internalGetThing(Player* player, const Position& pos, int32_t index,
-		                        uint32_t spriteId, stackPosType_t type) const;
+		                        uint32_t spriteId, stackPosType_t type);
 		static void internalGetPosition(Item* item, Position& pos, uint8_t& stackpos);
 
 		static std::string getTradeErrorDescription(ReturnValue ret, Item* item);
@@ -131,6 +133,15 @@ class Game
 		  */
 		Creature* getCreatureByID(uint32_t id);
 
+		/**
+		  * Returns a creature based on a handle from Creature::getHandle
+		  * \param handle of the creature, handles of removed creatures resolve to nullptr
+		  * \returns A Creature pointer to the creature
+		  */
+		Creature* getCreatureByHandle(CreatureHandle handle) const {
+			return creatureHandles.get(handle);
+		}
+
 		/**
 		  * Returns a monster based on the unique creature identifier
 		  * \param id is the unique monster id to get a monster pointer to
@@ -325,7 +336,7 @@ class Game
 		void playerReportRuleViolation(Player* player, const std::string& targetName, uint8_t reportType, uint8_t reportReason, const std::string& comment, const std::string& translation);
 
 		void updatePlayerEvent(uint32_t playerId);
-		void checkCreatureDeath(uint32_t creatureId);
+		void checkCreatureDeath(CreatureHandle handle);
 
 		void playerMonsterCyclopedia(Player* player);
 		void playerCyclopediaMonsters(Player* player, const std::string& race);
@@ -443,8 +454,8 @@ class Game
 		void ReleaseItem(Item* item);
 
 		bool canThrowObjectTo(const Position& fromPos, const Position& toPos, bool checkLineOfSight = true,
-		                      int32_t rangex = Map::maxClientViewportX, int32_t rangey = Map::maxClientViewportY) const;
-		bool isSightClear(const Position& fromPos, const Position& toPos, bool floorCheck) const;
+		                      int32_t rangex = Map::maxClientViewportX, int32_t rangey = Map::maxClientViewportY);
+		bool isSightClear(const Position& fromPos, const Position& toPos, bool floorCheck);
 
 		void changeSpeed(Creature* creature, int32_t varSpeedDelta);
 		void internalCreatureChangeOutfit(Creature* creature, const Outfit_t& outfit);
@@ -459,11 +470,12 @@ class Game
 		void saveGameState();
 
 		//Events
-		void checkCreatureWalk(uint32_t creatureId);
-		void updateCreatureWalk(uint32_t creatureId);
-		void checkCreatureAttack(uint32_t creatureId);
+		void checkCreatureWalk(CreatureHandle handle);
+		void updateCreatureWalk(CreatureHandle handle);
+		void checkCreatureAttack(CreatureHandle handle);
 		void checkCreatures(size_t index);
 		void checkLight();
+		void warmupMap();
 
 		bool combatBlockHit(CombatDamage& damage, Creature* attacker, Creature* target, bool checkDefense, bool checkArmor, bool field);
 
@@ -477,6 +489,12 @@ class Game
 		bool combatChangeHealth(Creature* attacker, Creature* target, CombatDamage& damage);
 		bool combatChangeMana(Creature* attacker, Creature* target, CombatDamage& damage);
 
+		// Area combat batching: while a batch is open, combat visuals reuse one spectator scan
+		// and health bars are sent once per creature when the outermost batch ends
+		void beginCombatBatch(const SpectatorVector& spectators, const Position& centerPos, int32_t rangeX, int32_t rangeY);
+		void endCombatBatch();
+		void getCombatSpectators(SpectatorVector& spectators, const Position& pos, bool multifloor);
+
 		//animation help functions
 		void addCreatureHealth(const Creature* target);
 		static void addCreatureHealth(const SpectatorVector& spectators, const Creature* target);
@@ -556,10 +574,29 @@ class Game
 		bool playerSpeakTo(Player* player, SpeakClasses type, const std::string& receiver, const std::string& text);
 		void playerSpeakToNpc(Player* player, const std::string& text);
 
+		static uint8_t updatePartyHealth(const Creature* target);
+
+		struct CombatBatch {
+			bool covers(const Position& pos) const {
+				return pos.z == centerPos.z &&
+					Position::getDistanceX(pos, centerPos) + Map::maxViewportX <= rangeX &&
+					Position::getDistanceY(pos, centerPos) + Map::maxViewportY <= rangeY;
+			}
+
+			SpectatorVector spectators;
+			std::vector<uint32_t> healthUpdates;
+			Position centerPos;
+			int32_t rangeX = 0;
+			int32_t rangeY = 0;
+			uint32_t depth = 0;
+		};
+		CombatBatch combatBatch;
+
 		std::unordered_map<uint32_t, Player*> players;
 		std::unordered_map<std::string, Player*> mappedPlayerNames;
 		std::unordered_map<uint32_t, Npc*> npcs;
 		std::unordered_map<uint32_t, Monster*> monsters;
+		CreatureHandleTable creatureHandles;
 		std::unordered_map<uint32_t, Guild*> guilds;
 		std::unordered_map<uint16_t, Item*> uniqueItems;
 		std::map<uint32_t, uint32_t> stages;
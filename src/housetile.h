@@ -39,14 +39,32 @@ class HouseTile final : public DynamicTile
 		void addThing(int32_t index, Thing* thing) override;
 		void internalAddThing(uint32_t index, Thing* thing) override;
 
+		void onItemsChanged() override {
+			itemsChanged = true;
+		}
+
 		House* getHouse() {
 			return house;
 		}
 
+		bool hasItemsChanged() const {
+			return itemsChanged;
+		}
+		size_t getSavedItemsHash() const {
+			return savedItemsHash;
+		}
+		void setItemsSaved(size_t hash) {
+			itemsChanged = false;
+			savedItemsHash = hash;
+		}
+
 	private:
 		void updateHouse(Item* item);
 
 		House* house;
+		//hash of the item data stored in tile_store, 0 if the tile has no row
+		size_t savedItemsHash = 0;
+		bool itemsChanged = false;
 };
 
 #endif
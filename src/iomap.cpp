@@ -22,6 +22,8 @@
 #include "iomap.h"
 #include "bed.h"
 
+#include <future>
+
 #ifdef __cpp_lib_filesystem
 #include <filesystem>
 namespace fs = std::filesystem;
@@ -54,12 +56,48 @@ namespace fs = boost::filesystem;
 	|--- OTBM_ITEM_DEF (not implemented)
 */
 
+namespace {
+
+std::string preloadedFileName;
+std::future<std::unique_ptr<OTB::Loader>> preloadedLoader;
+
+std::unique_ptr<OTB::Loader> takePreloadedLoader(const std::string& fileName)
+{
+	if (!preloadedLoader.valid() || preloadedFileName != fileName) {
+		return nullptr;
+	}
+
+	//rethrows whatever the worker failed with, same as reading the file here
+	return preloadedLoader.get();
+}
+
+}
+
+void IOMap::preloadMap(const std::string& fileName)
+{
+	if (!fs::exists(fileName)) {
+		return;
+	}
+
+	preloadedFileName = fileName;
+	preloadedLoader = std::async(std::launch::async, [fileName]() {
+		std::unique_ptr<OTB::Loader> loader(new OTB::Loader{fileName, OTB::Identifier{{'O', 'T', 'B', 'M'}}});
+		//walking the nodes once checks their structure and faults the mapped pages in
+		OTB::Node root = loader->getRoot();
+		auto children = loader->children(root);
+		for (auto it = children.begin(); it != children.end(); ++it) {}
+		return loader;
+	});
+}
+
 Tile* IOMap::createTile(Item*& ground, Item* item, uint16_t x, uint16_t y, uint8_t z)
 {
 	if (!ground) {
 		return new StaticTile(x, y, z);
 	}
 
+	ground = Item::toSharedItem(ground);
+
 	Tile* tile;
 	if ((item && item->isBlocking()) || ground->isBlocking()) {
 		tile = new StaticTile(x, y, z);
@@ -68,12 +106,14 @@ Tile* IOMap::createTile(Item*& ground, Item* item, uint16_t x, uint16_t y, uint8
 	}
 
 	tile->internalAddThing(ground);
-	ground->startDecaying();
+	if (!ground->isShared()) {
+		ground->startDecaying();
+	}
 	ground = nullptr;
 	return tile;
 }
 
-bool IOMap::loadMap(Map* map, const std::string& fileName)
+bool IOMap::loadMap(Map* map, const std::string& fileName, bool lazy /* = false*/)
 {
 	if (!fs::exists(fileName)) {
 		setLastErrorString("Failed to load " + fileName + ": File doesn't exist.");
@@ -81,8 +121,13 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
 	}
 
 	int64_t start = OTSYS_TIME();
-	OTB::Loader loader{fileName, OTB::Identifier{{'O', 'T', 'B', 'M'}}};
-	auto& root = loader.parseTree();
+	std::unique_ptr<OTB::Loader> loaderPtr = takePreloadedLoader(fileName);
+	if (!loaderPtr) {
+		loaderPtr.reset(new OTB::Loader{fileName, OTB::Identifier{{'O', 'T', 'B', 'M'}}});
+	}
+
+	OTB::Loader& loader = *loaderPtr;
+	OTB::Node root = loader.getRoot();
 
 	PropStream propStream;
 	if (!loader.getProps(root, propStream)) {
@@ -115,21 +160,23 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
 	
 	spdlog::info("Map size: {} x {}.", map->width, map->height);
 
-	if (root.children.size() != 1 || root.children[0].type != OTBM_MAP_DATA) {
+	auto rootChildren = loader.children(root);
+	auto mapNodeIt = rootChildren.begin();
+	if (mapNodeIt == rootChildren.end() || mapNodeIt->type != OTBM_MAP_DATA) {
 		setLastErrorString("Could not read data node.");
 		return false;
 	}
 
-	auto& mapNode = root.children[0];
+	OTB::Node& mapNode = *mapNodeIt;
 	if (!parseMapDataAttributes(loader, mapNode, *map, fileName)) {
 		return false;
 	}
 
-	for (auto& mapDataNode : mapNode.children) {
+	//tile areas are only located here, their contents are read by the decoding threads
+	std::vector<OTB::Node> tileAreaNodes;
+	for (auto& mapDataNode : loader.children(mapNode)) {
 		if (mapDataNode.type == OTBM_TILE_AREA) {
-			if (!parseTileArea(loader, mapDataNode, *map, (headerVersion == 0))) {
-				return false;
-			}
+			tileAreaNodes.push_back(mapDataNode);
 		} else if (mapDataNode.type == OTBM_TOWNS) {
 			if (!parseTowns(loader, mapDataNode, *map)) {
 				return false;
@@ -144,7 +191,60 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
 		}
 	}
 
+	if (++mapNodeIt != rootChildren.end()) {
+		setLastErrorString("Could not read data node.");
+		return false;
+	}
+	int64_t treeTime = OTSYS_TIME() - start;
+
+	//tile areas are decoded in batches so only a slice of the map is held twice in memory,
+	//creating the items and tiles stays serial as it registers decay, unique ids and houses
+	const bool legacy = headerVersion == 0;
+	map->pendingSectorsLegacy = legacy;
+	int64_t decodeTime = 0;
+	int64_t tilesTime = 0;
+	std::vector<StagedTileArea> areas;
+	for (size_t first = 0; first < tileAreaNodes.size(); first += IOMAP_STAGED_TILE_AREAS) {
+		int64_t batchStart = OTSYS_TIME();
+		int32_t batchSize = static_cast<int32_t>(std::min<size_t>(IOMAP_STAGED_TILE_AREAS, tileAreaNodes.size() - first));
+		areas.clear();
+		areas.resize(batchSize);
+
+		#pragma omp parallel for schedule(dynamic, 16)
+		for (int32_t i = 0; i < batchSize; ++i) {
+			decodeTileArea(loader, tileAreaNodes[first + i], areas[i]);
+		}
+
+		int64_t decodeEnd = OTSYS_TIME();
+		decodeTime += decodeEnd - batchStart;
+
+		StagedTileArea eager;
+		for (const StagedTileArea& area : areas) {
+			if (!area.error.empty()) {
+				setLastErrorString(area.error);
+				return false;
+			}
+
+			if (lazy) {
+				stageLazyTileArea(area, *map, eager);
+			} else if (!parseTileArea(area, *map, legacy)) {
+				return false;
+			}
+		}
+
+		if (lazy && !parseTileArea(eager, *map, legacy)) {
+			return false;
+		}
+		tilesTime += OTSYS_TIME() - decodeEnd;
+	}
+
+	if (lazy) {
+		spdlog::info("{} map sectors are left to be loaded on first use.", map->pendingSectors.size());
+	}
+
 	spdlog::info("Map loading time: {} seconds.", (OTSYS_TIME() - start) / (1000.));
+	spdlog::info("Map loading phases: nodes located in {} seconds, tile areas decoded in {} seconds, tiles built in {} seconds.",
+		treeTime / (1000.), decodeTime / (1000.), tilesTime / (1000.));
 	return true;
 }
 
@@ -197,43 +297,207 @@ bool IOMap::parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode
 	return true;
 }
 
-bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Map& map, bool _legacy)
+void IOMap::decodeTileArea(const OTB::Loader& loader, OTB::Node tileAreaNode, StagedTileArea& area)
 {
-	PropStream propStream;
-	if (!loader.getProps(tileAreaNode, propStream)) {
-		setLastErrorString("Invalid map node.");
-		return false;
+	//exceptions can not leave the decoding threads
+	try {
+		decodeTileNodes(loader, tileAreaNode, area);
+	} catch (const std::exception& e) {
+		area.error = e.what();
+	} catch (...) {
+		area.error = "Unknown error while decoding a tile area.";
+	}
+}
+
+void IOMap::decodeTileNodes(const OTB::Loader& loader, OTB::Node& tileAreaNode, StagedTileArea& area)
+{
+	std::vector<char>& buffer = area.buffer;
+	size_t size = OTB::Loader::appendProps(tileAreaNode, buffer);
+	if (size == 0) {
+		area.error = "Invalid map node.";
+		return;
 	}
 
+	PropStream propStream;
+	propStream.init(&buffer[0], size);
+
 	OTBM_Destination_coords area_coord;
 	if (!propStream.read(area_coord)) {
-		setLastErrorString("Invalid map node.");
-		return false;
+		area.error = "Invalid map node.";
+		return;
 	}
+	buffer.clear();
 
 	uint16_t base_x = area_coord.x;
 	uint16_t base_y = area_coord.y;
 	uint16_t z = area_coord.z;
 
-	for (auto& tileNode : tileAreaNode.children) {
+	for (auto& tileNode : loader.children(tileAreaNode)) {
 		if (tileNode.type != OTBM_TILE && tileNode.type != OTBM_HOUSETILE) {
-			setLastErrorString("Unknown tile node.");
-			return false;
+			area.error = "Unknown tile node.";
+			return;
 		}
 
-		if (!loader.getProps(tileNode, propStream)) {
-			setLastErrorString("Could not read node data.");
-			return false;
+		size_t propsBegin = buffer.size();
+		size = OTB::Loader::appendProps(tileNode, buffer);
+		if (size == 0) {
+			area.error = "Could not read node data.";
+			return;
 		}
 
+		propStream.init(&buffer[propsBegin], size);
+
 		OTBM_Tile_coords tile_coord;
 		if (!propStream.read(tile_coord)) {
-			setLastErrorString("Could not read tile position.");
+			area.error = "Could not read tile position.";
+			return;
+		}
+
+		StagedTile tile;
+		tile.x = base_x + tile_coord.x;
+		tile.y = base_y + tile_coord.y;
+		tile.z = area_coord.z;
+		tile.isHouseTile = tileNode.type == OTBM_HOUSETILE;
+		tile.houseId = 0;
+
+		if (tile.isHouseTile && !propStream.read<uint32_t>(tile.houseId)) {
+			std::ostringstream ss;
+			ss << "[x:" << tile.x << ", y:" << tile.y << ", z:" << z << "] Could not read house id.";
+			area.error = ss.str();
+			return;
+		}
+
+		tile.propsBegin = buffer.size() - propStream.size();
+		tile.propsEnd = buffer.size();
+		tile.itemsBegin = area.items.size();
+
+		for (auto& itemNode : loader.children(tileNode)) {
+			if (itemNode.type != OTBM_ITEM) {
+				std::ostringstream ss;
+				ss << "[x:" << tile.x << ", y:" << tile.y << ", z:" << z << "] Unknown node type.";
+				area.error = ss.str();
+				return;
+			}
+
+			if (!decodeItem(loader, itemNode, area)) {
+				area.error = "Invalid item node.";
+				return;
+			}
+		}
+
+		tile.itemsEnd = area.items.size();
+		area.tiles.push_back(tile);
+	}
+}
+
+bool IOMap::decodeItem(const OTB::Loader& loader, OTB::Node& itemNode, StagedTileArea& area)
+{
+	size_t index = area.items.size();
+	size_t propsBegin = area.buffer.size();
+	if (OTB::Loader::appendProps(itemNode, area.buffer) == 0) {
+		return false;
+	}
+	area.items.push_back({propsBegin, area.buffer.size(), 0});
+
+	//container contents
+	for (auto& childNode : loader.children(itemNode)) {
+		if (childNode.type != OTBM_ITEM || !decodeItem(loader, childNode, area)) {
 			return false;
 		}
+	}
+
+	area.items[index].subtreeEnd = area.items.size();
+	return true;
+}
+
+void IOMap::appendStagedTile(StagedTileArea& target, const StagedTileArea& source, const StagedTile& tile)
+{
+	//the attributes of a tile and its items are stored back to back
+	size_t begin = tile.propsBegin;
+	size_t end = tile.itemsEnd != tile.itemsBegin ? source.items[tile.itemsEnd - 1].propsEnd : tile.propsEnd;
+	size_t base = target.buffer.size();
+	target.buffer.insert(target.buffer.end(), source.buffer.begin() + begin, source.buffer.begin() + end);
+
+	StagedTile staged = tile;
+	staged.propsBegin = base;
+	staged.propsEnd = tile.propsEnd - begin + base;
+	staged.itemsBegin = target.items.size();
+	for (size_t i = tile.itemsBegin; i < tile.itemsEnd; ++i) {
+		const StagedItem& item = source.items[i];
+		target.items.push_back({item.propsBegin - begin + base, item.propsEnd - begin + base, item.subtreeEnd - tile.itemsBegin + staged.itemsBegin});
+	}
+	staged.itemsEnd = target.items.size();
+	target.tiles.push_back(staged);
+}
+
+void IOMap::stageLazyTileArea(const StagedTileArea& area, Map& map, StagedTileArea& eager)
+{
+	for (const StagedTile& tile : area.tiles) {
+		//houses need their tiles right away, sectors already built take the rest of their tiles too
+		uint32_t index = (tile.x / SECTOR_SIZE) | ((tile.y / SECTOR_SIZE) << 16);
+		if (tile.isHouseTile || map.mapSectors.find(index) != map.mapSectors.end()) {
+			appendStagedTile(eager, area, tile);
+			continue;
+		}
+
+		std::unique_ptr<StagedTileArea>& sector = map.pendingSectors[index];
+		if (!sector) {
+			sector.reset(new StagedTileArea());
+		}
+		appendStagedTile(*sector, area, tile);
+	}
+}
 
-		uint16_t x = base_x + tile_coord.x;
-		uint16_t y = base_y + tile_coord.y;
+bool IOMap::loadPendingSector(Map& map, const StagedTileArea& sector, bool _legacy)
+{
+	IOMap loader;
+	if (!loader.parseTileArea(sector, map, _legacy)) {
+		spdlog::error("[IOMap::loadPendingSector] {}", loader.getLastErrorString());
+		return false;
+	}
+	return true;
+}
+
+bool IOMap::loadStagedItem(Item* item, PropStream& propStream, const StagedTileArea& area, size_t index, bool _legacy)
+{
+	if (!item->unserializeAttr(propStream)) {
+		return false;
+	}
+
+	//only containers read the nested items
+	Container* container = item->getContainer();
+	if (!container) {
+		return true;
+	}
+
+	for (size_t child = index + 1, end = area.items[index].subtreeEnd; child < end; child = area.items[child].subtreeEnd) {
+		const StagedItem& stagedItem = area.items[child];
+
+		PropStream stream;
+		stream.init(area.buffer.data() + stagedItem.propsBegin, stagedItem.propsEnd - stagedItem.propsBegin);
+
+		Item* childItem = (_legacy ? Item::CreateItem_legacy(stream) : Item::CreateItem(stream));
+		if (!childItem) {
+			return false;
+		}
+
+		if (!loadStagedItem(childItem, stream, area, child, _legacy)) {
+			delete childItem;
+			return false;
+		}
+
+		container->addItemBack(childItem);
+	}
+	return true;
+}
+
+bool IOMap::parseTileArea(const StagedTileArea& area, Map& map, bool _legacy)
+{
+	PropStream propStream;
+	for (const StagedTile& stagedTile : area.tiles) {
+		uint16_t x = stagedTile.x;
+		uint16_t y = stagedTile.y;
+		uint16_t z = stagedTile.z;
 
 		bool isHouseTile = false;
 		House* house = nullptr;
@@ -241,15 +505,8 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 		Item* ground_item = nullptr;
 		uint32_t tileflags = TILESTATE_NONE;
 
-		if (tileNode.type == OTBM_HOUSETILE) {
-			uint32_t houseId;
-			if (!propStream.read<uint32_t>(houseId)) {
-				std::ostringstream ss;
-				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not read house id.";
-				setLastErrorString(ss.str());
-				return false;
-			}
-
+		if (stagedTile.isHouseTile) {
+			uint32_t houseId = stagedTile.houseId;
 			house = map.houses.addHouse(houseId);
 			if (!house) {
 				std::ostringstream ss;
@@ -263,6 +520,8 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 			isHouseTile = true;
 		}
 
+		propStream.init(area.buffer.data() + stagedTile.propsBegin, stagedTile.propsEnd - stagedTile.propsBegin);
+
 		uint8_t attribute;
 		//read tile attributes
 		while (propStream.read<uint8_t>(attribute)) {
@@ -339,19 +598,11 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 			}
 		}
 
-		for (auto& itemNode : tileNode.children) {
-			if (itemNode.type != OTBM_ITEM) {
-				std::ostringstream ss;
-				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Unknown node type.";
-				setLastErrorString(ss.str());
-				return false;
-			}
+		for (size_t i = stagedTile.itemsBegin; i < stagedTile.itemsEnd; i = area.items[i].subtreeEnd) {
+			const StagedItem& stagedItem = area.items[i];
 
 			PropStream stream;
-			if (!loader.getProps(itemNode, stream)) {
-				setLastErrorString("Invalid item node.");
-				return false;
-			}
+			stream.init(area.buffer.data() + stagedItem.propsBegin, stagedItem.propsEnd - stagedItem.propsBegin);
 
 			Item* item = (_legacy ? Item::CreateItem_legacy(stream) : Item::CreateItem(stream));
 			if (!item) {
@@ -361,7 +612,7 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 				return false;
 			}
 
-			if (!item->unserializeItemNode(loader, itemNode, stream, _legacy)) {
+			if (!loadStagedItem(item, stream, area, i, _legacy)) {
 				std::ostringstream ss;
 				ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to load item " << item->getID() << '.';
 				setLastErrorString(ss.str());
@@ -411,9 +662,9 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
 	return true;
 }
 
-bool IOMap::parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map)
+bool IOMap::parseTowns(OTB::Loader& loader, OTB::Node& townsNode, Map& map)
 {
-	for (auto& townNode : townsNode.children) {
+	for (auto& townNode : loader.children(townsNode)) {
 		PropStream propStream;
 		if (townNode.type != OTBM_TOWN) {
 			setLastErrorString("Unknown town node.");
@@ -457,10 +708,10 @@ bool IOMap::parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map
 }
 
 
-bool IOMap::parseWaypoints(OTB::Loader& loader, const OTB::Node& waypointsNode, Map& map)
+bool IOMap::parseWaypoints(OTB::Loader& loader, OTB::Node& waypointsNode, Map& map)
 {
 	PropStream propStream;
-	for (auto& node : waypointsNode.children) {
+	for (auto& node : loader.children(waypointsNode)) {
 		if (node.type != OTBM_WAYPOINT) {
 			setLastErrorString("Unknown waypoint node.");
 			return false;
@@ -100,12 +100,53 @@ struct OTBM_Tile_coords {
 
 #pragma pack()
 
+//Tile area nodes decoded in parallel before their tiles are built
+static constexpr size_t IOMAP_STAGED_TILE_AREAS = 4096;
+
+struct StagedItem {
+	size_t propsBegin;
+	size_t propsEnd;
+	//the contained items follow in pre-order up to this index
+	size_t subtreeEnd;
+};
+
+struct StagedTile {
+	uint16_t x;
+	uint16_t y;
+	uint8_t z;
+	bool isHouseTile;
+	uint32_t houseId;
+	//tile attributes left after the coordinates and house id
+	size_t propsBegin;
+	size_t propsEnd;
+	size_t itemsBegin;
+	size_t itemsEnd;
+};
+
+//unescaped properties of decoded tiles, offsets index into buffer
+struct StagedTileArea {
+	std::vector<char> buffer;
+	std::vector<StagedTile> tiles;
+	std::vector<StagedItem> items;
+	std::string error;
+};
+
 class IOMap
 {
 	static Tile* createTile(Item*& ground, Item* item, uint16_t x, uint16_t y, uint8_t z);
 
 	public:
-		bool loadMap(Map* map, const std::string& fileName);
+		/**
+		  * Loads an OTBM file into map.
+		  * \param lazy keep the tiles outside of houses staged per sector until the sector is first used
+		  */
+		bool loadMap(Map* map, const std::string& fileName, bool lazy = false);
+
+		/**
+		  * Maps an OTBM file and walks its nodes on a worker thread while the rest of the server starts,
+		  * loadMap of the same file picks the mapping up with its pages already read in.
+		  */
+		static void preloadMap(const std::string& fileName);
 
 		/* Load the spawns
 		 * \param map pointer to the Map class
@@ -145,11 +186,25 @@ class IOMap
 			errorString = error;
 		}
 
+		/**
+		  * Builds the tiles of a sector that was left pending by a lazy map load.
+		  * \returns false if the staged data could not be turned into tiles
+		  */
+		static bool loadPendingSector(Map& map, const StagedTileArea& sector, bool _legacy);
+
 	private:
+		static void decodeTileArea(const OTB::Loader& loader, OTB::Node tileAreaNode, StagedTileArea& area);
+		static void decodeTileNodes(const OTB::Loader& loader, OTB::Node& tileAreaNode, StagedTileArea& area);
+		static bool decodeItem(const OTB::Loader& loader, OTB::Node& itemNode, StagedTileArea& area);
+		static void appendStagedTile(StagedTileArea& target, const StagedTileArea& source, const StagedTile& tile);
+		static bool loadStagedItem(Item* item, PropStream& propStream, const StagedTileArea& area, size_t index, bool _legacy);
+
 		bool parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode, Map& map, const std::string& fileName);
-		bool parseWaypoints(OTB::Loader& loader, const OTB::Node& waypointsNode, Map& map);
-		bool parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map);
-		bool parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Map& map, bool _legacy);
+		bool parseWaypoints(OTB::Loader& loader, OTB::Node& waypointsNode, Map& map);
+		bool parseTowns(OTB::Loader& loader, OTB::Node& townsNode, Map& map);
+		bool parseTileArea(const StagedTileArea& area, Map& map, bool _legacy);
+		//routes the tiles of a decoded area to the pending sectors, house tiles and already built sectors go to eager
+		static void stageLazyTileArea(const StagedTileArea& area, Map& map, StagedTileArea& eager);
 		std::string errorString;
 };
 
@@ -23,16 +23,26 @@
 #include "game.h"
 #include "bed.h"
 
+uint64_t IOMapSerialize::getTileId(const Position& position)
+{
+	return position.x | (static_cast<uint64_t>(position.y) << 16) | (static_cast<uint64_t>(position.z) << 32);
+}
+
 void IOMapSerialize::loadHouseItems(Map* map)
 {
 	int64_t start = OTSYS_TIME();
 
-	DBResult_ptr result = g_database().storeQuery("SELECT `data` FROM `tile_store`");
+	//buffered, loading items may run queries of its own (bed sleeper names)
+	DBResult_ptr result = g_database().storeQuery("SELECT `house_id`, `tile_id`, `data` FROM `tile_store`");
 	if (!result) {
 		return;
 	}
 
+	std::stringExtended orphanedTiles(256);
+	size_t orphanedCount = 0;
 	do {
+		uint64_t tileId = result->getNumber<uint64_t>("tile_id");
+
 		unsigned long attrSize;
 		const char* attr = result->getStream("data", attrSize);
 
@@ -45,8 +55,15 @@ void IOMapSerialize::loadHouseItems(Map* map)
 			continue;
 		}
 
-		Tile* tile = map->getTile(x, y, z);
-		if (!tile) {
+		//the map may have moved or removed the house since, such rows are kept aside instead of loaded every start
+		HouseTile* tile = dynamic_cast<HouseTile*>(map->getTile(x, y, z));
+		if (!tile || getTileId(tile->getPosition()) != tileId) {
+			spdlog::warn("[IOMapSerialize::loadHouseItems] Stored items of ({}, {}, {}) are not on a house tile, moving them to tile_store_quarantine", x, y, static_cast<int>(z));
+			if (!orphanedTiles.empty()) {
+				orphanedTiles.push_back(',');
+			}
+			orphanedTiles.appendInt(tileId);
+			++orphanedCount;
 			continue;
 		}
 
@@ -58,57 +75,161 @@ void IOMapSerialize::loadHouseItems(Map* map)
 		while (item_count--) {
 			loadItem(propStream, tile);
 		}
+
+		House* house = tile->getHouse();
+		if (house && house->getId() == result->getNumber<uint32_t>("house_id")) {
+			//the tile now holds what its row does, it is not written again until its items change
+			tile->setItemsSaved(std::hash<std::string_view>()(std::string_view(attr, attrSize)));
+		} else {
+			//the tile belongs to another house now, the next save writes the row under that house
+			tile->onItemsChanged();
+		}
 	} while (result->next());
+
+	if (!orphanedTiles.empty()) {
+		quarantineTiles(orphanedTiles, orphanedCount);
+	}
 	spdlog::info("Loaded house items in: {} s", (OTSYS_TIME() - start) / (1000.));
 }
 
-bool IOMapSerialize::saveHouseItems()
+void IOMapSerialize::quarantineTiles(const std::stringExtended& tileIds, size_t count)
 {
-	int64_t start = OTSYS_TIME();
-
-	//Start the transaction
 	DBTransaction transaction(&g_database());
 	if (!transaction.begin()) {
-		return false;
+		return;
 	}
 
-	//clear old tile data
-	if (!g_database().executeQuery("DELETE FROM `tile_store`")) {
-		return false;
+	std::stringExtended query(tileIds.size() + 256);
+	query.append("INSERT INTO `tile_store_quarantine` (`house_id`, `tile_id`, `data`, `time`) SELECT `house_id`, `tile_id`, `data`, ").appendInt(time(nullptr));
+	query.append(" FROM `tile_store` WHERE `tile_id` IN (").append(tileIds).append(1, ')');
+	if (!g_database().executeQuery(query)) {
+		return;
+	}
+
+	query.clear();
+	query.append("DELETE FROM `tile_store` WHERE `tile_id` IN (").append(tileIds).append(1, ')');
+	if (!g_database().executeQuery(query) || !transaction.commit()) {
+		return;
 	}
+	spdlog::warn("[IOMapSerialize::loadHouseItems] Moved the stored items of {} tiles to tile_store_quarantine", count);
+}
+
+bool IOMapSerialize::saveHouseItems()
+{
+	int64_t start = OTSYS_TIME();
 
-	DBInsert stmt(&g_database(), "INSERT INTO `tile_store` (`house_id`, `data`) VALUES ");
+	bool success = true;
+	size_t savedHouses = 0;
+	size_t savedTiles = 0;
+	House* slowestHouse = nullptr;
+	int64_t slowestTime = 0;
 
-	std::stringExtended query(1024);
 	PropWriteStream stream;
 	for (const auto& it : g_game().map.houses.getHouses()) {
-		//save house items
 		House* house = it.second;
-		for (HouseTile* tile : house->getTiles()) {
-			saveTile(stream, tile);
+		const HouseTileList& tiles = house->getTiles();
+		if (std::none_of(tiles.begin(), tiles.end(), [](const HouseTile* tile) { return tile->hasItemsChanged(); })) {
+			continue;
+		}
 
-			size_t attributesSize;
-			const char* attributes = stream.getStream(attributesSize);
-			if (attributesSize > 0) {
-				query.clear();
-				query.appendInt(house->getId()).append(1, ',').append(g_database().escapeBlob(attributes, attributesSize));
-				if (!stmt.addRow(query)) {
-					return false;
-				}
-				stream.clear();
+		int64_t houseStart = OTSYS_TIME();
+		size_t changedTiles = 0;
+		if (!saveHouseTiles(house, stream, changedTiles)) {
+			//the tiles stay marked as changed, the next save tries again
+			spdlog::error("[IOMapSerialize::saveHouseItems] Failed to save the items of house {}", house->getId());
+			success = false;
+			continue;
+		}
+
+		int64_t houseTime = OTSYS_TIME() - houseStart;
+		spdlog::debug("Saved {} tiles of house {} in {} ms", changedTiles, house->getId(), houseTime);
+		if (changedTiles != 0) {
+			++savedHouses;
+			savedTiles += changedTiles;
+		}
+		if (!slowestHouse || houseTime > slowestTime) {
+			slowestHouse = house;
+			slowestTime = houseTime;
+		}
+	}
+
+	std::cout << "> Saved " << savedTiles << " changed tiles of " << savedHouses << " houses in: " <<
+	          (OTSYS_TIME() - start) / (1000.) << " s" << std::endl;
+	if (slowestHouse) {
+		std::cout << "> Slowest house save: house " << slowestHouse->getId() << " in " << slowestTime << " ms" << std::endl;
+	}
+	return success;
+}
+
+bool IOMapSerialize::saveHouseTiles(House* house, PropWriteStream& stream, size_t& changedTiles)
+{
+	//every house is saved in a transaction of its own so the table is never locked for long
+	DBTransaction transaction(&g_database());
+	if (!transaction.begin()) {
+		return false;
+	}
+
+	DBInsert stmt(&g_database(), "INSERT INTO `tile_store` (`house_id`, `tile_id`, `data`) VALUES ");
+	stmt.upsert({"house_id", "data"});
+
+	std::vector<std::pair<HouseTile*, size_t>> savedTiles;
+	std::stringExtended query(1024);
+	std::stringExtended removedTiles(256);
+	for (HouseTile* tile : house->getTiles()) {
+		if (!tile->hasItemsChanged()) {
+			continue;
+		}
+
+		saveTile(stream, tile);
+
+		size_t attributesSize;
+		const char* attributes = stream.getStream(attributesSize);
+		size_t hash = attributesSize > 0 ? std::hash<std::string_view>()(std::string_view(attributes, attributesSize)) : 0;
+		if (hash == tile->getSavedItemsHash()) {
+			//changed back to what is stored already
+			tile->setItemsSaved(hash);
+			stream.clear();
+			continue;
+		}
+
+		uint64_t tileId = getTileId(tile->getPosition());
+		if (attributesSize > 0) {
+			query.clear();
+			query.appendInt(house->getId()).append(1, ',').appendInt(tileId).append(1, ',').append(g_database().escapeBlob(attributes, attributesSize));
+			if (!stmt.addRow(query)) {
+				return false;
 			}
+			stream.clear();
+		} else {
+			if (!removedTiles.empty()) {
+				removedTiles.push_back(',');
+			}
+			removedTiles.appendInt(tileId);
 		}
+		savedTiles.emplace_back(tile, hash);
 	}
 
 	if (!stmt.execute()) {
 		return false;
 	}
 
-	//End the transaction
-	bool success = transaction.commit();
-	std::cout << "> Saved house items in: " <<
-	          (OTSYS_TIME() - start) / (1000.) << " s" << std::endl;
-	return success;
+	if (!removedTiles.empty()) {
+		query.clear();
+		query.append("DELETE FROM `tile_store` WHERE `tile_id` IN (").append(removedTiles).append(1, ')');
+		if (!g_database().executeQuery(query)) {
+			return false;
+		}
+	}
+
+	if (!transaction.commit()) {
+		return false;
+	}
+
+	for (const auto& savedTile : savedTiles) {
+		savedTile.first->setItemsSaved(savedTile.second);
+	}
+	changedTiles = savedTiles.size();
+	return true;
 }
 
 bool IOMapSerialize::loadContainer(PropStream& propStream, Container* mainContainer)
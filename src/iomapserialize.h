@@ -32,6 +32,12 @@ class IOMapSerialize
 		static bool saveHouseInfo();
 
 	private:
+		//stable key of a tile in tile_store, the packed coordinates of its position
+		static uint64_t getTileId(const Position& position);
+		//writes the tiles of house whose items changed since they were last saved
+		static bool saveHouseTiles(House* house, PropWriteStream& stream, size_t& changedTiles);
+		//moves rows that no longer fit the map out of tile_store, their items are kept for manual recovery
+		static void quarantineTiles(const std::stringExtended& tileIds, size_t count);
 		static void saveItem(PropWriteStream& stream, const Item* item);
 		static void saveTile(PropWriteStream& stream, const Tile* tile);
 
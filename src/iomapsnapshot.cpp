@@ -0,0 +1,492 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "iomapsnapshot.h"
+#include "depotlocker.h"
+#include "housetile.h"
+
+#include <fstream>
+#include <sys/stat.h>
+
+/*
+	Snapshot layout, every value little endian as written by PropWriteStream
+
+	header:  "OTMS" | version u32 | OTBM hash u64 | items.otb major, minor, build u32 | payload hash u64 | payload size u64
+	payload: width u32 | height u32 | spawn file | house file
+	         towns u32 { id u32 | name | x u16 | y u16 | z u8 }
+	         waypoints u32 { name | x u16 | y u16 | z u8 }
+	         tiles u32 { x u16 | y u16 | z u8 | kind u8 | [house id u32] | flags u32 | items u16 { loaded from map u8 | item } }
+	item:    id u16 | attributes | 0x00 | [children u32 { item }]
+*/
+
+namespace {
+
+enum SnapshotTileKind : uint8_t {
+	SNAPSHOT_TILE_STATIC,
+	SNAPSHOT_TILE_DYNAMIC,
+	SNAPSHOT_TILE_HOUSE,
+};
+
+#pragma pack(1)
+struct SnapshotHeader {
+	char identifier[4];
+	uint32_t version;
+	uint64_t mapHash;
+	uint32_t itemsMajorVersion;
+	uint32_t itemsMinorVersion;
+	uint32_t itemsBuildNumber;
+	uint64_t payloadHash;
+	uint64_t payloadSize;
+};
+#pragma pack()
+
+bool hashFile(const std::string& fileName, uint64_t& hash)
+{
+	//the startup check and the load that follows it hash the same file, it is only read once
+	static std::string lastFileName;
+	static int64_t lastModified = 0;
+	static int64_t lastSize = 0;
+	static uint64_t lastHash = 0;
+
+	struct stat info;
+	if (stat(fileName.c_str(), &info) != 0) {
+		return false;
+	}
+
+	if (fileName == lastFileName && info.st_mtime == lastModified && info.st_size == lastSize) {
+		hash = lastHash;
+		return true;
+	}
+
+	try {
+		boost::iostreams::mapped_file_source file(fileName);
+		hash = hashBytes(file.data(), file.size());
+	} catch (const std::exception&) {
+		return false;
+	}
+
+	lastFileName = fileName;
+	lastModified = info.st_mtime;
+	lastSize = info.st_size;
+	lastHash = hash;
+	return true;
+}
+
+void fillHeader(SnapshotHeader& header, uint64_t mapHash)
+{
+	memcpy(header.identifier, "OTMS", 4);
+	header.version = MAP_SNAPSHOT_VERSION;
+	header.mapHash = mapHash;
+	header.itemsMajorVersion = Item::items.majorVersion;
+	header.itemsMinorVersion = Item::items.minorVersion;
+	header.itemsBuildNumber = Item::items.buildNumber;
+}
+
+bool matchesMap(const SnapshotHeader& header, const std::string& fileName)
+{
+	uint64_t mapHash;
+	if (!hashFile(fileName, mapHash)) {
+		return false;
+	}
+
+	SnapshotHeader expected;
+	fillHeader(expected, mapHash);
+	return memcmp(header.identifier, expected.identifier, 4) == 0 && header.version == expected.version && header.mapHash == expected.mapHash &&
+		header.itemsMajorVersion == expected.itemsMajorVersion && header.itemsMinorVersion == expected.itemsMinorVersion &&
+		header.itemsBuildNumber == expected.itemsBuildNumber;
+}
+
+void writePosition(PropWriteStream& stream, const Position& pos)
+{
+	stream.write<uint16_t>(pos.x);
+	stream.write<uint16_t>(pos.y);
+	stream.write<uint8_t>(pos.z);
+}
+
+bool readPosition(PropStream& propStream, Position& pos)
+{
+	return propStream.read<uint16_t>(pos.x) && propStream.read<uint16_t>(pos.y) && propStream.read<uint8_t>(pos.z);
+}
+
+}
+
+void IOMapSnapshot::saveItem(PropWriteStream& stream, const Item* item)
+{
+	stream.write<uint16_t>(item->getID());
+
+	//doors do not serialize anything for the house item storage, but the map copy needs their attributes
+	const Door* door = item->getDoor();
+	if (door) {
+		door->Item::serializeAttr(stream);
+		if (door->getDoorId() != 0) {
+			stream.write<uint8_t>(ATTR_HOUSEDOORID);
+			stream.write<uint8_t>(static_cast<uint8_t>(door->getDoorId()));
+		}
+	} else {
+		item->serializeAttr(stream);
+	}
+
+	if (item->getUniqueId() != 0) {
+		stream.write<uint8_t>(ATTR_UNIQUE_ID);
+		stream.write<uint16_t>(item->getUniqueId());
+	}
+
+	if (const DepotLocker* depotLocker = dynamic_cast<const DepotLocker*>(item)) {
+		stream.write<uint8_t>(ATTR_DEPOT_ID);
+		stream.write<uint16_t>(depotLocker->getDepotId());
+	}
+	stream.write<uint8_t>(0x00); // attr end
+
+	const Container* container = item->getContainer();
+	if (container) {
+		stream.write<uint32_t>(container->size());
+		for (const Item* child : container->getItemList()) {
+			saveItem(stream, child);
+		}
+	}
+}
+
+Item* IOMapSnapshot::loadItem(PropStream& propStream)
+{
+	uint16_t id;
+	if (!propStream.read<uint16_t>(id)) {
+		return nullptr;
+	}
+
+	Item* item = Item::CreateItem(id);
+	if (!item) {
+		return nullptr;
+	}
+
+	if (!item->unserializeAttr(propStream)) {
+		delete item;
+		return nullptr;
+	}
+
+	Container* container = item->getContainer();
+	if (container) {
+		uint32_t size;
+		if (!propStream.read<uint32_t>(size)) {
+			delete item;
+			return nullptr;
+		}
+
+		for (uint32_t i = 0; i < size; ++i) {
+			Item* child = loadItem(propStream);
+			if (!child) {
+				delete item;
+				return nullptr;
+			}
+
+			//the container has no parent yet, so this does not notify anyone
+			container->addItemBack(child);
+		}
+	}
+	return item;
+}
+
+bool IOMapSnapshot::isCurrent(const std::string& fileName)
+{
+	std::ifstream in(getSnapshotName(fileName), std::ios::binary);
+	if (!in) {
+		return false;
+	}
+
+	SnapshotHeader header;
+	return in.read(reinterpret_cast<char*>(&header), sizeof(header)) && matchesMap(header, fileName);
+}
+
+MapSnapshotResult_t IOMapSnapshot::load(Map& map, const std::string& fileName)
+{
+	int64_t start = OTSYS_TIME();
+
+	boost::iostreams::mapped_file_source file;
+	try {
+		file.open(getSnapshotName(fileName));
+	} catch (const std::exception&) {
+		return MAP_SNAPSHOT_UNAVAILABLE;
+	}
+
+	SnapshotHeader header;
+	if (file.size() < sizeof(header)) {
+		spdlog::warn("[IOMapSnapshot::load] Map snapshot is truncated, rebuilding it.");
+		return MAP_SNAPSHOT_UNAVAILABLE;
+	}
+	memcpy(&header, file.data(), sizeof(header));
+
+	if (!matchesMap(header, fileName)) {
+		spdlog::info("Map snapshot is outdated, rebuilding it.");
+		return MAP_SNAPSHOT_UNAVAILABLE;
+	}
+
+	const char* payload = file.data() + sizeof(header);
+	if (header.payloadSize != file.size() - sizeof(header) || header.payloadHash != hashBytes(payload, header.payloadSize)) {
+		spdlog::warn("[IOMapSnapshot::load] Map snapshot is damaged, rebuilding it.");
+		return MAP_SNAPSHOT_UNAVAILABLE;
+	}
+
+	//from here on the map is being filled, so any error has to abort the startup
+	PropStream propStream;
+	propStream.init(payload, header.payloadSize);
+
+	uint32_t width, height;
+	if (!propStream.read<uint32_t>(width) || !propStream.read<uint32_t>(height) ||
+		!propStream.readString(map.spawnfile) || !propStream.readString(map.housefile)) {
+		return MAP_SNAPSHOT_FAILED;
+	}
+	map.width = width;
+	map.height = height;
+
+	uint32_t count;
+	if (!propStream.read<uint32_t>(count)) {
+		return MAP_SNAPSHOT_FAILED;
+	}
+
+	for (uint32_t i = 0; i < count; ++i) {
+		uint32_t townId;
+		std::string townName;
+		Position templePos;
+		if (!propStream.read<uint32_t>(townId) || !propStream.readString(townName) || !readPosition(propStream, templePos)) {
+			return MAP_SNAPSHOT_FAILED;
+		}
+
+		Town* town = map.towns.getTown(townId);
+		if (!town) {
+			town = new Town(townId);
+			map.towns.addTown(townId, town);
+		}
+		town->setName(townName);
+		town->setTemplePos(templePos);
+	}
+
+	if (!propStream.read<uint32_t>(count)) {
+		return MAP_SNAPSHOT_FAILED;
+	}
+
+	for (uint32_t i = 0; i < count; ++i) {
+		std::string name;
+		Position pos;
+		if (!propStream.readString(name) || !readPosition(propStream, pos)) {
+			return MAP_SNAPSHOT_FAILED;
+		}
+		map.waypoints[name] = pos;
+	}
+
+	if (!propStream.read<uint32_t>(count)) {
+		return MAP_SNAPSHOT_FAILED;
+	}
+
+	for (uint32_t i = 0; i < count; ++i) {
+		Position pos;
+		uint8_t kind;
+		if (!readPosition(propStream, pos) || !propStream.read<uint8_t>(kind)) {
+			return MAP_SNAPSHOT_FAILED;
+		}
+
+		Tile* tile;
+		if (kind == SNAPSHOT_TILE_HOUSE) {
+			uint32_t houseId;
+			if (!propStream.read<uint32_t>(houseId)) {
+				return MAP_SNAPSHOT_FAILED;
+			}
+
+			House* house = map.houses.addHouse(houseId);
+			if (!house) {
+				return MAP_SNAPSHOT_FAILED;
+			}
+
+			tile = new HouseTile(pos.x, pos.y, pos.z, house);
+			house->addTile(static_cast<HouseTile*>(tile));
+		} else if (kind == SNAPSHOT_TILE_DYNAMIC) {
+			tile = new DynamicTile(pos.x, pos.y, pos.z);
+		} else {
+			tile = new StaticTile(pos.x, pos.y, pos.z);
+		}
+
+		uint32_t flags;
+		uint16_t itemCount;
+		if (!propStream.read<uint32_t>(flags) || !propStream.read<uint16_t>(itemCount)) {
+			return MAP_SNAPSHOT_FAILED;
+		}
+
+		for (uint16_t j = 0; j < itemCount; ++j) {
+			uint8_t loadedFromMap;
+			if (!propStream.read<uint8_t>(loadedFromMap)) {
+				return MAP_SNAPSHOT_FAILED;
+			}
+
+			Item* item = loadItem(propStream);
+			if (!item) {
+				spdlog::error("[IOMapSnapshot::load] Failed to load item at position [x: {}, y: {}, z: {}].", pos.x, pos.y, pos.z);
+				return MAP_SNAPSHOT_FAILED;
+			}
+
+			item->setLoadedFromMap(loadedFromMap != 0);
+			if (kind != SNAPSHOT_TILE_HOUSE) {
+				item = Item::toSharedItem(item);
+			}
+
+			tile->internalAddThing(item);
+			if (!item->isShared()) {
+				item->startDecaying();
+			}
+		}
+
+		tile->setFlag(static_cast<tileflags_t>(flags));
+		map.setTile(pos, tile);
+	}
+
+	spdlog::info("Map snapshot loading time: {} seconds.", (OTSYS_TIME() - start) / (1000.));
+	return MAP_SNAPSHOT_LOADED;
+}
+
+bool IOMapSnapshot::save(Map& map, const std::string& fileName)
+{
+	int64_t start = OTSYS_TIME();
+
+	SnapshotHeader header;
+	uint64_t mapHash;
+	if (!hashFile(fileName, mapHash)) {
+		return false;
+	}
+	fillHeader(header, mapHash);
+
+	PropWriteStream stream;
+	stream.write<uint32_t>(map.width);
+	stream.write<uint32_t>(map.height);
+	stream.writeString(map.spawnfile);
+	stream.writeString(map.housefile);
+
+	const TownMap& towns = map.towns.getTowns();
+	stream.write<uint32_t>(towns.size());
+	for (const auto& it : towns) {
+		const Town* town = it.second;
+		stream.write<uint32_t>(town->getID());
+		stream.writeString(town->getName());
+		writePosition(stream, town->getTemplePosition());
+	}
+
+	stream.write<uint32_t>(map.waypoints.size());
+	for (const auto& it : map.waypoints) {
+		stream.writeString(it.first);
+		writePosition(stream, it.second);
+	}
+
+	PropWriteStream tileStream;
+	uint32_t tileCount = 0;
+	for (const auto& it : map.mapSectors) {
+		uint32_t baseX = (it.first & 0xFFFF) * SECTOR_SIZE;
+		uint32_t baseY = (it.first >> 16) * SECTOR_SIZE;
+		for (uint8_t z = 0; z < MAP_MAX_LAYERS; ++z) {
+			if (!it.second.getFloor(z)) {
+				continue;
+			}
+
+			for (uint32_t x = baseX; x < baseX + SECTOR_SIZE; ++x) {
+				for (uint32_t y = baseY; y < baseY + SECTOR_SIZE; ++y) {
+					Tile* tile = map.getTile(x, y, z);
+					if (!tile) {
+						continue;
+					}
+
+					writePosition(tileStream, tile->getPosition());
+					if (HouseTile* houseTile = dynamic_cast<HouseTile*>(tile)) {
+						tileStream.write<uint8_t>(SNAPSHOT_TILE_HOUSE);
+						tileStream.write<uint32_t>(houseTile->getHouse()->getId());
+					} else if (dynamic_cast<DynamicTile*>(tile)) {
+						tileStream.write<uint8_t>(SNAPSHOT_TILE_DYNAMIC);
+					} else {
+						tileStream.write<uint8_t>(SNAPSHOT_TILE_STATIC);
+					}
+
+					//only the zone flags come from the OTBM, everything else is derived from the items
+					uint32_t flags = TILESTATE_NONE;
+					if (tile->hasFlag(TILESTATE_PROTECTIONZONE)) {
+						flags |= TILESTATE_PROTECTIONZONE;
+					}
+					if (tile->hasFlag(TILESTATE_NOPVPZONE)) {
+						flags |= TILESTATE_NOPVPZONE;
+					}
+					if (tile->hasFlag(TILESTATE_PVPZONE)) {
+						flags |= TILESTATE_PVPZONE;
+					}
+					if (tile->hasFlag(TILESTATE_NOLOGOUT)) {
+						flags |= TILESTATE_NOLOGOUT;
+					}
+					tileStream.write<uint32_t>(flags);
+
+					const Item* ground = tile->getGround();
+					const TileItemVector* items = tile->getItemList();
+					tileStream.write<uint16_t>((ground ? 1 : 0) + (items ? items->size() : 0));
+					if (ground) {
+						tileStream.write<uint8_t>(ground->isLoadedFromMap() ? 1 : 0);
+						saveItem(tileStream, ground);
+					}
+
+					if (items) {
+						for (const Item* item : *items) {
+							tileStream.write<uint8_t>(item->isLoadedFromMap() ? 1 : 0);
+							saveItem(tileStream, item);
+						}
+					}
+					++tileCount;
+				}
+			}
+		}
+	}
+
+	size_t tileSize;
+	const char* tileData = tileStream.getStream(tileSize);
+	stream.write<uint32_t>(tileCount);
+
+	size_t headSize;
+	const char* headData = stream.getStream(headSize);
+
+	std::vector<char> payload;
+	payload.reserve(headSize + tileSize);
+	payload.insert(payload.end(), headData, headData + headSize);
+	payload.insert(payload.end(), tileData, tileData + tileSize);
+
+	header.payloadHash = hashBytes(payload.data(), payload.size());
+	header.payloadSize = payload.size();
+
+	//write next to the final file and swap it in, so a crash never leaves a half written snapshot behind
+	const std::string snapshotName = getSnapshotName(fileName);
+	const std::string tempName = snapshotName + ".tmp";
+	{
+		std::ofstream output(tempName, std::ios::binary | std::ios::trunc);
+		output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		output.write(payload.data(), payload.size());
+		if (!output) {
+			spdlog::warn("[IOMapSnapshot::save] Could not write map snapshot {}.", tempName);
+			return false;
+		}
+	}
+
+	if (std::rename(tempName.c_str(), snapshotName.c_str()) != 0) {
+		spdlog::warn("[IOMapSnapshot::save] Could not replace map snapshot {}.", snapshotName);
+		std::remove(tempName.c_str());
+		return false;
+	}
+
+	spdlog::info("Map snapshot saved in {} seconds.", (OTSYS_TIME() - start) / (1000.));
+	return true;
+}
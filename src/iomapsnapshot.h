@@ -0,0 +1,68 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_IOMAPSNAPSHOT_H_2B8E51C0D7A44F6C9E3A0F6D1B5C8E47
+#define FS_IOMAPSNAPSHOT_H_2B8E51C0D7A44F6C9E3A0F6D1B5C8E47
+
+#include "map.h"
+
+//Bump whenever the snapshot layout changes, older files are then rebuilt from the OTBM
+static constexpr uint32_t MAP_SNAPSHOT_VERSION = 1;
+
+enum MapSnapshotResult_t {
+	MAP_SNAPSHOT_UNAVAILABLE, //missing, stale or damaged, nothing was loaded
+	MAP_SNAPSHOT_LOADED,
+	MAP_SNAPSHOT_FAILED, //the map was partially filled and can not be used
+};
+
+/**
+  * Compiled copy of the static world (tiles, map items, towns and waypoints) written after
+  * a successful OTBM load. The snapshot is keyed by a hash of the OTBM file and the items.otb
+  * version, so it is only used while both inputs are unchanged.
+  */
+class IOMapSnapshot
+{
+	public:
+		/**
+		  * Checks whether the snapshot belongs to the current OTBM file and items, without loading it.
+		  * The items have to be loaded first.
+		  */
+		static bool isCurrent(const std::string& fileName);
+
+		/**
+		  * Loads the snapshot belonging to the OTBM file.
+		  * \returns MAP_SNAPSHOT_UNAVAILABLE if the OTBM has to be loaded instead
+		  */
+		static MapSnapshotResult_t load(Map& map, const std::string& fileName);
+
+		/**
+		  * Writes the snapshot of a freshly loaded map, before any house items from the database are added.
+		  */
+		static bool save(Map& map, const std::string& fileName);
+
+	private:
+		static std::string getSnapshotName(const std::string& fileName) {
+			return fileName + ".snapshot";
+		}
+
+		static void saveItem(PropWriteStream& stream, const Item* item);
+		static Item* loadItem(PropStream& propStream);
+};
+
+#endif
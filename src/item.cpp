@@ -29,6 +29,7 @@
 #include "bed.h"
 
 #include "actions.h"
+#include "slab.h"
 #include "spells.h"
 
 Items Item::items;
@@ -180,6 +181,103 @@ Item::Item(const Item& i) :
 	}
 }
 
+Item::~Item()
+{
+	//a deleted item must not stay in the temporary item list of a script
+	ScriptEnvironment::removeTempItem(this);
+}
+
+namespace {
+
+SlabAllocator& getItemAllocator()
+{
+	static auto* allocator = new SlabAllocator("Item");
+	return *allocator;
+}
+
+SlabAllocator& getItemAttributesAllocator()
+{
+	static auto* allocator = new SlabAllocator("ItemAttributes");
+	return *allocator;
+}
+
+std::unordered_map<std::string, uint32_t>& getInternedStrings()
+{
+	//node based so the entries handed out by internString stay in place, never destroyed like the allocators
+	static auto* strings = new std::unordered_map<std::string, uint32_t>();
+	return *strings;
+}
+
+//keyed by id and count, the instances live as long as the server
+robin_hood::unordered_map<uint32_t, Item*> sharedItems;
+size_t sharedItemUses = 0;
+
+}
+
+void* Item::operator new(size_t size)
+{
+	return getItemAllocator().allocate(size);
+}
+
+void Item::operator delete(void* p, size_t size)
+{
+	getItemAllocator().deallocate(p, size);
+}
+
+void* ItemAttributes::operator new(size_t size)
+{
+	return getItemAttributesAllocator().allocate(size);
+}
+
+void ItemAttributes::operator delete(void* p, size_t size)
+{
+	getItemAttributesAllocator().deallocate(p, size);
+}
+
+Item* Item::toSharedItem(Item* item)
+{
+	if (!item->canBeShared()) {
+		return item;
+	}
+
+	++sharedItemUses;
+
+	uint32_t key = (static_cast<uint32_t>(item->id) << 8) | item->count;
+	auto it = sharedItems.find(key);
+	if (it != sharedItems.end()) {
+		item->decrementReferenceCounter();
+		return it->second;
+	}
+
+	item->sharedInstance = true;
+	sharedItems.emplace(key, item);
+	return item;
+}
+
+size_t Item::getSharedItemCount()
+{
+	return sharedItems.size();
+}
+
+size_t Item::getSharedItemUses()
+{
+	return sharedItemUses;
+}
+
+bool Item::canBeShared() const
+{
+	if (parent || (attributes && attributes->attributeBits != 0)) {
+		return false;
+	}
+
+	if (getContainer() || getTeleport() || getMagicField() || getDoor() || getTrashHolder() || getMailbox() || getBed()) {
+		return false;
+	}
+
+	const ItemType& it = items[id];
+	return it.isGroundTile() && !it.moveable && (it.decayTo < 0 || it.decayTime == 0);
+}
+
 Item* Item::clone() const
 {
 	Item* item = Item::CreateItem(id, count);
@@ -209,7 +307,8 @@ bool Item::equals(const Item* otherItem) const
 	for (const auto& attribute : attributeList) {
 		if (ItemAttributes::isStrAttrType(attribute.type)) {
 			for (const auto& otherAttribute : otherAttributeList) {
-				if (attribute.type == otherAttribute.type && *attribute.value.string != *otherAttribute.value.string) {
+				//equal strings are interned to the same entry
+				if (attribute.type == otherAttribute.type && attribute.value.string != otherAttribute.value.string) {
 					return false;
 				}
 			}
@@ -330,6 +429,13 @@ const Tile* Item::getTile() const
 	return dynamic_cast<const Tile*>(cylinder);
 }
 
+void Item::notifyTileChanged()
+{
+	if (Tile* tile = getTile()) {
+		tile->onItemsChanged();
+	}
+}
+
 uint16_t Item::getSubType() const
 {
 	const ItemType& it = items[id];
@@ -669,11 +775,6 @@ bool Item::unserializeAttr(PropStream& propStream)
 	return true;
 }
 
-bool Item::unserializeItemNode(OTB::Loader&, const OTB::Node&, PropStream& propStream, bool)
-{
-	return unserializeAttr(propStream);
-}
-
 void Item::serializeAttr(PropWriteStream& propWriteStream) const
 {
 	const ItemType& it = items[id];
@@ -2080,7 +2181,7 @@ const std::string& ItemAttributes::getStrAttr(itemAttrTypes type) const
 	if (!attr) {
 		return emptyString;
 	}
-	return *attr->value.string;
+	return attr->value.string->first;
 }
 
 void ItemAttributes::setStrAttr(itemAttrTypes type, const std::string& value)
@@ -2094,8 +2195,26 @@ void ItemAttributes::setStrAttr(itemAttrTypes type, const std::string& value)
 	}
 
 	Attribute& attr = getAttr(type);
-	delete attr.value.string;
-	attr.value.string = new std::string(value);
+	InternedString* string = internString(value);
+	if (attr.value.string) {
+		releaseString(attr.value.string);
+	}
+	attr.value.string = string;
+}
+
+ItemAttributes::InternedString* ItemAttributes::internString(const std::string& value)
+{
+	auto& strings = getInternedStrings();
+	auto it = strings.emplace(value, 0).first;
+	++it->second;
+	return &(*it);
+}
+
+void ItemAttributes::releaseString(InternedString* string)
+{
+	if (string && --string->second == 0) {
+		getInternedStrings().erase(string->first);
+	}
 }
 
 void ItemAttributes::removeAttribute(itemAttrTypes type)
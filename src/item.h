@@ -117,6 +117,10 @@ class ItemAttributes
 	public:
 		ItemAttributes() = default;
 
+		//served by a slab allocator, see slab.h
+		static void* operator new(size_t size);
+		static void operator delete(void* p, size_t size);
+
 		void setSpecialDescription(const std::string& desc) {
 			setStrAttr(ITEM_ATTRIBUTE_DESCRIPTION, desc);
 		}
@@ -385,13 +389,19 @@ class ItemAttributes
 		static double emptyDouble;
 		static bool emptyBool;
 
-		typedef std::unordered_map<std::string, CustomAttribute> CustomAttributeMap;
+		//custom attributes are few per item, a vector sorted by key is smaller and faster than a hash map
+		typedef std::vector<std::pair<std::string, CustomAttribute>> CustomAttributeMap;
+
+		//text attributes are shared by every item holding the same string, see internString
+		typedef std::pair<const std::string, uint32_t> InternedString;
+		static InternedString* internString(const std::string& value);
+		static void releaseString(InternedString* string);
 
 		struct Attribute
 		{
 			union {
 				int64_t integer;
-				std::string* string;
+				InternedString* string;
 				CustomAttributeMap* custom;
 			} value;
 			itemAttrTypes type;
@@ -399,6 +409,9 @@ class ItemAttributes
 			//non-copyable
 			Attribute& operator=(const Attribute& other) = delete;
 
+			Attribute() : type(ITEM_ATTRIBUTE_NONE) {
+				memset(&value, 0, sizeof(value));
+			}
 			Attribute(itemAttrTypes type) : type(type) {
 				memset(&value, 0, sizeof(value));
 			}
@@ -407,7 +420,8 @@ class ItemAttributes
 				if (ItemAttributes::isIntAttrType(type)) {
 					value.integer = i.value.integer;
 				} else if (ItemAttributes::isStrAttrType(type)) {
-					value.string = new std::string(*i.value.string);
+					value.string = i.value.string;
+					++value.string->second;
 				} else if (ItemAttributes::isCustomAttrType(type)) {
 					value.custom = new CustomAttributeMap(*i.value.custom);
 				} else {
@@ -420,11 +434,7 @@ class ItemAttributes
 			}
 			Attribute& operator=(Attribute&& other) noexcept {
 				if (this != &other) {
-					if (ItemAttributes::isStrAttrType(type)) {
-						delete value.string;
-					} else if (ItemAttributes::isCustomAttrType(type)) {
-						delete value.custom;
-					}
+					release();
 
 					value = other.value;
 					type = other.type;
@@ -435,15 +445,99 @@ class ItemAttributes
 				return *this;
 			}
 			~Attribute() {
+				release();
+			}
+
+			void release() {
 				if (ItemAttributes::isStrAttrType(type)) {
-					delete value.string;
+					ItemAttributes::releaseString(value.string);
 				} else if (ItemAttributes::isCustomAttrType(type)) {
 					delete value.custom;
 				}
 			}
 		};
 
-		std::vector<Attribute> attributes;
+		/**
+		  * Small vector of attributes: most items only carry a few integers (count, duration, decay state),
+		  * those are kept inside ItemAttributes and only longer lists go to the heap.
+		  */
+		class AttributeList
+		{
+			public:
+				AttributeList() = default;
+				AttributeList(const AttributeList& other) {
+					if (other.size() > INLINE_ATTRIBUTES) {
+						overflow.reset(new std::vector<Attribute>(other.begin(), other.end()));
+						return;
+					}
+
+					size_t index = 0;
+					for (const Attribute& attribute : other) {
+						inlineAttributes[index++] = Attribute(attribute);
+					}
+				}
+
+				// non-assignable
+				AttributeList& operator=(const AttributeList&) = delete;
+
+				Attribute* begin() {
+					return overflow ? overflow->data() : inlineAttributes.data();
+				}
+				Attribute* end() {
+					return begin() + size();
+				}
+				const Attribute* begin() const {
+					return overflow ? overflow->data() : inlineAttributes.data();
+				}
+				const Attribute* end() const {
+					return begin() + size();
+				}
+				size_t size() const {
+					if (overflow) {
+						return overflow->size();
+					}
+
+					//the inline slots are filled from the front, so the first empty one ends the list
+					size_t size = 0;
+					while (size < INLINE_ATTRIBUTES && inlineAttributes[size].type != ITEM_ATTRIBUTE_NONE) {
+						++size;
+					}
+					return size;
+				}
+
+				Attribute& back() {
+					return *(end() - 1);
+				}
+				void emplace_back(itemAttrTypes type) {
+					if (overflow) {
+						overflow->emplace_back(type);
+					} else if (size() < INLINE_ATTRIBUTES) {
+						inlineAttributes[size()] = Attribute(type);
+					} else {
+						overflow.reset(new std::vector<Attribute>());
+						overflow->reserve(INLINE_ATTRIBUTES * 2);
+						for (Attribute& attribute : inlineAttributes) {
+							overflow->push_back(std::move(attribute));
+						}
+						overflow->emplace_back(type);
+					}
+				}
+				void pop_back() {
+					if (overflow) {
+						overflow->pop_back();
+					} else {
+						back() = Attribute();
+					}
+				}
+
+			private:
+				static constexpr size_t INLINE_ATTRIBUTES = 3;
+
+				std::array<Attribute, INLINE_ATTRIBUTES> inlineAttributes;
+				std::unique_ptr<std::vector<Attribute>> overflow;
+		};
+
+		AttributeList attributes;
 		std::underlying_type<itemAttrTypes>::type attributeBits = 0;
 
 		const std::string& getStrAttr(itemAttrTypes type) const;
@@ -464,6 +558,12 @@ class ItemAttributes
 			return getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom;
 		}
 
+		static CustomAttributeMap::iterator findCustomAttribute(CustomAttributeMap& customAttrMap, const std::string& key) {
+			return std::lower_bound(customAttrMap.begin(), customAttrMap.end(), key, [](const CustomAttributeMap::value_type& entry, const std::string& k) {
+				return entry.first < k;
+			});
+		}
+
 		template<typename R>
 		void setCustomAttribute(int64_t key, R value) {
 			std::string tmp = boost::lexical_cast<std::string>(key);
@@ -477,34 +577,37 @@ class ItemAttributes
 
 		template<typename R>
 		void setCustomAttribute(std::string& key, R value) {
-			toLowerCaseString(key);
-			if (hasAttribute(ITEM_ATTRIBUTE_CUSTOM)) {
-				removeCustomAttribute(key);
-			} else {
-				getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom = new CustomAttributeMap();
-			}
-			getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom->emplace(key, value);
+			CustomAttribute attribute(value);
+			setCustomAttribute(key, attribute);
 		}
 
 		void setCustomAttribute(std::string& key, CustomAttribute& value) {
 			toLowerCaseString(key);
-			if (hasAttribute(ITEM_ATTRIBUTE_CUSTOM)) {
-				removeCustomAttribute(key);
+			Attribute& attr = getAttr(ITEM_ATTRIBUTE_CUSTOM);
+			if (!attr.value.custom) {
+				attr.value.custom = new CustomAttributeMap();
+			}
+
+			CustomAttributeMap& customAttrMap = *attr.value.custom;
+			auto it = findCustomAttribute(customAttrMap, key);
+			if (it != customAttrMap.end() && it->first == key) {
+				it->second = std::move(value);
 			} else {
-				getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom = new CustomAttributeMap();
+				customAttrMap.emplace(it, std::move(key), std::move(value));
 			}
-			getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom->insert(std::make_pair(std::move(key), std::move(value)));
 		}
 
+		//the returned pointer is only valid until the next custom attribute of this item is set or removed
 		const CustomAttribute* getCustomAttribute(int64_t key) {
 			std::string tmp = boost::lexical_cast<std::string>(key);
 			return getCustomAttribute(tmp);
 		}
 
 		const CustomAttribute* getCustomAttribute(const std::string& key) {
-			if (const CustomAttributeMap* customAttrMap = getCustomAttributeMap()) {
-				auto it = customAttrMap->find(asLowerCaseString(key));
-				if (it != customAttrMap->end()) {
+			if (CustomAttributeMap* customAttrMap = getCustomAttributeMap()) {
+				const std::string lowerKey = asLowerCaseString(key);
+				auto it = findCustomAttribute(*customAttrMap, lowerKey);
+				if (it != customAttrMap->end() && it->first == lowerKey) {
 					return &(it->second);
 				}
 			}
@@ -518,8 +621,9 @@ class ItemAttributes
 
 		bool removeCustomAttribute(const std::string& key) {
 			if (CustomAttributeMap* customAttrMap = getCustomAttributeMap()) {
-				auto it = customAttrMap->find(asLowerCaseString(key));
-				if (it != customAttrMap->end()) {
+				const std::string lowerKey = asLowerCaseString(key);
+				auto it = findCustomAttribute(*customAttrMap, lowerKey);
+				if (it != customAttrMap->end() && it->first == lowerKey) {
 					customAttrMap->erase(it);
 					return true;
 				}
@@ -564,13 +668,16 @@ class ItemAttributes
 			return (type & ITEM_ATTRIBUTE_CUSTOM) != 0;
 		}
 
-		const std::vector<Attribute>& getList() const {
+		const AttributeList& getList() const {
 			return attributes;
 		}
 
 	friend class Item;
 };
 
+//three integer attributes stay inside one 64 byte slab block on 64 bit builds
+static_assert(sizeof(void*) != 8 || sizeof(ItemAttributes) <= 64, "ItemAttributes no longer fits a 64 byte block");
+
 class Item : virtual public Thing
 {
 	public:
@@ -581,12 +688,24 @@ class Item : virtual public Thing
 		static Item* CreateItem_legacy(PropStream& propStream);
 		static Items items;
 
+		/**
+		  * Static map grounds without any state of their own are shared by every tile using them.
+		  * \returns the shared instance for item, releasing item, or item itself if it can not be shared
+		  */
+		static Item* toSharedItem(Item* item);
+		static size_t getSharedItemCount();
+		static size_t getSharedItemUses();
+
 		// Constructor for items
 		Item(const uint16_t type, uint16_t count = 0);
 		Item(const Item& i);
 		virtual Item* clone() const;
 
-		virtual ~Item() = default;
+		virtual ~Item();
+
+		//every item class is served by one slab allocator, see slab.h
+		static void* operator new(size_t size);
+		static void operator delete(void* p, size_t size);
 
 		// non-assignable
 		Item& operator=(const Item&) = delete;
@@ -680,6 +799,7 @@ class Item : virtual public Thing
 			getAttributes()->setCustomAttribute(key, value);
 		}
 		
+		//the returned pointer is only valid until the next custom attribute of this item is set or removed
 		const ItemAttributes::CustomAttribute* getCustomAttribute(int64_t key) const {
 			if (!attributes) {
 				return nullptr;
@@ -846,7 +966,6 @@ class Item : virtual public Thing
 		//serialization
 		virtual Attr_ReadValue readAttr(AttrTypes_t attr, PropStream& propStream);
 		bool unserializeAttr(PropStream& propStream);
-		virtual bool unserializeItemNode(OTB::Loader&, const OTB::Node&, PropStream& propStream, bool _legacy);
 
 		virtual void serializeAttr(PropWriteStream& propWriteStream) const;
 
@@ -1043,6 +1162,10 @@ class Item : virtual public Thing
 		void setLoadedFromMap(bool value) {
 			loadedFromMap = value;
 		}
+		//shared items have no parent, a tile hands out its own copy before anything can change them
+		bool isShared() const {
+			return sharedInstance;
+		}
 		bool isCleanable() const {
 			return !loadedFromMap && canRemove() && isPickupable() && !hasAttribute(ITEM_ATTRIBUTE_UNIQUEID) && !hasAttribute(ITEM_ATTRIBUTE_ACTIONID);
 		}
@@ -1069,12 +1192,16 @@ class Item : virtual public Thing
 			return parent;
 		}
 		void setParent(Cylinder* cylinder) override {
-			parent = cylinder;
+			if (!sharedInstance) {
+				parent = cylinder;
+			}
 		}
 		Cylinder* getTopParent();
 		const Cylinder* getTopParent() const;
 		Tile* getTile() override;
 		const Tile* getTile() const override;
+		//lets the tile holding this item know it changed without being moved or transformed
+		void notifyTileChanged();
 		bool isRemoved() const override {
 			return !parent || parent->isRemoved();
 		}
@@ -1084,6 +1211,7 @@ class Item : virtual public Thing
 
 	private:
 		std::string getWeightDescription(uint32_t weight) const;
+		bool canBeShared() const;
 
 		std::unique_ptr<ItemAttributes> attributes;
 
@@ -1093,9 +1221,15 @@ class Item : virtual public Thing
 		uint8_t count = 1; // number of stacked items
 
 		bool loadedFromMap = false;
+		bool sharedInstance = false;
+
+		//slot in the temporary item list of a script environment, these fill the padding after the flags above
+		uint8_t tempScriptEnv = std::numeric_limits<uint8_t>::max();
+		uint32_t tempItemSlot = 0;
 
 		//Don't add variables here, use the ItemAttribute class.
 		friend class Decay;
+		friend class ScriptEnvironment;
 };
 
 using ItemList = std::list<Item*>;
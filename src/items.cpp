@@ -165,6 +165,7 @@ void Items::clear()
 {
 	items.clear();
 	reverseItemMap.clear();
+	nameToItems.clear();
 }
 
 bool Items::reload()
@@ -194,7 +195,7 @@ bool Items::loadFromOtb(const std::string& file)
 
 	OTB::Loader loader{file, OTBI};
 
-	auto& root = loader.parseTree();
+	OTB::Node root = loader.getRoot();
 
 	PropStream props;
 	if (loader.getProps(root, props)) {
@@ -238,7 +239,7 @@ bool Items::loadFromOtb(const std::string& file)
 		return loadFromOtbLegacy(loader, root);
 	}
 
-	for (auto& itemNode : root.children) {
+	for (auto& itemNode : loader.children(root)) {
 		PropStream stream;
 		if (!loader.getProps(itemNode, stream)) {
 			return false;
@@ -419,7 +420,7 @@ bool Items::loadFromOtb(const std::string& file)
 	return true;
 }
 
-bool Items::loadFromOtbLegacy(OTB::Loader& loader, const OTB::Node& rootNode)
+bool Items::loadFromOtbLegacy(OTB::Loader& loader, OTB::Node& rootNode)
 {
 	auto translateOTBSubfight = [](subfightOTB_t sf) {
 		switch(sf)
@@ -460,7 +461,7 @@ bool Items::loadFromOtbLegacy(OTB::Loader& loader, const OTB::Node& rootNode)
 		}
 	};
 
-	for (auto& itemNode : rootNode.children) {
+	for (auto& itemNode : loader.children(rootNode)) {
 		PropStream stream;
 		if (!loader.getProps(itemNode, stream)) {
 			return false;
@@ -970,9 +971,23 @@ bool Items::loadFromXml()
 		}
 	}
 
+	buildNameIndex();
 	return true;
 }
 
+void Items::buildNameIndex()
+{
+	nameToItems.clear();
+	nameToItems.reserve(items.size());
+	for (size_t i = 100, size = items.size(); i < size; ++i) {
+		const ItemType& it = items[i];
+		if (!it.name.empty()) {
+			//emplace keeps the first id, same as the old linear search
+			nameToItems.emplace(asLowerCaseString(it.name), static_cast<uint16_t>(i));
+		}
+	}
+}
+
 void Items::parseItemNode(const pugi::xml_node& itemNode, uint16_t id)
 {
 	// Auto detect fluid ids
@@ -1899,14 +1914,9 @@ uint16_t Items::getItemIdByName(const std::string& name)
 		return 0;
 	}
 
-	const std::string& compare = asLowerCaseString(name);
-	size_t nameSize = compare.length();
-	const char* itemName = compare.c_str();
-	for (size_t i = 100, size = items.size(); i < size; ++i) {
-		ItemType& it = items[i];
-		if (nameSize == it.name.length() && !tfs_strncmp(itemName, asLowerCaseString(it.name).c_str(), nameSize)) {
-			return i;
-		}
+	auto it = nameToItems.find(asLowerCaseString(name));
+	if (it != nameToItems.end()) {
+		return it->second;
 	}
 	return 0;
 }
@@ -399,7 +399,7 @@ class Items
 		void clear();
 
 		bool loadFromOtb(const std::string& file);
-		bool loadFromOtbLegacy(OTB::Loader& loader, const OTB::Node& rootNode);
+		bool loadFromOtbLegacy(OTB::Loader& loader, OTB::Node& rootNode);
 
 		const ItemType& operator[](size_t id) const {
 			return getItemType(id);
@@ -422,7 +422,11 @@ class Items
 		}
 
 	private:
+		void buildNameIndex();
+
 		std::vector<uint16_t> reverseItemMap;
 		std::vector<ItemType> items;
+		//lower case name to the lowest item id with that name, built after items.xml is parsed
+		robin_hood::unordered_map<std::string, uint16_t> nameToItems;
 };
 #endif
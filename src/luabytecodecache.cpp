@@ -0,0 +1,267 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "luabytecodecache.h"
+#include "configmanager.h"
+#include "luascript.h"
+#include "tools.h"
+
+#include <fstream>
+#include <sys/stat.h>
+
+#ifdef __cpp_lib_filesystem
+#include <filesystem>
+namespace fs = std::filesystem;
+#else
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+#endif
+
+/*
+	Cache file layout, one file per script named after a hash of its path
+
+	header: "OTLC" | version u32 | VM version u32 | modified i64 | source hash u64 | bytecode hash u64 | path size u32
+	        path | bytecode as written by lua_dump
+*/
+
+namespace {
+
+#ifdef LUAJIT_VERSION_NUM
+//LuaJIT reports 501 as Lua version, its bytecode does not load into Lua 5.1 and the other way around
+constexpr uint32_t LUA_VM_VERSION = LUAJIT_VERSION_NUM;
+#else
+constexpr uint32_t LUA_VM_VERSION = LUA_VERSION_NUM;
+#endif
+
+#pragma pack(1)
+struct CacheHeader {
+	char identifier[4];
+	uint32_t version;
+	uint32_t vmVersion;
+	int64_t modified;
+	uint64_t sourceHash;
+	uint64_t bytecodeHash;
+	uint32_t pathSize;
+};
+#pragma pack()
+
+std::string getCacheFileName(const std::string& file)
+{
+	std::ostringstream ss;
+	ss << LUA_BYTECODE_CACHE_DIRECTORY << '/' << std::hex << std::setw(16) << std::setfill('0') << hashBytes(file.data(), file.size()) << ".luac";
+	return ss.str();
+}
+
+bool readSource(const std::string& file, std::string& source, int64_t& modified)
+{
+	struct stat info;
+	if (stat(file.c_str(), &info) != 0) {
+		return false;
+	}
+	modified = info.st_mtime;
+
+	std::ifstream in(file, std::ios::binary);
+	if (!in) {
+		return false;
+	}
+	source.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	return !in.bad();
+}
+
+}
+
+void LuaBytecodeCache::prepare(const std::vector<std::string>& files)
+{
+	if (files.empty() || !g_config().getBoolean(ConfigManager::LUA_BYTECODE_CACHE)) {
+		return;
+	}
+
+	int64_t start = OTSYS_TIME();
+	int32_t size = static_cast<int32_t>(files.size());
+	std::vector<Entry> fetched(size);
+	std::vector<FetchResult_t> results(size);
+
+	//entries is only read until all files are fetched
+	#pragma omp parallel for schedule(dynamic)
+	for (int32_t i = 0; i < size; ++i) {
+		auto it = entries.find(files[i]);
+		results[i] = fetch(files[i], it != entries.end() ? &it->second : nullptr, fetched[i]);
+	}
+
+	std::array<int32_t, FETCH_COMPILED + 1> counts = {};
+	for (int32_t i = 0; i < size; ++i) {
+		++counts[results[i]];
+		if (results[i] == FETCH_MEMORY) {
+			entries[files[i]].prepared = true;
+		} else if (results[i] == FETCH_DISK || results[i] == FETCH_COMPILED) {
+			fetched[i].prepared = true;
+			entries.insert_or_assign(files[i], std::move(fetched[i]));
+		}
+	}
+
+	spdlog::info("Prepared {} scripts in {} seconds: {} unchanged, {} from the bytecode cache, {} compiled, {} failed.",
+		size, (OTSYS_TIME() - start) / (1000.), counts[FETCH_MEMORY], counts[FETCH_DISK], counts[FETCH_COMPILED], counts[FETCH_FAILED]);
+}
+
+bool LuaBytecodeCache::load(lua_State* L, const std::string& file)
+{
+	if (!g_config().getBoolean(ConfigManager::LUA_BYTECODE_CACHE)) {
+		return false;
+	}
+
+	auto it = entries.find(file);
+	if (it != entries.end() && it->second.prepared) {
+		//files loaded outside of a prepare pass are checked again
+		it->second.prepared = false;
+	} else {
+		Entry entry;
+		FetchResult_t result = fetch(file, it != entries.end() ? &it->second : nullptr, entry);
+		if (result == FETCH_FAILED) {
+			return false;
+		} else if (result != FETCH_MEMORY) {
+			it = entries.insert_or_assign(file, std::move(entry)).first;
+		}
+	}
+
+	const std::string& bytecode = it->second.bytecode;
+	if (luaL_loadbuffer(L, bytecode.data(), bytecode.size(), ("@" + file).c_str()) != 0) {
+		//written by an incompatible build, drop it so the next load compiles the file again
+		lua_pop(L, 1);
+		entries.erase(it);
+		std::remove(getCacheFileName(file).c_str());
+		return false;
+	}
+	return true;
+}
+
+LuaBytecodeCache::FetchResult_t LuaBytecodeCache::fetch(const std::string& file, const Entry* known, Entry& entry)
+{
+	std::string source;
+	if (!readSource(file, source, entry.modified)) {
+		return FETCH_FAILED;
+	}
+
+	entry.sourceHash = hashBytes(source.data(), source.size());
+	if (known && known->modified == entry.modified && known->sourceHash == entry.sourceHash) {
+		return FETCH_MEMORY;
+	}
+
+	Entry cached;
+	if (readCacheFile(file, cached) && cached.modified == entry.modified && cached.sourceHash == entry.sourceHash) {
+		entry.bytecode = std::move(cached.bytecode);
+		return FETCH_DISK;
+	}
+
+	//syntax errors are left to luaL_loadfile, which reports them
+	if (!compile(file, source, entry.bytecode)) {
+		return FETCH_FAILED;
+	}
+
+	writeCacheFile(file, entry);
+	return FETCH_COMPILED;
+}
+
+bool LuaBytecodeCache::readCacheFile(const std::string& file, Entry& entry)
+{
+	std::ifstream in(getCacheFileName(file), std::ios::binary);
+	if (!in) {
+		return false;
+	}
+
+	CacheHeader header;
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || memcmp(header.identifier, "OTLC", 4) != 0 ||
+		header.version != LUA_BYTECODE_CACHE_VERSION || header.vmVersion != LUA_VM_VERSION || header.pathSize != file.size()) {
+		return false;
+	}
+
+	//the name is only a hash of the path, another file may own it
+	std::string path(header.pathSize, '\0');
+	if (!in.read(&path[0], path.size()) || path != file) {
+		return false;
+	}
+
+	entry.bytecode.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	if (entry.bytecode.empty() || hashBytes(entry.bytecode.data(), entry.bytecode.size()) != header.bytecodeHash) {
+		return false;
+	}
+
+	entry.modified = header.modified;
+	entry.sourceHash = header.sourceHash;
+	return true;
+}
+
+void LuaBytecodeCache::writeCacheFile(const std::string& file, const Entry& entry)
+{
+	CacheHeader header;
+	memcpy(header.identifier, "OTLC", 4);
+	header.version = LUA_BYTECODE_CACHE_VERSION;
+	header.vmVersion = LUA_VM_VERSION;
+	header.modified = entry.modified;
+	header.sourceHash = entry.sourceHash;
+	header.bytecodeHash = hashBytes(entry.bytecode.data(), entry.bytecode.size());
+	header.pathSize = static_cast<uint32_t>(file.size());
+
+	//a missing cache only costs a compile, so failures here are not reported
+	try {
+		fs::create_directories(LUA_BYTECODE_CACHE_DIRECTORY);
+	} catch (const std::exception&) {
+		return;
+	}
+
+	//write next to the final file and swap it in, so a crash never leaves a half written entry behind
+	const std::string cacheName = getCacheFileName(file);
+	const std::string tempName = cacheName + ".tmp";
+	{
+		std::ofstream out(tempName, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(file.data(), file.size());
+		out.write(entry.bytecode.data(), entry.bytecode.size());
+		if (!out) {
+			return;
+		}
+	}
+	std::rename(tempName.c_str(), cacheName.c_str());
+}
+
+bool LuaBytecodeCache::compile(const std::string& file, const std::string& source, std::string& bytecode)
+{
+	//luaL_loadfile skips a UTF-8 byte order mark and a first line starting with #, the newline stays for the line numbers
+	size_t offset = 0;
+	if (source.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+		offset = 3;
+	}
+	if (offset < source.size() && source[offset] == '#') {
+		offset = std::min(source.find('\n', offset), source.size());
+	}
+
+	//parsing needs no libraries, every file gets its own state so files compile in parallel
+	lua_State* L = luaL_newstate();
+	if (!L) {
+		return false;
+	}
+
+	bool success = luaL_loadbuffer(L, source.data() + offset, source.size() - offset, ("@" + file).c_str()) == 0;
+	if (success) {
+		success = LuaScriptInterface::dumpFunction(L, bytecode);
+	}
+	lua_close(L);
+	return success;
+}
@@ -0,0 +1,86 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_LUABYTECODECACHE_H_6C2E9A4F1B8D4E3A9F7C0B5D2E8A1C6F
+#define FS_LUABYTECODECACHE_H_6C2E9A4F1B8D4E3A9F7C0B5D2E8A1C6F
+
+struct lua_State;
+
+//Bump whenever the cache file layout changes, older files are then compiled again
+static constexpr uint32_t LUA_BYTECODE_CACHE_VERSION = 1;
+static constexpr auto LUA_BYTECODE_CACHE_DIRECTORY = "cache/lua";
+
+/**
+  * Compiled chunks of the script files, so a reload only parses what changed. Chunks are kept
+  * in memory and written to LUA_BYTECODE_CACHE_DIRECTORY, both are keyed by the file path, its
+  * modification time and a hash of its source; the disk copy also survives restarts.
+  */
+class LuaBytecodeCache
+{
+	public:
+		LuaBytecodeCache() = default;
+
+		// Singleton - ensures we don't accidentally copy it
+		LuaBytecodeCache(LuaBytecodeCache const&) = delete;
+		void operator=(LuaBytecodeCache const&) = delete;
+
+		static LuaBytecodeCache& getInstance() {
+			static LuaBytecodeCache instance;
+			return instance;
+		}
+
+		/**
+		  * Compiles the given files in parallel, the loadFile calls that follow only undump them.
+		  */
+		void prepare(const std::vector<std::string>& files);
+
+		/**
+		  * Pushes the compiled chunk of a file, the way luaL_loadfile would.
+		  * \returns false if the file has to be loaded from source, nothing is pushed then
+		  */
+		bool load(lua_State* L, const std::string& file);
+
+	private:
+		enum FetchResult_t {
+			FETCH_FAILED,
+			FETCH_MEMORY,
+			FETCH_DISK,
+			FETCH_COMPILED,
+		};
+
+		struct Entry {
+			int64_t modified = 0;
+			uint64_t sourceHash = 0;
+			std::string bytecode;
+			//checked against the file by prepare, the next load uses it as is
+			bool prepared = false;
+		};
+
+		//fills entry unless known is still current, safe to run for different files at once
+		static FetchResult_t fetch(const std::string& file, const Entry* known, Entry& entry);
+		static bool readCacheFile(const std::string& file, Entry& entry);
+		static void writeCacheFile(const std::string& file, const Entry& entry);
+		static bool compile(const std::string& file, const std::string& source, std::string& bytecode);
+
+		std::unordered_map<std::string, Entry> entries;
+};
+
+constexpr auto g_luaBytecodeCache = &LuaBytecodeCache::getInstance;
+
+#endif
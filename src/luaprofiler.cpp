@@ -0,0 +1,214 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "otpch.h"
+
+#include "luaprofiler.h"
+#include "luascript.h"
+
+#include <fstream>
+
+bool LuaProfiler::start(lua_State* L, bool sampling)
+{
+	if (running) {
+		return false;
+	}
+
+	clear();
+	running = true;
+	this->sampling = sampling;
+	startTime = now();
+
+	if (sampling) {
+		lua_sethook(L, sampleHook, LUA_MASKCOUNT, LUA_PROFILER_SAMPLE_INSTRUCTIONS);
+	}
+
+	spdlog::info("Lua profiler started{}.", sampling ? " with line sampling" : "");
+	return true;
+}
+
+std::string LuaProfiler::stop(lua_State* L)
+{
+	if (!running) {
+		return std::string();
+	}
+
+	if (sampling) {
+		lua_sethook(L, nullptr, 0, 0);
+	}
+
+	running = false;
+	//calls still in progress, e.g. the script that stopped the profiler, are not recorded
+	frames.clear();
+
+	char timestamp[32];
+	time_t nowTime = time(nullptr);
+	strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", localtime(&nowTime));
+	std::string name = std::string("lua_profile_") + timestamp;
+
+	std::map<std::string, CallStats> eventTypes;
+	std::vector<std::pair<std::string, CallStats>> sorted(scripts.begin(), scripts.end());
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+		return a.second.totalTime > b.second.totalTime;
+	});
+
+	std::ofstream csv(name + "_scripts.csv");
+	csv << "script,calls,total_us,self_us\n";
+	for (const auto& it : sorted) {
+		csv << '"' << it.first << "\"," << it.second.calls << ',' << it.second.totalTime << ',' << it.second.selfTime << '\n';
+
+		CallStats& eventType = eventTypes[it.first.substr(0, it.first.find(']') + 1)];
+		eventType.calls += it.second.calls;
+		eventType.selfTime += it.second.selfTime;
+	}
+
+	bool written = csv.good() && writeFolded(name + "_calls.folded", callStacks);
+	if (sampling) {
+		written = writeFolded(name + "_lines.folded", lineStacks) && written;
+	}
+
+	if (!written) {
+		spdlog::error("[LuaProfiler::stop] Failed to write the results to {}_*.", name);
+	}
+
+	int64_t elapsed = now() - startTime;
+	spdlog::info("Lua profiler stopped after {:.2f} seconds, results written to {}_*.", elapsed / 1000000., name);
+	for (const auto& it : eventTypes) {
+		spdlog::info("{} {} calls, {:.2f} ms", it.first, it.second.calls, it.second.selfTime / 1000.);
+	}
+
+	for (size_t i = 0, size = std::min<size_t>(sorted.size(), 10); i < size; ++i) {
+		const auto& it = sorted[i];
+		spdlog::info("{} {} calls, {:.2f} ms", it.first, it.second.calls, it.second.totalTime / 1000.);
+	}
+	return name;
+}
+
+void LuaProfiler::enterCall(LuaScriptInterface* scriptInterface, int32_t scriptId)
+{
+	std::string name;
+	if (scriptInterface) {
+		name = '[' + scriptInterface->getInterfaceName() + "] " + scriptInterface->getFileById(scriptId);
+	} else {
+		name = "(Unknown script)";
+	}
+	//';' separates the frames of a collapsed stack
+	std::replace(name.begin(), name.end(), ';', ',');
+
+	frames.push_back({std::move(name), now(), 0});
+}
+
+void LuaProfiler::leaveCall()
+{
+	if (frames.empty()) {
+		//the profiler was restarted while this call was running
+		return;
+	}
+
+	const Frame& frame = frames.back();
+	int64_t elapsed = now() - frame.start;
+	int64_t selfTime = elapsed - frame.childTime;
+
+	CallStats& stats = scripts[frame.name];
+	++stats.calls;
+	stats.totalTime += elapsed;
+	stats.selfTime += selfTime;
+
+	callStacks[getCallPath()] += selfTime;
+
+	frames.pop_back();
+	if (!frames.empty()) {
+		frames.back().childTime += elapsed;
+	}
+}
+
+int64_t LuaProfiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LuaProfiler::sampleHook(lua_State* L, lua_Debug*)
+{
+	g_luaProfiler().sample(L);
+}
+
+void LuaProfiler::sample(lua_State* L)
+{
+	std::vector<std::string> luaFrames;
+
+	lua_Debug ar;
+	for (int level = 0; lua_getstack(L, level, &ar) == 1; ++level) {
+		if (lua_getinfo(L, "Snl", &ar) == 0) {
+			break;
+		}
+
+		if (strcmp(ar.what, "C") == 0) {
+			luaFrames.emplace_back(std::string("[C] ") + (ar.name ? ar.name : "?"));
+		} else {
+			std::ostringstream ss;
+			ss << ar.short_src << ':' << ar.currentline;
+			if (ar.name) {
+				ss << " (" << ar.name << ')';
+			}
+			luaFrames.push_back(ss.str());
+		}
+	}
+
+	std::string path = getCallPath();
+	for (auto it = luaFrames.rbegin(); it != luaFrames.rend(); ++it) {
+		if (!path.empty()) {
+			path.push_back(';');
+		}
+		path += *it;
+	}
+
+	if (!path.empty()) {
+		++lineStacks[path];
+	}
+}
+
+std::string LuaProfiler::getCallPath() const
+{
+	std::string path;
+	for (const Frame& frame : frames) {
+		if (!path.empty()) {
+			path.push_back(';');
+		}
+		path += frame.name;
+	}
+	return path;
+}
+
+bool LuaProfiler::writeFolded(const std::string& fileName, const std::map<std::string, uint64_t>& stacks) const
+{
+	std::ofstream file(fileName);
+	for (const auto& it : stacks) {
+		file << it.first << ' ' << it.second << '\n';
+	}
+	return file.good();
+}
+
+void LuaProfiler::clear()
+{
+	frames.clear();
+	scripts.clear();
+	callStacks.clear();
+	lineStacks.clear();
+}
@@ -0,0 +1,106 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FS_LUAPROFILER_H_7A3E9C1D4B6F4E8A9D2C5B0F1E3A6D8C
+#define FS_LUAPROFILER_H_7A3E9C1D4B6F4E8A9D2C5B0F1E3A6D8C
+
+struct lua_State;
+struct lua_Debug;
+
+class LuaScriptInterface;
+
+//Lua instructions between two line samples while sampling is enabled
+static constexpr int LUA_PROFILER_SAMPLE_INSTRUCTIONS = 1000;
+
+/**
+  * Measures where the dispatcher spends its time in scripts. Every protected call made while the
+  * profiler runs is timed and attributed to its event type (script interface) and script file,
+  * nested calls (a script triggering another event) form a call stack. With sampling enabled a
+  * count hook additionally records the Lua stack every LUA_PROFILER_SAMPLE_INSTRUCTIONS instructions.
+  *
+  * Results are written as collapsed stacks (one "frame;frame;frame value" line per stack) that
+  * flamegraph.pl and speedscope read directly: <name>_calls.folded holds self time in microseconds,
+  * <name>_lines.folded holds the line samples.
+  */
+class LuaProfiler
+{
+	public:
+		LuaProfiler() = default;
+
+		// Singleton - ensures we don't accidentally copy it
+		LuaProfiler(LuaProfiler const&) = delete;
+		void operator=(LuaProfiler const&) = delete;
+
+		static LuaProfiler& getInstance() {
+			static LuaProfiler instance;
+			return instance;
+		}
+
+		bool start(lua_State* L, bool sampling);
+		/**
+		  * Stops profiling, writes the results and logs the most expensive scripts.
+		  * \returns the name the output files start with, empty if the profiler was not running
+		  */
+		std::string stop(lua_State* L);
+
+		bool isRunning() const {
+			return running;
+		}
+		bool isSampling() const {
+			return running && sampling;
+		}
+
+		//protectedCall brackets lua_pcall with these two while the profiler runs
+		void enterCall(LuaScriptInterface* scriptInterface, int32_t scriptId);
+		void leaveCall();
+
+	private:
+		struct CallStats {
+			uint64_t calls = 0;
+			int64_t totalTime = 0;
+			int64_t selfTime = 0;
+		};
+
+		struct Frame {
+			std::string name;
+			int64_t start;
+			int64_t childTime;
+		};
+
+		static int64_t now();
+		static void sampleHook(lua_State* L, lua_Debug* ar);
+
+		void sample(lua_State* L);
+		std::string getCallPath() const;
+		bool writeFolded(const std::string& fileName, const std::map<std::string, uint64_t>& stacks) const;
+		void clear();
+
+		std::vector<Frame> frames;
+		std::map<std::string, CallStats> scripts;
+		std::map<std::string, uint64_t> callStacks;
+		std::map<std::string, uint64_t> lineStacks;
+		int64_t startTime = 0;
+		bool running = false;
+		bool sampling = false;
+};
+
+constexpr auto g_luaProfiler = &LuaProfiler::getInstance;
+
+#endif
@@ -38,14 +38,16 @@
 #include "globalevent.h"
 #include "scripts.h"
 #include "weapons.h"
+#include "slab.h"
+#include "luabytecodecache.h"
+#include "luaprofiler.h"
+#include "luaworkers.h"
 
 extern LuaEnvironment g_luaEnvironment;
 
 ScriptEnvironment::DBResultMap ScriptEnvironment::tempResults;
 uint32_t ScriptEnvironment::lastResultId = 0;
 
-std::multimap<ScriptEnvironment*, Item*> ScriptEnvironment::tempItems;
-
 ScriptEnvironment::ScriptEnvironment()
 {
 	resetEnv();
@@ -66,15 +68,17 @@ void ScriptEnvironment::resetEnv()
 	localMap.clear();
 	tempResults.clear();
 
-	auto pair = tempItems.equal_range(this);
-	auto it = pair.first;
-	while (it != pair.second) {
-		Item* item = it->second;
+	//untrack everything first, releasing an item must not reorder the list
+	for (Item* item : tempItems) {
+		item->tempScriptEnv = std::numeric_limits<uint8_t>::max();
+	}
+
+	for (Item* item : tempItems) {
 		if (item->getParent() == VirtualCylinder::virtualCylinder) {
 			g_game().ReleaseItem(item);
 		}
-		it = tempItems.erase(it);
 	}
+	tempItems.clear();
 }
 
 bool ScriptEnvironment::setCallbackId(int32_t callbackId, LuaScriptInterface* scriptInterface)
@@ -191,17 +195,29 @@ void ScriptEnvironment::removeItemByUID(uint32_t uid)
 
 void ScriptEnvironment::addTempItem(Item* item)
 {
-	tempItems.emplace(this, item);
+	if (item->tempScriptEnv != std::numeric_limits<uint8_t>::max()) {
+		return;
+	}
+
+	item->tempScriptEnv = static_cast<uint8_t>(this - LuaScriptInterface::scriptEnv);
+	item->tempItemSlot = static_cast<uint32_t>(tempItems.size());
+	tempItems.push_back(item);
 }
 
 void ScriptEnvironment::removeTempItem(Item* item)
 {
-	for (auto it = tempItems.begin(), end = tempItems.end(); it != end; ++it) {
-		if (it->second == item) {
-			tempItems.erase(it);
-			break;
-		}
+	if (item->tempScriptEnv == std::numeric_limits<uint8_t>::max()) {
+		return;
 	}
+
+	//the last item takes over the slot
+	std::vector<Item*>& items = LuaScriptInterface::scriptEnv[item->tempScriptEnv].tempItems;
+	Item* last = items.back();
+	items[item->tempItemSlot] = last;
+	last->tempItemSlot = item->tempItemSlot;
+	items.pop_back();
+
+	item->tempScriptEnv = std::numeric_limits<uint8_t>::max();
 }
 
 uint32_t ScriptEnvironment::addResult(DBResult_ptr res)
@@ -252,6 +268,8 @@ std::string LuaScriptInterface::getErrorDesc(ErrorCode_t code)
 
 ScriptEnvironment LuaScriptInterface::scriptEnv[16];
 int32_t LuaScriptInterface::scriptEnvIndex = -1;
+std::array<int32_t, LuaData_Last> LuaScriptInterface::metatableRefs;
+std::unordered_map<std::string, lua_Number> LuaScriptInterface::registeredGlobals;
 
 LuaScriptInterface::LuaScriptInterface(std::string interfaceName) : interfaceName(std::move(interfaceName))
 {
@@ -281,7 +299,17 @@ int LuaScriptInterface::protectedCall(lua_State* L, int nargs, int nresults)
 	lua_pushcfunction(L, luaErrorHandler);
 	lua_insert(L, error_index);
 
-	int ret = lua_pcall(L, nargs, nresults, error_index);
+	int ret;
+	LuaProfiler& profiler = g_luaProfiler();
+	if (profiler.isRunning()) {
+		ScriptEnvironment* env = getScriptEnv();
+		profiler.enterCall(env->getScriptInterface(), env->getScriptId());
+		ret = lua_pcall(L, nargs, nresults, error_index);
+		profiler.leaveCall();
+	} else {
+		ret = lua_pcall(L, nargs, nresults, error_index);
+	}
+
 	lua_remove(L, error_index);
 	return ret;
 }
@@ -289,7 +317,10 @@ int LuaScriptInterface::protectedCall(lua_State* L, int nargs, int nresults)
 int32_t LuaScriptInterface::loadFile(const std::string& file, Npc* npc /* = nullptr*/)
 {
 	//loads file as a chunk at stack top
-	int ret = luaL_loadfile(luaState, file.c_str());
+	int ret = 0;
+	if (!g_luaBytecodeCache().load(luaState, file)) {
+		ret = luaL_loadfile(luaState, file.c_str());
+	}
 	if (ret != 0) {
 		lastLuaError = popString(luaState);
 		return -1;
@@ -505,6 +536,8 @@ bool LuaScriptInterface::closeState()
 		return false;
 	}
 
+	g_luaEnvironment.clearThreadInterface(this);
+
 	cacheFiles.clear();
 	if (eventTableRef != -1) {
 		luaL_unref(luaState, LUA_REGISTRYINDEX, eventTableRef);
@@ -611,8 +644,7 @@ void LuaScriptInterface::pushCylinder(lua_State* L, Cylinder* cylinder)
 		pushUserdata<Item>(L, parentItem);
 		setItemMetatable(L, -1, parentItem);
 	} else if (Tile* tile = cylinder->getTile()) {
-		pushUserdata<Tile>(L, tile);
-		setMetatable(L, -1, "Tile");
+		pushUserdata<Tile>(L, tile, LuaData_Tile);
 	} else if (cylinder == VirtualCylinder::virtualCylinder) {
 		pushBoolean(L, true);
 	} else {
@@ -641,6 +673,20 @@ std::string LuaScriptInterface::popString(lua_State* L)
 	return str;
 }
 
+bool LuaScriptInterface::dumpFunction(lua_State* L, std::string& bytecode)
+{
+	auto writer = [](lua_State*, const void* p, size_t size, void* data) {
+		static_cast<std::string*>(data)->append(static_cast<const char*>(p), size);
+		return 0;
+	};
+
+#if LUA_VERSION_NUM >= 503
+	return lua_dump(L, writer, &bytecode, 0) == 0 && !bytecode.empty();
+#else
+	return lua_dump(L, writer, &bytecode) == 0 && !bytecode.empty();
+#endif
+}
+
 int32_t LuaScriptInterface::popCallback(lua_State* L)
 {
 	return luaL_ref(L, LUA_REGISTRYINDEX);
@@ -691,25 +737,23 @@ void LuaScriptInterface::setWeakMetatable(lua_State* L, int32_t index, const std
 void LuaScriptInterface::setItemMetatable(lua_State* L, int32_t index, const Item* item)
 {
 	if (item->getContainer()) {
-		luaL_getmetatable(L, "Container");
+		setMetatable(L, index, LuaData_Container);
 	} else if (item->getTeleport()) {
-		luaL_getmetatable(L, "Teleport");
+		setMetatable(L, index, LuaData_Teleport);
 	} else {
-		luaL_getmetatable(L, "Item");
+		setMetatable(L, index, LuaData_Item);
 	}
-	lua_setmetatable(L, index - 1);
 }
 
 void LuaScriptInterface::setCreatureMetatable(lua_State* L, int32_t index, const Creature* creature)
 {
 	if (creature->getPlayer()) {
-		luaL_getmetatable(L, "Player");
+		setMetatable(L, index, LuaData_Player);
 	} else if (creature->getMonster()) {
-		luaL_getmetatable(L, "Monster");
+		setMetatable(L, index, LuaData_Monster);
 	} else {
-		luaL_getmetatable(L, "Npc");
+		setMetatable(L, index, LuaData_Npc);
 	}
-	lua_setmetatable(L, index - 1);
 }
 
 // Get
@@ -884,12 +928,243 @@ LuaDataType LuaScriptInterface::getUserdataType(lua_State* L, int32_t arg)
 	}
 	lua_rawgeti(L, -1, 't');
 
-	LuaDataType type = getNumber<LuaDataType>(L, -1);
+	LuaDataType type = static_cast<LuaDataType>(lua_tointeger(L, -1));
 	lua_pop(L, 2);
 
 	return type;
 }
 
+namespace {
+
+//calls visit with each local and upvalue of the suspended coroutine L on top of its stack, the value is set to nil if visit returns true
+template <typename Visit>
+void visitThreadValues(lua_State* L, Visit visit)
+{
+	lua_Debug ar;
+	for (int level = 0; lua_getstack(L, level, &ar) == 1; ++level) {
+		for (int n = 1; lua_getlocal(L, &ar, n); ++n) {
+			bool clear = visit(L);
+			lua_pop(L, 1);
+			if (clear) {
+				lua_pushnil(L);
+				lua_setlocal(L, &ar, n);
+			}
+		}
+
+		lua_getinfo(L, "f", &ar);
+		for (int n = 1; lua_getupvalue(L, -1, n); ++n) {
+			bool clear = visit(L);
+			lua_pop(L, 1);
+			if (clear) {
+				lua_pushnil(L);
+				lua_setupvalue(L, -2, n);
+			}
+		}
+		lua_pop(L, 1);
+	}
+}
+
+//calls visit with every userdata the suspended coroutine L can reach: the locals, varargs and upvalues of its
+//frames and whatever the tables and closures found there hold. Metatables and the globals are not followed,
+//those are shared with every other script. The userdata is on top of the stack while visit runs.
+template <typename Visit>
+void visitReachableUserdata(lua_State* L, Visit visit)
+{
+	if (!lua_checkstack(L, 16)) {
+		return;
+	}
+
+	const int top = lua_gettop(L);
+	lua_newtable(L);
+	const int seen = top + 1;
+	lua_newtable(L);
+	const int pending = top + 2;
+	int count = 0;
+
+	auto markSeen = [&](int index) {
+		lua_pushvalue(L, index);
+		lua_pushboolean(L, 1);
+		lua_rawset(L, seen);
+	};
+
+	//both tables are temporaries of the frame that yielded, they would be walked otherwise
+	markSeen(seen);
+	markSeen(pending);
+#if LUA_VERSION_NUM >= 502
+	lua_pushglobaltable(L);
+#else
+	lua_pushvalue(L, LUA_GLOBALSINDEX);
+#endif
+	markSeen(lua_gettop(L));
+	lua_pop(L, 1);
+
+	//pops the value on top, keeping it for later if it can lead to userdata
+	auto enqueue = [&]() {
+		int type = lua_type(L, -1);
+		if (type == LUA_TTABLE || type == LUA_TFUNCTION || type == LUA_TUSERDATA) {
+			lua_rawseti(L, pending, ++count);
+		} else {
+			lua_pop(L, 1);
+		}
+	};
+
+	lua_Debug ar;
+	for (int level = 0; lua_getstack(L, level, &ar) == 1; ++level) {
+		for (int n = 1; lua_getlocal(L, &ar, n); ++n) {
+			enqueue();
+		}
+		//plain Lua 5.1 has no way to reach the varargs of a frame
+#if LUA_VERSION_NUM >= 502 || defined(LUAJIT_VERSION_NUM)
+		for (int n = -1; lua_getlocal(L, &ar, n); --n) {
+			enqueue();
+		}
+#endif
+		lua_getinfo(L, "f", &ar);
+		enqueue();
+	}
+
+	while (count > 0) {
+		lua_rawgeti(L, pending, count);
+		lua_pushnil(L);
+		lua_rawseti(L, pending, count--);
+
+		int type = lua_type(L, -1);
+		if (type == LUA_TUSERDATA) {
+			visit(L);
+			lua_pop(L, 1);
+			continue;
+		}
+
+		lua_pushvalue(L, -1);
+		lua_rawget(L, seen);
+		bool known = lua_toboolean(L, -1) != 0;
+		lua_pop(L, 1);
+		if (known) {
+			lua_pop(L, 1);
+			continue;
+		}
+		markSeen(lua_gettop(L));
+
+		if (type == LUA_TTABLE) {
+			lua_pushnil(L);
+			while (lua_next(L, -2) != 0) {
+				lua_pushvalue(L, -2);
+				enqueue();
+				enqueue();
+			}
+		} else {
+			for (int n = 1; lua_getupvalue(L, -1, n); ++n) {
+				enqueue();
+			}
+		}
+		lua_pop(L, 1);
+	}
+	lua_settop(L, top);
+}
+
+bool isCreatureType(LuaDataType type)
+{
+	return type == LuaData_Player || type == LuaData_Monster || type == LuaData_Npc;
+}
+
+bool isItemType(LuaDataType type)
+{
+	return type == LuaData_Item || type == LuaData_Container || type == LuaData_Teleport;
+}
+
+}
+
+int LuaScriptInterface::resumeCoroutine(lua_State* L, int nargs)
+{
+#if LUA_VERSION_NUM >= 504
+	int nresults;
+	return lua_resume(L, nullptr, nargs, &nresults);
+#elif LUA_VERSION_NUM >= 502
+	return lua_resume(L, nullptr, nargs);
+#else
+	return lua_resume(L, nargs);
+#endif
+}
+
+void LuaScriptInterface::pinThreadObjects(lua_State* L, LuaThreadObjects& objects)
+{
+	lua_newtable(L);
+	objects.anchorRef = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	visitReachableUserdata(L, [&objects](lua_State* L) {
+		LuaDataType type = getUserdataType(L, -1);
+		void* userdata = lua_touserdata(L, -1);
+		if (isCreatureType(type)) {
+			Creature* creature = getUserdata<Creature>(L, -1);
+			if (!creature) {
+				return;
+			}
+			creature->incrementReferenceCounter();
+			objects.creatures.emplace_back(userdata, creature);
+		} else if (isItemType(type)) {
+			Item* item = getUserdata<Item>(L, -1);
+			if (!item) {
+				return;
+			}
+			item->incrementReferenceCounter();
+			objects.items.emplace_back(userdata, item);
+		} else {
+			return;
+		}
+
+		lua_rawgeti(L, LUA_REGISTRYINDEX, objects.anchorRef);
+		lua_pushvalue(L, -2);
+		lua_pushboolean(L, 1);
+		lua_rawset(L, -3);
+		lua_pop(L, 1);
+	});
+}
+
+void LuaScriptInterface::releaseThreadObjects(lua_State* L, LuaThreadObjects& objects)
+{
+	std::unordered_set<const void*> removed;
+	for (const auto& it : objects.creatures) {
+		if (it.second->isRemoved()) {
+			removed.insert(it.first);
+		}
+	}
+	for (const auto& it : objects.items) {
+		if (it.second->isRemoved()) {
+			removed.insert(it.first);
+		}
+	}
+
+	if (!removed.empty()) {
+		visitThreadValues(L, [&removed](lua_State* L) {
+			return lua_type(L, -1) == LUA_TUSERDATA && removed.find(lua_touserdata(L, -1)) != removed.end();
+		});
+
+		//anything else still holding the userdata, tables included, now sees a missing object
+		for (const auto& it : objects.creatures) {
+			if (removed.find(it.first) != removed.end()) {
+				*static_cast<Creature**>(it.first) = nullptr;
+			}
+		}
+		for (const auto& it : objects.items) {
+			if (removed.find(it.first) != removed.end()) {
+				*static_cast<Item**>(it.first) = nullptr;
+			}
+		}
+	}
+
+	for (const auto& it : objects.creatures) {
+		it.second->decrementReferenceCounter();
+	}
+	for (const auto& it : objects.items) {
+		it.second->decrementReferenceCounter();
+	}
+
+	if (objects.anchorRef != -1) {
+		luaL_unref(L, LUA_REGISTRYINDEX, objects.anchorRef);
+	}
+	objects = {};
+}
+
 // Push
 void LuaScriptInterface::pushBoolean(lua_State* L, bool value)
 {
@@ -1048,6 +1323,15 @@ void LuaScriptInterface::registerFunctions()
 	//stopEvent(eventid)
 	lua_register(luaState, "stopEvent", LuaScriptInterface::luaStopEvent);
 
+	//async(callback, ...)
+	lua_register(luaState, "async", LuaScriptInterface::luaAsync);
+
+	//sleep(milliseconds)
+	lua_register(luaState, "sleep", LuaScriptInterface::luaSleep);
+
+	//pure(callback)
+	lua_register(luaState, "pure", LuaScriptInterface::luaPure);
+
 	//saveServer()
 	lua_register(luaState, "saveServer", LuaScriptInterface::luaSaveServer);
 
@@ -2066,6 +2350,11 @@ void LuaScriptInterface::registerFunctions()
 
 	registerMethod("Game", "reload", LuaScriptInterface::luaGameReload);
 
+	registerMethod("Game", "getAllocatorStats", LuaScriptInterface::luaGameGetAllocatorStats);
+
+	registerMethod("Game", "startLuaProfiler", LuaScriptInterface::luaGameStartLuaProfiler);
+	registerMethod("Game", "stopLuaProfiler", LuaScriptInterface::luaGameStopLuaProfiler);
+
 	// Variant
 	registerClass("Variant", "", LuaScriptInterface::luaVariantCreate);
 
@@ -2280,6 +2569,7 @@ void LuaScriptInterface::registerFunctions()
 	registerMethod("Creature", "getParent", LuaScriptInterface::luaCreatureGetParent);
 
 	registerMethod("Creature", "getId", LuaScriptInterface::luaCreatureGetId);
+	registerMethod("Creature", "getHandle", LuaScriptInterface::luaCreatureGetHandle);
 	registerMethod("Creature", "getName", LuaScriptInterface::luaCreatureGetName);
 
 	registerMethod("Creature", "getTarget", LuaScriptInterface::luaCreatureGetTarget);
@@ -3089,25 +3379,34 @@ void LuaScriptInterface::registerClass(const std::string& className, const std::
 	lua_rawseti(luaState, metatable, 'p');
 
 	// className.metatable['t'] = type
+	LuaDataType type;
 	if (!tfs_strcmp(className.c_str(), "Item")) {
-		lua_pushnumber(luaState, LuaData_Item);
+		type = LuaData_Item;
 	} else if (!tfs_strcmp(className.c_str(), "Container")) {
-		lua_pushnumber(luaState, LuaData_Container);
+		type = LuaData_Container;
 	} else if (!tfs_strcmp(className.c_str(), "Teleport")) {
-		lua_pushnumber(luaState, LuaData_Teleport);
+		type = LuaData_Teleport;
 	} else if (!tfs_strcmp(className.c_str(), "Player")) {
-		lua_pushnumber(luaState, LuaData_Player);
+		type = LuaData_Player;
 	} else if (!tfs_strcmp(className.c_str(), "Monster")) {
-		lua_pushnumber(luaState, LuaData_Monster);
+		type = LuaData_Monster;
 	} else if (!tfs_strcmp(className.c_str(), "Npc")) {
-		lua_pushnumber(luaState, LuaData_Npc);
+		type = LuaData_Npc;
 	} else if (!tfs_strcmp(className.c_str(), "Tile")) {
-		lua_pushnumber(luaState, LuaData_Tile);
+		type = LuaData_Tile;
 	} else {
-		lua_pushnumber(luaState, LuaData_Unknown);
+		type = LuaData_Unknown;
 	}
+	lua_pushnumber(luaState, type);
 	lua_rawseti(luaState, metatable, 't');
 
+	// the typed classes are pushed all the time, keep their metatables at a fixed registry slot
+	// there is only the one state of g_luaEnvironment, a new state replaces the references of the old one
+	if (type != LuaData_Unknown) {
+		lua_pushvalue(luaState, metatable);
+		metatableRefs[type] = luaL_ref(luaState, LUA_REGISTRYINDEX);
+	}
+
 	// pop className, className.metatable
 	lua_pop(luaState, 2);
 }
@@ -3163,6 +3462,17 @@ void LuaScriptInterface::registerGlobalVariable(const std::string& name, lua_Num
 	// _G[name] = value
 	lua_pushnumber(luaState, value);
 	lua_setglobal(luaState, name.c_str());
+	registeredGlobals[name] = value;
+}
+
+bool LuaScriptInterface::getRegisteredGlobal(const std::string& name, lua_Number& value)
+{
+	auto it = registeredGlobals.find(name);
+	if (it == registeredGlobals.end()) {
+		return false;
+	}
+	value = it->second;
+	return true;
 }
 
 void LuaScriptInterface::registerGlobalBoolean(const std::string& name, bool value)
@@ -3977,6 +4287,101 @@ int LuaScriptInterface::luaStopEvent(lua_State* L)
 	return 1;
 }
 
+int LuaScriptInterface::luaAsync(lua_State* L)
+{
+	//async(callback, ...)
+	if (!isFunction(L, 1)) {
+		reportErrorFunc("callback parameter should be a function.");
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	g_luaEnvironment.startThread(L, lua_gettop(L));
+	pushBoolean(L, true);
+	return 1;
+}
+
+int LuaScriptInterface::luaSleep(lua_State* L)
+{
+	//sleep(milliseconds)
+	uint32_t waitId = g_luaEnvironment.suspendThread(L);
+	if (waitId == 0) {
+		reportErrorFunc("sleep can only be called from a function started by async.");
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	uint32_t delay = std::max<uint32_t>(100, getNumber<uint32_t>(L, 1));
+	g_dispatcher().addEvent(delay, [L, waitId]() {
+		g_luaEnvironment.resumeThread(L, waitId);
+	});
+	return lua_yield(L, 0);
+}
+
+int LuaScriptInterface::luaPure(lua_State* L)
+{
+	//pure(callback)
+	if (!isFunction(L, 1)) {
+		reportErrorFunc("callback parameter should be a function.");
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	std::string error;
+	uint32_t functionId = g_luaWorkers().addFunction(L, 1, error);
+	if (functionId == 0) {
+		reportErrorFunc(error);
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	lua_pushnumber(L, functionId);
+	lua_pushcclosure(L, LuaScriptInterface::luaPureCall, 1);
+	return 1;
+}
+
+int LuaScriptInterface::luaPureCall(lua_State* L)
+{
+	//pureFunction(...)
+	uint32_t functionId = getNumber<uint32_t>(L, lua_upvalueindex(1));
+
+	PureValues args;
+	std::string error;
+	if (!LuaWorkers::getValues(L, 1, lua_gettop(L), args, error)) {
+		reportErrorFunc(error);
+		lua_pushnil(L);
+		return 1;
+	}
+
+	uint32_t waitId = g_luaEnvironment.suspendThread(L);
+	if (waitId == 0) {
+		//outside of async the caller needs the results right away
+		PureValues results;
+		if (!g_luaWorkers().call(functionId, args, results, error)) {
+			reportErrorFunc(error);
+			lua_pushnil(L);
+			return 1;
+		}
+
+		LuaWorkers::pushValues(L, results);
+		return results.size();
+	}
+
+	g_luaWorkers().addTask(functionId, std::move(args), [L, waitId](bool success, PureValues results, const std::string& error) {
+		g_luaEnvironment.resumeThread(L, waitId, [&](lua_State* L) {
+			if (!success) {
+				reportError("pure", error, true);
+				lua_pushnil(L);
+				return 1;
+			}
+
+			LuaWorkers::pushValues(L, results);
+			return static_cast<int>(results.size());
+		});
+	});
+	return lua_yield(L, 0);
+}
+
 int LuaScriptInterface::luaSaveServer(lua_State* L)
 {
 	g_game().saveGameState();
@@ -4149,6 +4554,8 @@ const luaL_Reg LuaScriptInterface::luaDatabaseTable[] = {
 	{"asyncQuery", LuaScriptInterface::luaDatabaseAsyncExecute},
 	{"storeQuery", LuaScriptInterface::luaDatabaseStoreQuery},
 	{"asyncStoreQuery", LuaScriptInterface::luaDatabaseAsyncStoreQuery},
+	{"awaitQuery", LuaScriptInterface::luaDatabaseAwaitQuery},
+	{"awaitStoreQuery", LuaScriptInterface::luaDatabaseAwaitStoreQuery},
 	{"escapeString", LuaScriptInterface::luaDatabaseEscapeString},
 	{"escapeBlob", LuaScriptInterface::luaDatabaseEscapeBlob},
 	{"lastInsertId", LuaScriptInterface::luaDatabaseLastInsertId},
@@ -4274,6 +4681,49 @@ int LuaScriptInterface::luaDatabaseAsyncStoreQuery(lua_State* L)
 	return 0;
 }
 
+int LuaScriptInterface::luaDatabaseAwaitQuery(lua_State* L)
+{
+	// db.awaitQuery(query)
+	uint32_t waitId = g_luaEnvironment.suspendThread(L);
+	if (waitId == 0) {
+		reportErrorFunc("db.awaitQuery can only be called from a function started by async.");
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	g_databaseTasks().addTask(getString(L, 1), [L, waitId](DBResult_ptr, bool success) {
+		g_luaEnvironment.resumeThread(L, waitId, [success](lua_State* L) {
+			pushBoolean(L, success);
+			return 1;
+		});
+	});
+	return lua_yield(L, 0);
+}
+
+int LuaScriptInterface::luaDatabaseAwaitStoreQuery(lua_State* L)
+{
+	// db.awaitStoreQuery(query)
+	uint32_t waitId = g_luaEnvironment.suspendThread(L);
+	if (waitId == 0) {
+		reportErrorFunc("db.awaitStoreQuery can only be called from a function started by async.");
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	g_databaseTasks().addTask(getString(L, 1), [L, waitId](DBResult_ptr result, bool) {
+		g_luaEnvironment.resumeThread(L, waitId, [result](lua_State* L) {
+			//result ids stay valid until the coroutine waits again or returns
+			if (result) {
+				lua_pushnumber(L, ScriptEnvironment::addResult(result));
+			} else {
+				pushBoolean(L, false);
+			}
+			return 1;
+		});
+	}, true);
+	return lua_yield(L, 0);
+}
+
 int LuaScriptInterface::luaDatabaseEscapeString(lua_State* L)
 {
 	pushString(L, g_database().escapeString(getString(L, -1)));
@@ -4501,8 +4951,7 @@ int LuaScriptInterface::luaGameGetPlayers(lua_State* L)
 
 	int index = 0;
 	for (const auto& playerEntry : g_game().getPlayers()) {
-		pushUserdata<Player>(L, playerEntry.second);
-		setMetatable(L, -1, "Player");
+		pushUserdata<Player>(L, playerEntry.second, LuaData_Player);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -4705,8 +5154,7 @@ int LuaScriptInterface::luaGameCreateContainer(lua_State* L)
 		container->setParent(VirtualCylinder::virtualCylinder);
 	}
 
-	pushUserdata<Container>(L, container);
-	setMetatable(L, -1, "Container");
+	pushUserdata<Container>(L, container, LuaData_Container);
 	return 1;
 }
 
@@ -4734,8 +5182,7 @@ int LuaScriptInterface::luaGameCreateMonster(lua_State* L)
 	bool extended = getBoolean(L, 3, false);
 	bool force = getBoolean(L, 4, false);
 	if (g_game().placeCreature(monster, position, extended, force)) {
-		pushUserdata<Monster>(L, monster);
-		setMetatable(L, -1, "Monster");
+		pushUserdata<Monster>(L, monster, LuaData_Monster);
 	} else {
 		if (isSummon) {
 			monster->setMaster(nullptr);
@@ -4760,8 +5207,7 @@ int LuaScriptInterface::luaGameCreateNpc(lua_State* L)
 	bool extended = getBoolean(L, 3, false);
 	bool force = getBoolean(L, 4, false);
 	if (g_game().placeCreature(npc, position, extended, force)) {
-		pushUserdata<Npc>(L, npc);
-		setMetatable(L, -1, "Npc");
+		pushUserdata<Npc>(L, npc, LuaData_Npc);
 	} else {
 		delete npc;
 		lua_pushnil(L);
@@ -4797,7 +5243,7 @@ int LuaScriptInterface::luaGameCreateTile(lua_State* L)
 	}
 
 	pushUserdata(L, tile);
-	setMetatable(L, -1, "Tile");
+	setMetatable(L, -1, LuaData_Tile);
 	return 1;
 }
 
@@ -4875,6 +5321,42 @@ int LuaScriptInterface::luaGameReload(lua_State* L)
 	return 1;
 }
 
+int LuaScriptInterface::luaGameGetAllocatorStats(lua_State* L)
+{
+	// Game.getAllocatorStats()
+	const auto& allocators = SlabAllocator::getAllocators();
+	lua_createtable(L, 0, allocators.size());
+	for (const SlabAllocator* allocator : allocators) {
+		lua_createtable(L, 0, 4);
+		setField(L, "allocations", allocator->getAllocations());
+		setField(L, "deallocations", allocator->getDeallocations());
+		setField(L, "live", allocator->getAllocations() - allocator->getDeallocations());
+		setField(L, "reserved", allocator->getReservedBytes());
+		lua_setfield(L, -2, allocator->getName().c_str());
+	}
+	return 1;
+}
+
+int LuaScriptInterface::luaGameStartLuaProfiler(lua_State* L)
+{
+	// Game.startLuaProfiler([sampling = false])
+	bool sampling = getBoolean(L, 1, false);
+	pushBoolean(L, g_luaProfiler().start(g_luaEnvironment.getLuaState(), sampling));
+	return 1;
+}
+
+int LuaScriptInterface::luaGameStopLuaProfiler(lua_State* L)
+{
+	// Game.stopLuaProfiler()
+	std::string name = g_luaProfiler().stop(g_luaEnvironment.getLuaState());
+	if (!name.empty()) {
+		pushString(L, name);
+	} else {
+		lua_pushnil(L);
+	}
+	return 1;
+}
+
 // Variant
 int LuaScriptInterface::luaVariantCreate(lua_State* L)
 {
@@ -5091,8 +5573,7 @@ int LuaScriptInterface::luaTileCreate(lua_State* L)
 	}
 
 	if (tile) {
-		pushUserdata<Tile>(L, tile);
-		setMetatable(L, -1, "Tile");
+		pushUserdata<Tile>(L, tile, LuaData_Tile);
 	} else {
 		lua_pushnil(L);
 	}
@@ -5115,9 +5596,10 @@ int LuaScriptInterface::luaTileGetGround(lua_State* L)
 {
 	// tile:getGround()
 	Tile* tile = getUserdata<Tile>(L, 1);
-	if (tile && tile->getGround()) {
-		pushUserdata<Item>(L, tile->getGround());
-		setItemMetatable(L, -1, tile->getGround());
+	Item* ground = tile ? tile->unshareGround() : nullptr;
+	if (ground) {
+		pushUserdata<Item>(L, ground);
+		setItemMetatable(L, -1, ground);
 	} else {
 		lua_pushnil(L);
 	}
@@ -5140,6 +5622,10 @@ int LuaScriptInterface::luaTileGetThing(lua_State* L)
 		return 1;
 	}
 
+	if (thing == tile->getGround()) {
+		thing = tile->unshareGround();
+	}
+
 	if (Creature* creature = thing->getCreature()) {
 		pushUserdata<Creature>(L, creature);
 		setCreatureMetatable(L, -1, creature);
@@ -5178,6 +5664,8 @@ int LuaScriptInterface::luaTileGetTopVisibleThing(lua_State* L)
 	if (!thing) {
 		lua_pushnil(L);
 		return 1;
+	} else if (thing == tile->getGround()) {
+		thing = tile->unshareGround();
 	}
 
 	if (Creature* visibleCreature = thing->getCreature()) {
@@ -5272,6 +5760,9 @@ int LuaScriptInterface::luaTileGetItemById(lua_State* L)
 
 	Item* item = g_game().findItemOfType(tile, itemId, false, subType);
 	if (item) {
+		if (item->isShared()) {
+			item = tile->unshareGround();
+		}
 		pushUserdata<Item>(L, item);
 		setItemMetatable(L, -1, item);
 	} else {
@@ -5324,6 +5815,7 @@ int LuaScriptInterface::luaTileGetItemByType(lua_State* L)
 	if (Item* item = tile->getGround()) {
 		const ItemType& it = Item::items[item->getID()];
 		if (it.type == itemType) {
+			item = tile->unshareGround();
 			pushUserdata<Item>(L, item);
 			setItemMetatable(L, -1, item);
 			return 1;
@@ -6470,6 +6962,7 @@ int LuaScriptInterface::luaItemSetActionId(lua_State* L)
 	Item* item = getUserdata<Item>(L, 1);
 	if (item) {
 		item->setActionId(actionId);
+		item->notifyTileChanged();
 		pushBoolean(L, true);
 	} else {
 		lua_pushnil(L);
@@ -6596,8 +7089,7 @@ int LuaScriptInterface::luaItemGetTile(lua_State* L)
 
 	Tile* tile = item->getTile();
 	if (tile) {
-		pushUserdata<Tile>(L, tile);
-		setMetatable(L, -1, "Tile");
+		pushUserdata<Tile>(L, tile, LuaData_Tile);
 	} else {
 		lua_pushnil(L);
 	}
@@ -6667,6 +7159,7 @@ int LuaScriptInterface::luaItemSetAttribute(lua_State* L)
 		lua_pushnil(L);
 		return 1;
 	}
+	item->notifyTileChanged();
 
 	itemAttrTypes attribute;
 	if (isNumber(L, 2)) {
@@ -6728,6 +7221,7 @@ int LuaScriptInterface::luaItemRemoveAttribute(lua_State* L)
 		lua_pushnil(L);
 		return 1;
 	}
+	item->notifyTileChanged();
 
 	itemAttrTypes attribute;
 	if (isNumber(L, 2)) {
@@ -6786,6 +7280,7 @@ int LuaScriptInterface::luaItemSetCustomAttribute(lua_State* L) {
 		lua_pushnil(L);
 		return 1;
 	}
+	item->notifyTileChanged();
 
 	std::string key;
 	if (isNumber(L, 2)) {
@@ -6826,6 +7321,7 @@ int LuaScriptInterface::luaItemRemoveCustomAttribute(lua_State* L) {
 		lua_pushnil(L);
 		return 1;
 	}
+	item->notifyTileChanged();
 
 	if (isNumber(L, 2)) {
 		pushBoolean(L, item->removeCustomAttribute(getNumber<int64_t>(L, 2)));
@@ -7031,7 +7527,7 @@ int LuaScriptInterface::luaContainerCreate(lua_State* L)
 
 	if (container) {
 		pushUserdata(L, container);
-		setMetatable(L, -1, "Container");
+		setMetatable(L, -1, LuaData_Container);
 	} else {
 		lua_pushnil(L);
 	}
@@ -7264,7 +7760,7 @@ int LuaScriptInterface::luaTeleportCreate(lua_State* L)
 	Item* item = getScriptEnv()->getItemByUID(id);
 	if (item && item->getTeleport()) {
 		pushUserdata(L, item);
-		setMetatable(L, -1, "Teleport");
+		setMetatable(L, -1, LuaData_Teleport);
 	} else {
 		lua_pushnil(L);
 	}
@@ -7299,10 +7795,15 @@ int LuaScriptInterface::luaTeleportSetDestination(lua_State* L)
 // Creature
 int LuaScriptInterface::luaCreatureCreate(lua_State* L)
 {
-	// Creature(id or name or userdata)
+	// Creature(id or handle or name or userdata)
 	Creature* creature;
 	if (isNumber(L, 2)) {
-		creature = g_game().getCreatureByID(getNumber<uint32_t>(L, 2));
+		uint64_t id = getNumber<uint64_t>(L, 2);
+		if (CreatureHandleTable::isHandle(id)) {
+			creature = g_game().getCreatureByHandle(id);
+		} else {
+			creature = g_game().getCreatureByID(id);
+		}
 	} else if (isString(L, 2)) {
 		creature = g_game().getCreatureByName(getString(L, 2));
 	} else if (isUserdata(L, 2)) {
@@ -7476,6 +7977,18 @@ int LuaScriptInterface::luaCreatureGetId(lua_State* L)
 	return 1;
 }
 
+int LuaScriptInterface::luaCreatureGetHandle(lua_State* L)
+{
+	// creature:getHandle()
+	const Creature* creature = getUserdata<const Creature>(L, 1);
+	if (creature) {
+		lua_pushnumber(L, creature->getHandle());
+	} else {
+		lua_pushnil(L);
+	}
+	return 1;
+}
+
 int LuaScriptInterface::luaCreatureGetName(lua_State* L)
 {
 	// creature:getName()
@@ -7730,8 +8243,7 @@ int LuaScriptInterface::luaCreatureGetTile(lua_State* L)
 
 	Tile* tile = creature->getTile();
 	if (tile) {
-		pushUserdata<Tile>(L, tile);
-		setMetatable(L, -1, "Tile");
+		pushUserdata<Tile>(L, tile, LuaData_Tile);
 	} else {
 		lua_pushnil(L);
 	}
@@ -8241,11 +8753,14 @@ int LuaScriptInterface::luaCreatureGetZone(lua_State* L)
 // Player
 int LuaScriptInterface::luaPlayerCreate(lua_State* L)
 {
-	// Player(id or guid or name or userdata)
+	// Player(id or handle or guid or name or userdata)
 	Player* player;
 	if (isNumber(L, 2)) {
-		uint32_t id = getNumber<uint32_t>(L, 2);
-		if (id >= 0x10000000 && id <= Player::playerAutoID) {
+		uint64_t id = getNumber<uint64_t>(L, 2);
+		if (CreatureHandleTable::isHandle(id)) {
+			Creature* creature = g_game().getCreatureByHandle(id);
+			player = creature ? creature->getPlayer() : nullptr;
+		} else if (id >= 0x10000000 && id <= Player::playerAutoID) {
 			player = g_game().getPlayerByID(id);
 		} else {
 			player = g_game().getPlayerByGUID(id);
@@ -8268,8 +8783,7 @@ int LuaScriptInterface::luaPlayerCreate(lua_State* L)
 	}
 
 	if (player) {
-		pushUserdata<Player>(L, player);
-		setMetatable(L, -1, "Player");
+		pushUserdata<Player>(L, player, LuaData_Player);
 	} else {
 		lua_pushnil(L);
 	}
@@ -10301,8 +10815,7 @@ int LuaScriptInterface::luaPlayerGetContainerById(lua_State* L)
 
 	Container* container = player->getContainerByID(getNumber<uint8_t>(L, 2));
 	if (container) {
-		pushUserdata<Container>(L, container);
-		setMetatable(L, -1, "Container");
+		pushUserdata<Container>(L, container, LuaData_Container);
 	} else {
 		lua_pushnil(L);
 	}
@@ -10401,10 +10914,16 @@ int LuaScriptInterface::luaPlayerGetFightMode(lua_State* L)
 // Monster
 int LuaScriptInterface::luaMonsterCreate(lua_State* L)
 {
-	// Monster(id or userdata)
+	// Monster(id or handle or userdata)
 	Monster* monster;
 	if (isNumber(L, 2)) {
-		monster = g_game().getMonsterByID(getNumber<uint32_t>(L, 2));
+		uint64_t id = getNumber<uint64_t>(L, 2);
+		if (CreatureHandleTable::isHandle(id)) {
+			Creature* creature = g_game().getCreatureByHandle(id);
+			monster = creature ? creature->getMonster() : nullptr;
+		} else {
+			monster = g_game().getMonsterByID(id);
+		}
 	} else if (isUserdata(L, 2)) {
 		if (getUserdataType(L, 2) != LuaData_Monster) {
 			lua_pushnil(L);
@@ -10416,8 +10935,7 @@ int LuaScriptInterface::luaMonsterCreate(lua_State* L)
 	}
 
 	if (monster) {
-		pushUserdata<Monster>(L, monster);
-		setMetatable(L, -1, "Monster");
+		pushUserdata<Monster>(L, monster, LuaData_Monster);
 	} else {
 		lua_pushnil(L);
 	}
@@ -10719,11 +11237,17 @@ int LuaScriptInterface::luaMonsterSearchTarget(lua_State* L)
 // Npc
 int LuaScriptInterface::luaNpcCreate(lua_State* L)
 {
-	// Npc([id or name or userdata])
+	// Npc([id or handle or name or userdata])
 	Npc* npc;
 	if (lua_gettop(L) >= 2) {
 		if (isNumber(L, 2)) {
-			npc = g_game().getNpcByID(getNumber<uint32_t>(L, 2));
+			uint64_t id = getNumber<uint64_t>(L, 2);
+			if (CreatureHandleTable::isHandle(id)) {
+				Creature* creature = g_game().getCreatureByHandle(id);
+				npc = creature ? creature->getNpc() : nullptr;
+			} else {
+				npc = g_game().getNpcByID(id);
+			}
 		} else if (isString(L, 2)) {
 			npc = g_game().getNpcByName(getString(L, 2));
 		} else if (isUserdata(L, 2)) {
@@ -10740,8 +11264,7 @@ int LuaScriptInterface::luaNpcCreate(lua_State* L)
 	}
 
 	if (npc) {
-		pushUserdata<Npc>(L, npc);
-		setMetatable(L, -1, "Npc");
+		pushUserdata<Npc>(L, npc, LuaData_Npc);
 	} else {
 		lua_pushnil(L);
 	}
@@ -10847,8 +11370,7 @@ int LuaScriptInterface::luaGuildGetMembersOnline(lua_State* L)
 
 	int index = 0;
 	for (Player* player : members) {
-		pushUserdata<Player>(L, player);
-		setMetatable(L, -1, "Player");
+		pushUserdata<Player>(L, player, LuaData_Player);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -11630,8 +12152,7 @@ int LuaScriptInterface::luaHouseGetTiles(lua_State* L)
 
 	int index = 0;
 	for (Tile* tile : tiles) {
-		pushUserdata<Tile>(L, tile);
-		setMetatable(L, -1, "Tile");
+		pushUserdata<Tile>(L, tile, LuaData_Tile);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -14127,8 +14648,7 @@ int LuaScriptInterface::luaPartyGetLeader(lua_State* L)
 
 	Player* leader = party->getLeader();
 	if (leader) {
-		pushUserdata<Player>(L, leader);
-		setMetatable(L, -1, "Player");
+		pushUserdata<Player>(L, leader, LuaData_Player);
 	} else {
 		lua_pushnil(L);
 	}
@@ -14160,8 +14680,7 @@ int LuaScriptInterface::luaPartyGetMembers(lua_State* L)
 	int index = 0;
 	lua_createtable(L, party->getMemberCount(), 0);
 	for (Player* player : party->getMembers()) {
-		pushUserdata<Player>(L, player);
-		setMetatable(L, -1, "Player");
+		pushUserdata<Player>(L, player, LuaData_Player);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -14188,8 +14707,7 @@ int LuaScriptInterface::luaPartyGetInvitees(lua_State* L)
 
 		int index = 0;
 		for (Player* player : party->getInvitees()) {
-			pushUserdata<Player>(L, player);
-			setMetatable(L, -1, "Player");
+			pushUserdata<Player>(L, player, LuaData_Player);
 			lua_rawseti(L, -2, ++index);
 		}
 	} else {
@@ -16575,6 +17093,10 @@ bool LuaEnvironment::closeState()
 		luaL_unref(luaState, LUA_REGISTRYINDEX, timerEventDesc.function);
 	}
 
+	while (!threads.empty()) {
+		releaseThread(threads.begin()->first);
+	}
+
 	combatIdMap.clear();
 	areaIdMap.clear();
 	timerEvents.clear();
@@ -16663,6 +17185,120 @@ void LuaEnvironment::clearAreaObjects(LuaScriptInterface* interface)
 	it->second.clear();
 }
 
+void LuaEnvironment::startThread(lua_State* L, int nargs)
+{
+	lua_State* thread = lua_newthread(L);
+	LuaThreadDesc& threadDesc = threads[thread];
+	threadDesc.ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+	//the first run shares the environment of the caller
+	lua_xmove(L, thread, nargs);
+	runThread(thread, nargs - 1);
+}
+
+uint32_t LuaEnvironment::suspendThread(lua_State* L)
+{
+	auto it = threads.find(L);
+	if (it == threads.end() || it->second.waitId != 0) {
+		return 0;
+	}
+
+	LuaThreadDesc& threadDesc = it->second;
+	threadDesc.waitId = ++lastWaitId;
+
+	ScriptEnvironment* env = getScriptEnv();
+	threadDesc.scriptId = env->getScriptId();
+	threadDesc.scriptInterface = env->getScriptInterface();
+	threadDesc.npc = env->getNpc();
+	if (threadDesc.npc) {
+		threadDesc.npc->incrementReferenceCounter();
+	}
+	return threadDesc.waitId;
+}
+
+void LuaEnvironment::resumeThread(lua_State* L, uint32_t waitId, const std::function<int(lua_State*)>& pushResults/* = nullptr*/)
+{
+	auto it = threads.find(L);
+	if (it == threads.end() || it->second.waitId != waitId) {
+		//the coroutine failed to yield or the state was closed in the meantime
+		return;
+	}
+
+	if (!reserveScriptEnv()) {
+		std::cout << "[Error - LuaEnvironment::resumeThread] Call stack overflow" << std::endl;
+		releaseThread(L);
+		return;
+	}
+
+	LuaThreadDesc& threadDesc = it->second;
+	threadDesc.waitId = 0;
+
+	ScriptEnvironment* env = getScriptEnv();
+	env->setTimerEvent();
+	env->setScriptId(threadDesc.scriptId, threadDesc.scriptInterface ? threadDesc.scriptInterface : this);
+	if (Npc* npc = threadDesc.npc) {
+		env->setNpc(npc->isRemoved() ? nullptr : npc);
+		threadDesc.npc = nullptr;
+		npc->decrementReferenceCounter();
+	}
+	releaseThreadObjects(L, threadDesc.objects);
+
+	runThread(L, pushResults ? pushResults(L) : 0);
+	resetScriptEnv();
+}
+
+void LuaEnvironment::clearThreadInterface(LuaScriptInterface* interface)
+{
+	for (auto& it : threads) {
+		if (it.second.scriptInterface == interface) {
+			it.second.scriptInterface = nullptr;
+		}
+	}
+}
+
+void LuaEnvironment::runThread(lua_State* L, int nargs)
+{
+	int ret;
+	LuaProfiler& profiler = g_luaProfiler();
+	if (profiler.isRunning()) {
+		ScriptEnvironment* env = getScriptEnv();
+		profiler.enterCall(env->getScriptInterface(), env->getScriptId());
+		ret = resumeCoroutine(L, nargs);
+		profiler.leaveCall();
+	} else {
+		ret = resumeCoroutine(L, nargs);
+	}
+
+	if (ret == LUA_YIELD) {
+		LuaThreadDesc& threadDesc = threads[L];
+		if (threadDesc.waitId != 0) {
+			pinThreadObjects(L, threadDesc.objects);
+			return;
+		}
+		reportError(nullptr, "Functions started by async can only be suspended by sleep or db.await functions.");
+	} else if (ret != 0) {
+		reportError(nullptr, popString(L));
+	}
+	releaseThread(L);
+}
+
+void LuaEnvironment::releaseThread(lua_State* L)
+{
+	auto it = threads.find(L);
+	if (it == threads.end()) {
+		return;
+	}
+
+	LuaThreadDesc threadDesc = std::move(it->second);
+	threads.erase(it);
+
+	if (threadDesc.npc) {
+		threadDesc.npc->decrementReferenceCounter();
+	}
+	releaseThreadObjects(L, threadDesc.objects);
+	luaL_unref(luaState, LUA_REGISTRYINDEX, threadDesc.ref);
+}
+
 void LuaEnvironment::executeTimerEvent(uint32_t eventIndex)
 {
 	auto it = timerEvents.find(eventIndex);
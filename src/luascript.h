@@ -85,6 +85,8 @@ enum LuaDataType {
 	LuaData_Monster,
 	LuaData_Npc,
 	LuaData_Tile,
+
+	LuaData_Last
 };
 
 struct LuaVariant {
@@ -105,6 +107,28 @@ struct LuaTimerEventDesc {
 };
 
 class LuaScriptInterface;
+
+//creatures and items a suspended coroutine can reach, kept alive until it is resumed
+struct LuaThreadObjects {
+	//the userdata holding the pointer and the object it pointed to when the coroutine was suspended
+	std::vector<std::pair<void*, Creature*>> creatures;
+	std::vector<std::pair<void*, Item*>> items;
+	//keeps that userdata alive, the tables holding it may be changed by other scripts in the meantime
+	int32_t anchorRef = -1;
+};
+
+struct LuaThreadDesc {
+	LuaThreadObjects objects;
+	int32_t ref = -1;
+	//set while the coroutine waits for the result of an await function
+	uint32_t waitId = 0;
+
+	//script environment of the await call, restored when the coroutine is resumed
+	int32_t scriptId = -1;
+	LuaScriptInterface* scriptInterface = nullptr;
+	Npc* npc = nullptr;
+};
+
 class Cylinder;
 class Game;
 
@@ -172,8 +196,8 @@ class ScriptEnvironment
 		//for npc scripts
 		Npc* curNpc = nullptr;
 
-		//temporary item list
-		static std::multimap<ScriptEnvironment*, Item*> tempItems;
+		//temporary item list, the items remember their slot so they are taken out in constant time
+		std::vector<Item*> tempItems;
 
 		//local item map
 		std::unordered_map<uint32_t, Item*> localMap;
@@ -270,6 +294,9 @@ class LuaScriptInterface
 		static std::string popString(lua_State* L);
 		static int32_t popCallback(lua_State* L);
 
+		//lua_dump of the function on top of the stack, debug information included
+		static bool dumpFunction(lua_State* L, std::string& bytecode);
+
 		// Userdata
 		template<class T>
 		static void pushUserdata(lua_State* L, T* value)
@@ -277,9 +304,20 @@ class LuaScriptInterface
 			T** userdata = static_cast<T**>(lua_newuserdata(L, sizeof(T*)));
 			*userdata = value;
 		}
+		template<class T>
+		static void pushUserdata(lua_State* L, T* value, LuaDataType type)
+		{
+			pushUserdata<T>(L, value);
+			setMetatable(L, -1, type);
+		}
 
 		// Metatables
 		static void setMetatable(lua_State* L, int32_t index, const std::string& name);
+		//metatables of the typed classes are fetched by registry reference instead of by name
+		static void setMetatable(lua_State* L, int32_t index, LuaDataType type) {
+			lua_rawgeti(L, LUA_REGISTRYINDEX, metatableRefs[type]);
+			lua_setmetatable(L, index - 1);
+		}
 		static void setWeakMetatable(lua_State* L, int32_t index, const std::string& name);
 
 		static void setItemMetatable(lua_State* L, int32_t index, const Item* item);
@@ -293,7 +331,19 @@ class LuaScriptInterface
 			return static_cast<T>(static_cast<int64_t>(lua_tonumber(L, arg)));
 		}
 		template<typename T>
-		static typename std::enable_if<std::is_integral<T>::value || std::is_floating_point<T>::value, T>::type
+		static typename std::enable_if<std::is_integral<T>::value, T>::type
+			getNumber(lua_State* L, int32_t arg)
+		{
+#if LUA_VERSION_NUM >= 503
+			//64 bit integers do not survive the round trip through a double
+			if (lua_isinteger(L, arg)) {
+				return static_cast<T>(lua_tointeger(L, arg));
+			}
+#endif
+			return static_cast<T>(lua_tonumber(L, arg));
+		}
+		template<typename T>
+		static typename std::enable_if<std::is_floating_point<T>::value, T>::type
 			getNumber(lua_State* L, int32_t arg)
 		{
 			return static_cast<T>(lua_tonumber(L, arg));
@@ -355,8 +405,28 @@ class LuaScriptInterface
 
 		static std::string getFieldString(lua_State* L, int32_t arg, const std::string& key);
 
+		/**
+		  * Looks up an enum the server registered as a global.
+		  * \returns false if the server did not register name
+		  */
+		static bool getRegisteredGlobal(const std::string& name, lua_Number& value);
+
 		static LuaDataType getUserdataType(lua_State* L, int32_t arg);
 
+		// Coroutines
+		static int resumeCoroutine(lua_State* L, int nargs);
+		/**
+		  * Takes a reference to the creatures and items a suspended coroutine can reach through its locals, varargs
+		  * and upvalues, including the tables and closures held there. The globals are not followed, nor are
+		  * varargs on plain Lua 5.1.
+		  */
+		static void pinThreadObjects(lua_State* L, LuaThreadObjects& objects);
+		/**
+		  * Drops the references again. The userdata of objects removed in the meantime is cleared, so the script
+		  * sees such an object as gone wherever it is kept, locals and upvalues holding it are set to nil.
+		  */
+		static void releaseThreadObjects(lua_State* L, LuaThreadObjects& objects);
+
 		// Is
 		static bool isNumber(lua_State* L, int32_t arg)
 		{
@@ -410,7 +480,7 @@ class LuaScriptInterface
 		static const luaL_Reg luaBitReg[7];
 #endif
 		static const luaL_Reg luaConfigManagerTable[4];
-		static const luaL_Reg luaDatabaseTable[9];
+		static const luaL_Reg luaDatabaseTable[11];
 		static const luaL_Reg luaResultTable[6];
 
 		static int protectedCall(lua_State* L, int nargs, int nresults);
@@ -432,6 +502,9 @@ class LuaScriptInterface
 		//script file cache
 		std::map<int32_t, std::string> cacheFiles;
 
+		std::string lastLuaError;
+		std::string loadingFile;
+
 	private:
 		void registerClass(const std::string& className, const std::string& baseClass, lua_CFunction newFunction = nullptr);
 		void registerTable(const std::string& tableName);
@@ -487,6 +560,10 @@ class LuaScriptInterface
 		static int luaDebugPrint(lua_State* L);
 		static int luaAddEvent(lua_State* L);
 		static int luaStopEvent(lua_State* L);
+		static int luaAsync(lua_State* L);
+		static int luaSleep(lua_State* L);
+		static int luaPure(lua_State* L);
+		static int luaPureCall(lua_State* L);
 
 		static int luaSaveServer(lua_State* L);
 		static int luaCleanMap(lua_State* L);
@@ -515,6 +592,8 @@ class LuaScriptInterface
 		static int luaDatabaseAsyncExecute(lua_State* L);
 		static int luaDatabaseStoreQuery(lua_State* L);
 		static int luaDatabaseAsyncStoreQuery(lua_State* L);
+		static int luaDatabaseAwaitQuery(lua_State* L);
+		static int luaDatabaseAwaitStoreQuery(lua_State* L);
 		static int luaDatabaseEscapeString(lua_State* L);
 		static int luaDatabaseEscapeBlob(lua_State* L);
 		static int luaDatabaseLastInsertId(lua_State* L);
@@ -578,6 +657,10 @@ class LuaScriptInterface
 
 		static int luaGameReload(lua_State* L);
 
+		static int luaGameGetAllocatorStats(lua_State* L);
+		static int luaGameStartLuaProfiler(lua_State* L);
+		static int luaGameStopLuaProfiler(lua_State* L);
+
 		// Variant
 		static int luaVariantCreate(lua_State* L);
 
@@ -783,6 +866,7 @@ class LuaScriptInterface
 		static int luaCreatureGetParent(lua_State* L);
 
 		static int luaCreatureGetId(lua_State* L);
+		static int luaCreatureGetHandle(lua_State* L);
 		static int luaCreatureGetName(lua_State* L);
 
 		static int luaCreatureGetTarget(lua_State* L);
@@ -1491,15 +1575,17 @@ class LuaScriptInterface
 		// exclusively for wands & distance weapons
 		static int luaWeaponShootType(lua_State* L);
 
-		//
-		std::string lastLuaError;
-
 		std::string interfaceName;
 
 		static ScriptEnvironment scriptEnv[16];
 		static int32_t scriptEnvIndex;
 
-		std::string loadingFile;
+		friend class ScriptEnvironment;
+
+		//registry references to the metatables of the typed classes, taken when the classes are registered
+		static std::array<int32_t, LuaData_Last> metatableRefs;
+		//the enums registered by registerGlobalVariable, with their values
+		static std::unordered_map<std::string, lua_Number> registeredGlobals;
 };
 
 class LuaEnvironment : public LuaScriptInterface
@@ -1532,10 +1618,28 @@ class LuaEnvironment : public LuaScriptInterface
 		uint32_t createAreaObject(LuaScriptInterface* interface);
 		void clearAreaObjects(LuaScriptInterface* interface);
 
+		/**
+		  * Runs the function below the nargs arguments on top of L in a new coroutine, until it returns
+		  * or waits in an await function (sleep, db.awaitQuery, db.awaitStoreQuery).
+		  */
+		void startThread(lua_State* L, int nargs);
+		/**
+		  * Called by an await function right before it yields, the returned id has to be passed to resumeThread.
+		  * \returns 0 if L is not a coroutine started by startThread
+		  */
+		uint32_t suspendThread(lua_State* L);
+		//pushResults pushes the values the await function returns to the coroutine and returns their count
+		void resumeThread(lua_State* L, uint32_t waitId, const std::function<int(lua_State*)>& pushResults = nullptr);
+		//suspended coroutines of a closing interface are resumed in the main interface
+		void clearThreadInterface(LuaScriptInterface* interface);
+
 	private:
 		void executeTimerEvent(uint32_t eventIndex);
+		void runThread(lua_State* L, int nargs);
+		void releaseThread(lua_State* L);
 
 		std::unordered_map<uint32_t, LuaTimerEventDesc> timerEvents;
+		std::unordered_map<lua_State*, LuaThreadDesc> threads;
 		std::unordered_map<uint32_t, Combat*> combatMap;
 		std::unordered_map<uint32_t, AreaCombat*> areaMap;
 
@@ -1547,6 +1651,7 @@ class LuaEnvironment : public LuaScriptInterface
 		uint32_t lastEventTimerId = 1;
 		uint32_t lastCombatId = 0;
 		uint32_t lastAreaId = 0;
+		uint32_t lastWaitId = 0;
 
 		friend class LuaScriptInterface;
 		friend class CombatSpell;
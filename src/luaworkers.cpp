@@ -0,0 +1,361 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "luaworkers.h"
+#include "luascript.h"
+#include "tasks.h"
+
+namespace {
+
+void instructionLimitHook(lua_State* L, lua_Debug*)
+{
+	//compiled LuaJIT traces do not run hooks, a loop that got compiled is not stopped by this
+	luaL_error(L, "pure function exceeded %d instructions", PURE_INSTRUCTION_LIMIT);
+}
+
+bool getValue(lua_State* L, int index, PureValue& value, int depth, std::string& error)
+{
+	int type = lua_type(L, index);
+	switch (type) {
+		case LUA_TNIL:
+			value.type = PureValue::NIL;
+			return true;
+
+		case LUA_TBOOLEAN:
+			value.type = PureValue::BOOLEAN;
+			value.boolean = lua_toboolean(L, index) != 0;
+			return true;
+
+		case LUA_TNUMBER:
+#if LUA_VERSION_NUM >= 503
+			if (lua_isinteger(L, index)) {
+				value.type = PureValue::INTEGER;
+				value.integer = lua_tointeger(L, index);
+				return true;
+			}
+#endif
+			value.type = PureValue::NUMBER;
+			value.number = lua_tonumber(L, index);
+			return true;
+
+		case LUA_TSTRING: {
+			size_t length;
+			const char* string = lua_tolstring(L, index, &length);
+			value.type = PureValue::STRING;
+			value.string.assign(string, length);
+			return true;
+		}
+
+		case LUA_TTABLE: {
+			//metatables are not copied, a table that contains itself runs into the depth limit
+			if (depth >= PURE_VALUE_MAX_DEPTH || !lua_checkstack(L, 3)) {
+				error = "tables passed to or from a pure function are nested too deep.";
+				return false;
+			}
+
+			value.type = PureValue::TABLE;
+			lua_pushnil(L);
+			while (lua_next(L, index) != 0) {
+				value.keys.emplace_back();
+				value.values.emplace_back();
+				int top = lua_gettop(L);
+				if (!getValue(L, top - 1, value.keys.back(), depth + 1, error) || !getValue(L, top, value.values.back(), depth + 1, error)) {
+					lua_pop(L, 2);
+					return false;
+				}
+				lua_pop(L, 1);
+			}
+			return true;
+		}
+
+		default:
+			error = std::string("values of type ") + lua_typename(L, type) + " cannot be passed to or from a pure function.";
+			return false;
+	}
+}
+
+void pushValue(lua_State* L, const PureValue& value)
+{
+	switch (value.type) {
+		case PureValue::BOOLEAN:
+			lua_pushboolean(L, value.boolean);
+			break;
+
+		case PureValue::NUMBER:
+			lua_pushnumber(L, value.number);
+			break;
+
+		case PureValue::INTEGER:
+#if LUA_VERSION_NUM >= 503
+			lua_pushinteger(L, value.integer);
+#else
+			lua_pushnumber(L, value.integer);
+#endif
+			break;
+
+		case PureValue::STRING:
+			lua_pushlstring(L, value.string.data(), value.string.size());
+			break;
+
+		case PureValue::TABLE:
+			lua_checkstack(L, 3);
+			lua_createtable(L, 0, value.keys.size());
+			for (size_t i = 0, size = value.keys.size(); i < size; ++i) {
+				pushValue(L, value.keys[i]);
+				pushValue(L, value.values[i]);
+				lua_rawset(L, -3);
+			}
+			break;
+
+		default:
+			lua_pushnil(L);
+			break;
+	}
+}
+
+}
+
+LuaWorkers::~LuaWorkers()
+{
+	shutdown();
+	join();
+
+	if (dispatcherState.L) {
+		lua_close(dispatcherState.L);
+	}
+}
+
+void LuaWorkers::start(size_t count)
+{
+	std::lock_guard<std::mutex> lockGuard(taskLock);
+	running = true;
+	for (size_t i = threads.size(); i < count; ++i) {
+		threads.emplace_back(&LuaWorkers::threadMain, this);
+	}
+}
+
+void LuaWorkers::shutdown()
+{
+	taskLock.lock();
+	running = false;
+	taskLock.unlock();
+	taskSignal.notify_all();
+}
+
+void LuaWorkers::join()
+{
+	for (std::thread& thread : threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+	threads.clear();
+}
+
+uint32_t LuaWorkers::addFunction(lua_State* L, int index, std::string& error)
+{
+	if (lua_iscfunction(L, index)) {
+		error = "only Lua functions can be pure.";
+		return 0;
+	}
+
+	//globals resolve to the worker state, other upvalues would not survive the copy
+	for (int n = 1; const char* name = lua_getupvalue(L, index, n); ++n) {
+		lua_pop(L, 1);
+#if LUA_VERSION_NUM >= 502
+		if (strcmp(name, "_ENV") == 0) {
+			continue;
+		}
+#endif
+		error = std::string("pure functions cannot use local variable ") + name + " of an enclosing function.";
+		return 0;
+	}
+
+	std::string bytecode;
+	lua_pushvalue(L, index);
+	bool dumped = LuaScriptInterface::dumpFunction(L, bytecode);
+	lua_pop(L, 1);
+	if (!dumped) {
+		error = "unable to dump the function.";
+		return 0;
+	}
+
+	auto it = functionIds.find(bytecode);
+	if (it != functionIds.end()) {
+		return it->second;
+	}
+
+	functions.push_back(std::make_shared<const std::string>(bytecode));
+	uint32_t functionId = functions.size();
+	functionIds.emplace(std::move(bytecode), functionId);
+	return functionId;
+}
+
+bool LuaWorkers::call(uint32_t functionId, const PureValues& args, PureValues& results, std::string& error)
+{
+	if (functionId == 0 || functionId > functions.size()) {
+		error = "unknown pure function.";
+		return false;
+	}
+
+	if (!dispatcherState.L) {
+		dispatcherState.L = newState();
+	}
+	return run(dispatcherState, functionId, *functions[functionId - 1], args, results, error);
+}
+
+void LuaWorkers::addTask(uint32_t functionId, PureValues args, PureCallback callback)
+{
+	bool queued = false;
+	if (functionId != 0 && functionId <= functions.size()) {
+		std::lock_guard<std::mutex> lockGuard(taskLock);
+		if (running) {
+			tasks.push_back({functions[functionId - 1], functionId, std::move(args), std::move(callback)});
+			queued = true;
+		}
+	}
+
+	if (queued) {
+		taskSignal.notify_one();
+		return;
+	}
+
+	//without workers the function runs right away, the callback still comes from the dispatcher
+	PureValues results;
+	std::string error;
+	bool success = call(functionId, args, results, error);
+	g_dispatcher().addTask([callback, success, results, error]() {
+		callback(success, results, error);
+	});
+}
+
+bool LuaWorkers::getValues(lua_State* L, int first, int last, PureValues& values, std::string& error)
+{
+	if (last < first) {
+		return true;
+	}
+
+	values.resize(last - first + 1);
+	for (int index = first; index <= last; ++index) {
+		if (!getValue(L, index, values[index - first], 0, error)) {
+			values.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+void LuaWorkers::pushValues(lua_State* L, const PureValues& values)
+{
+	lua_checkstack(L, values.size());
+	for (const PureValue& value : values) {
+		pushValue(L, value);
+	}
+}
+
+lua_State* LuaWorkers::newState()
+{
+	lua_State* L = luaL_newstate();
+	luaL_openlibs(L);
+
+	//nothing that reaches outside of the state
+	for (const char* name : {"io", "debug", "package", "require", "dofile", "loadfile", "load", "loadstring"}) {
+		lua_pushnil(L);
+		lua_setglobal(L, name);
+	}
+
+	lua_getglobal(L, "os");
+	lua_newtable(L);
+	for (const char* name : {"clock", "difftime", "time"}) {
+		lua_getfield(L, -2, name);
+		lua_setfield(L, -2, name);
+	}
+	lua_setglobal(L, "os");
+	lua_pop(L, 1);
+
+	//every state would otherwise roll the same numbers
+	lua_getglobal(L, "math");
+	lua_getfield(L, -1, "randomseed");
+	lua_pushnumber(L, std::random_device{}());
+	lua_pcall(L, 1, 0, 0);
+	lua_pop(L, 1);
+	return L;
+}
+
+bool LuaWorkers::run(WorkerState& state, uint32_t functionId, const std::string& bytecode, const PureValues& args, PureValues& results, std::string& error)
+{
+	lua_State* L = state.L;
+	auto it = state.functions.find(functionId);
+	if (it == state.functions.end()) {
+		if (luaL_loadbuffer(L, bytecode.data(), bytecode.size(), "=pure") != 0) {
+			error = LuaScriptInterface::popString(L);
+			return false;
+		}
+		it = state.functions.emplace(functionId, luaL_ref(L, LUA_REGISTRYINDEX)).first;
+	}
+
+	int top = lua_gettop(L);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, it->second);
+	pushValues(L, args);
+
+	lua_sethook(L, instructionLimitHook, LUA_MASKCOUNT, PURE_INSTRUCTION_LIMIT);
+	bool success = lua_pcall(L, args.size(), LUA_MULTRET, 0) == 0;
+	lua_sethook(L, nullptr, 0, 0);
+
+	if (success) {
+		success = getValues(L, top + 1, lua_gettop(L), results, error);
+	} else {
+		error = LuaScriptInterface::popString(L);
+	}
+	lua_settop(L, top);
+	return success;
+}
+
+void LuaWorkers::threadMain()
+{
+	WorkerState state;
+	state.L = newState();
+
+	std::unique_lock<std::mutex> taskLockUnique(taskLock);
+	while (true) {
+		taskSignal.wait(taskLockUnique, [this]() { return !running || !tasks.empty(); });
+		//the queue is drained before the workers stop
+		if (tasks.empty()) {
+			break;
+		}
+
+		Task task = std::move(tasks.front());
+		tasks.pop_front();
+		taskLockUnique.unlock();
+
+		PureValues results;
+		std::string error;
+		bool success = run(state, task.functionId, *task.bytecode, task.args, results, error);
+		g_dispatcher().addTask([callback = std::move(task.callback), success, results = std::move(results), error = std::move(error)]() {
+			callback(success, results, error);
+		});
+
+		taskLockUnique.lock();
+	}
+	taskLockUnique.unlock();
+
+	lua_close(state.L);
+}
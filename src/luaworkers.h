@@ -0,0 +1,128 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_LUAWORKERS_H_3F8B1C6E2D9A4B7E8C5D0A1F6E2B9C4D
+#define FS_LUAWORKERS_H_3F8B1C6E2D9A4B7E8C5D0A1F6E2B9C4D
+
+#include <condition_variable>
+
+struct lua_State;
+
+//deepest table nesting a value may have to be passed to or returned from a pure function
+static constexpr int PURE_VALUE_MAX_DEPTH = 16;
+//instructions a pure function may run before it is aborted
+static constexpr int PURE_INSTRUCTION_LIMIT = 10000000;
+
+//plain Lua value copied out of one state so it can be pushed into another
+struct PureValue {
+	enum Type : uint8_t {
+		NIL,
+		BOOLEAN,
+		NUMBER,
+		INTEGER,
+		STRING,
+		TABLE,
+	};
+
+	Type type = NIL;
+	bool boolean = false;
+	double number = 0;
+	int64_t integer = 0;
+	std::string string;
+	std::vector<PureValue> keys;
+	std::vector<PureValue> values;
+};
+
+using PureValues = std::vector<PureValue>;
+using PureCallback = std::function<void(bool, PureValues, const std::string&)>;
+
+/**
+  * Runs script functions that only compute a result from their arguments (loot rolls, formulas)
+  * on worker threads. Each worker owns a Lua state with nothing but the base, string, table and
+  * math libraries: the game bindings are not there, so a pure function cannot touch the game
+  * world no matter what it calls. Functions are moved between states as bytecode, their
+  * arguments and results as PureValue copies, callbacks are run on the dispatcher.
+  */
+class LuaWorkers
+{
+	public:
+		LuaWorkers() = default;
+		~LuaWorkers();
+
+		// Singleton - ensures we don't accidentally copy it
+		LuaWorkers(LuaWorkers const&) = delete;
+		void operator=(LuaWorkers const&) = delete;
+
+		static LuaWorkers& getInstance() {
+			static LuaWorkers instance;
+			return instance;
+		}
+
+		void start(size_t count);
+		void shutdown();
+		void join();
+
+		/**
+		  * Registers the Lua function at index, it may not capture any local variable.
+		  * \returns the id to call the function by, 0 with error set if it cannot run on a worker
+		  */
+		uint32_t addFunction(lua_State* L, int index, std::string& error);
+
+		//runs a function on the calling thread, for the dispatcher when it cannot wait
+		bool call(uint32_t functionId, const PureValues& args, PureValues& results, std::string& error);
+		//queues a function for the workers, the callback gets the results on the dispatcher
+		void addTask(uint32_t functionId, PureValues args, PureCallback callback);
+
+		static bool getValues(lua_State* L, int first, int last, PureValues& values, std::string& error);
+		static void pushValues(lua_State* L, const PureValues& values);
+
+	private:
+		struct Task {
+			std::shared_ptr<const std::string> bytecode;
+			uint32_t functionId;
+			PureValues args;
+			PureCallback callback;
+		};
+
+		struct WorkerState {
+			lua_State* L = nullptr;
+			//registry references of the functions loaded into L
+			std::unordered_map<uint32_t, int> functions;
+		};
+
+		static lua_State* newState();
+		static bool run(WorkerState& state, uint32_t functionId, const std::string& bytecode, const PureValues& args, PureValues& results, std::string& error);
+
+		void threadMain();
+
+		std::vector<std::thread> threads;
+		std::list<Task> tasks;
+		std::mutex taskLock;
+		std::condition_variable taskSignal;
+		bool running = false;
+
+		//the bytecode of every registered function by id - 1, reloaded scripts get their old ids back
+		std::vector<std::shared_ptr<const std::string>> functions;
+		std::unordered_map<std::string, uint32_t> functionIds;
+		WorkerState dispatcherState;
+};
+
+constexpr auto g_luaWorkers = &LuaWorkers::getInstance;
+
+#endif
@@ -21,6 +21,7 @@
 
 #include "iomap.h"
 #include "iomapserialize.h"
+#include "iomapsnapshot.h"
 #include "combat.h"
 #include "creature.h"
 #include "monster.h"
@@ -28,12 +29,32 @@
 
 bool Map::loadMap(const std::string& identifier, bool loadHouses)
 {
-	IOMap loader;
-	if (!loader.loadMap(this, identifier)) {
-		std::cout << "[Fatal - Map::loadMap] " << loader.getLastErrorString() << std::endl;
+	//only the main map is loaded lazily
+	bool lazy = loadHouses && g_config().getBoolean(ConfigManager::LAZY_MAP_LOADING);
+
+	//the snapshot only covers the main map, maps loaded on top of it are always read from the OTBM
+	bool useSnapshot = loadHouses && isSnapshotEnabled();
+	MapSnapshotResult_t snapshotResult = useSnapshot ? IOMapSnapshot::load(*this, identifier) : MAP_SNAPSHOT_UNAVAILABLE;
+	if (snapshotResult == MAP_SNAPSHOT_FAILED) {
+		std::cout << "[Fatal - Map::loadMap] Failed to load the map snapshot, delete " << identifier << ".snapshot and try again." << std::endl;
 		return false;
 	}
 
+	if (snapshotResult != MAP_SNAPSHOT_LOADED) {
+		IOMap loader;
+		if (!loader.loadMap(this, identifier, lazy)) {
+			std::cout << "[Fatal - Map::loadMap] " << loader.getLastErrorString() << std::endl;
+			return false;
+		}
+
+		if (useSnapshot && !IOMapSnapshot::save(*this, identifier)) {
+			std::cout << "[Warning - Map::loadMap] Failed to save the map snapshot." << std::endl;
+		}
+	}
+
+	spdlog::info("{} map grounds share {} item instances, about {} MB less resident memory.",
+		Item::getSharedItemUses(), Item::getSharedItemCount(), (Item::getSharedItemUses() - Item::getSharedItemCount()) * sizeof(Item) / (1024. * 1024.));
+
 	if (!IOMap::loadSpawns(this)) {
 		std::cout << "[Warning - Map::loadMap] Failed to load spawn data." << std::endl;
 	}
@@ -45,10 +66,24 @@ bool Map::loadMap(const std::string& identifier, bool loadHouses)
 
 		IOMapSerialize::loadHouseInfo();
 		IOMapSerialize::loadHouseItems(this);
+
+		//maps loaded later on only mark the clusters they touch, those are rebuilt on demand
+		//a lazy map builds every cluster on demand, building them now would load all sectors
+		if (lazy) {
+			pathClusters.buildOnDemand();
+		} else {
+			pathClusters.build(*this);
+		}
 	}
 	return true;
 }
 
+bool Map::isSnapshotEnabled()
+{
+	//the snapshot needs every tile built, so it does not mix with lazy loading
+	return g_config().getBoolean(ConfigManager::MAP_SNAPSHOT) && !g_config().getBoolean(ConfigManager::LAZY_MAP_LOADING);
+}
+
 bool Map::save()
 {
 	bool saved = false;
@@ -73,6 +108,8 @@ bool Map::save()
 	return saved;
 }
 
+Map::~Map() = default;
+
 MapSector* Map::createMapSector(uint32_t x, uint32_t y)
 {
 	uint32_t index = (x / SECTOR_SIZE) | ((y / SECTOR_SIZE) << 16);
@@ -81,11 +118,20 @@ MapSector* Map::createMapSector(uint32_t x, uint32_t y)
 		return &it->second;
 	}
 
+	//a pending sector gets its own tiles before anything else is put on it
+	if (loadPendingSector(index)) {
+		MapSector::newSector = false;
+		it = mapSectors.find(index);
+		if (it != mapSectors.end()) {
+			return &it->second;
+		}
+	}
+
 	MapSector::newSector = true;
 	return &mapSectors[index];
 }
 
-MapSector* Map::getMapSector(uint32_t x, uint32_t y)
+MapSector* Map::findMapSector(uint32_t x, uint32_t y)
 {
 	auto it = mapSectors.find((x / SECTOR_SIZE) | ((y / SECTOR_SIZE) << 16));
 	if (it != mapSectors.end()) {
@@ -94,7 +140,7 @@ MapSector* Map::getMapSector(uint32_t x, uint32_t y)
 	return nullptr;
 }
 
-const MapSector* Map::getMapSector(uint32_t x, uint32_t y) const
+const MapSector* Map::findMapSector(uint32_t x, uint32_t y) const
 {
 	auto it = mapSectors.find((x / SECTOR_SIZE) | ((y / SECTOR_SIZE) << 16));
 	if (it != mapSectors.end()) {
@@ -103,7 +149,43 @@ const MapSector* Map::getMapSector(uint32_t x, uint32_t y) const
 	return nullptr;
 }
 
-Tile* Map::getTile(uint16_t x, uint16_t y, uint8_t z) const
+MapSector* Map::getMapSector(uint32_t x, uint32_t y)
+{
+	MapSector* sector = findMapSector(x, y);
+	if (!sector && !pendingSectors.empty() && loadPendingSector((x / SECTOR_SIZE) | ((y / SECTOR_SIZE) << 16))) {
+		sector = findMapSector(x, y);
+	}
+	return sector;
+}
+
+const MapSector* Map::getMapSector(uint32_t x, uint32_t y) const
+{
+	return findMapSector(x, y);
+}
+
+bool Map::loadPendingSector(uint32_t index)
+{
+	auto it = pendingSectors.find(index);
+	if (it == pendingSectors.end()) {
+		return false;
+	}
+
+	//taken out first, building the tiles looks the sector up again
+	std::unique_ptr<StagedTileArea> sector = std::move(it->second);
+	pendingSectors.erase(it);
+	IOMap::loadPendingSector(*this, *sector, pendingSectorsLegacy);
+	return true;
+}
+
+size_t Map::loadPendingSectors(size_t count)
+{
+	while (count-- > 0 && !pendingSectors.empty()) {
+		loadPendingSector(pendingSectors.begin()->first);
+	}
+	return pendingSectors.size();
+}
+
+Tile* Map::getTile(uint16_t x, uint16_t y, uint8_t z)
 {
 	if (z >= MAP_MAX_LAYERS) {
 		return nullptr;
@@ -117,6 +199,20 @@ Tile* Map::getTile(uint16_t x, uint16_t y, uint8_t z) const
 	return sector->tiles[z][x & SECTOR_MASK][y & SECTOR_MASK];
 }
 
+Tile* Map::getTile(uint16_t x, uint16_t y, uint8_t z) const
+{
+	if (z >= MAP_MAX_LAYERS) {
+		return nullptr;
+	}
+
+	const MapSector* sector = findMapSector(x, y);
+	if (!sector) {
+		return nullptr;
+	}
+
+	return sector->tiles[z][x & SECTOR_MASK][y & SECTOR_MASK];
+}
+
 void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 {
 	if (z >= MAP_MAX_LAYERS) {
@@ -128,26 +224,26 @@ void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 	MapSector* sector = createMapSector(x, y);
 
 	if (MapSector::newSector) {
-		//update north sector
-		MapSector* northSector = getMapSector(x, y - SECTOR_SIZE);
+		//update north sector, pending neighbours link themselves once they are built
+		MapSector* northSector = findMapSector(x, y - SECTOR_SIZE);
 		if (northSector) {
 			northSector->sectorS = sector;
 		}
 
 		//update west sector
-		MapSector* westSector = getMapSector(x - SECTOR_SIZE, y);
+		MapSector* westSector = findMapSector(x - SECTOR_SIZE, y);
 		if (westSector) {
 			westSector->sectorE = sector;
 		}
 
 		//update south sector
-		MapSector* southSector = getMapSector(x, y + SECTOR_SIZE);
+		MapSector* southSector = findMapSector(x, y + SECTOR_SIZE);
 		if (southSector) {
 			sector->sectorS = southSector;
 		}
 
 		//update east sector
-		MapSector* eastSector = getMapSector(x + SECTOR_SIZE, y);
+		MapSector* eastSector = findMapSector(x + SECTOR_SIZE, y);
 		if (eastSector) {
 			sector->sectorE = eastSector;
 		}
@@ -164,7 +260,7 @@ void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 			items->clear();
 		}
 
-		Item* ground = newTile->getGround();
+		Item* ground = newTile->unshareGround();
 		if (ground) {
 			tile->addThing(ground);
 			newTile->setGround(nullptr);
@@ -173,6 +269,8 @@ void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 	} else {
 		tile = newTile;
 	}
+
+	pathClusters.invalidate(Position(x, y, z));
 }
 
 bool Map::placeCreature(const Position& centerPos, Creature* creature, bool extendedPos/* = false*/, bool forceLogin/* = false*/)
@@ -553,7 +651,7 @@ void Map::clearSpectatorCache(bool clearPlayer)
 }
 
 bool Map::canThrowObjectTo(const Position& fromPos, const Position& toPos, bool checkLineOfSight /*= true*/,
-                           int32_t rangex /*= Map::maxClientViewportX*/, int32_t rangey /*= Map::maxClientViewportY*/) const
+                           int32_t rangex /*= Map::maxClientViewportX*/, int32_t rangey /*= Map::maxClientViewportY*/)
 {
 	//z checks
 	//underground 8->15
@@ -582,7 +680,7 @@ bool Map::canThrowObjectTo(const Position& fromPos, const Position& toPos, bool
 	return isSightClear(fromPos, toPos, false);
 }
 
-bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
+bool Map::checkSightLine(const Position& fromPos, const Position& toPos)
 {
 	if (fromPos == toPos) {
 		return true;
@@ -749,7 +847,7 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 	return true;
 }
 
-bool Map::isSightClear(const Position& fromPos, const Position& toPos, bool floorCheck) const
+bool Map::isSightClear(const Position& fromPos, const Position& toPos, bool floorCheck)
 {
 	if (floorCheck && fromPos.z != toPos.z) {
 		return false;
@@ -770,7 +868,7 @@ bool Map::isSightClear(const Position& fromPos, const Position& toPos, bool floo
 	return checkSightLine(fromPos, toPos) || checkSightLine(toPos, fromPos);
 }
 
-const Tile* Map::canWalkTo(const Creature& creature, const Position& pos) const
+const Tile* Map::canWalkTo(const Creature& creature, const Position& pos)
 {
 	int32_t walkCache = creature.getWalkCache(pos);
 	if (walkCache == 0) {
@@ -787,9 +885,100 @@ const Tile* Map::canWalkTo(const Creature& creature, const Position& pos) const
 	return tile;
 }
 
-bool Map::getPathMatching(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
+int32_t Map::getWalkCache(const Creature& creature, uint8_t walkProfile, const Position& pos)
 {
-	Position pos = creature.getPosition();
+	MapSector* sector = getMapSector(pos.x, pos.y);
+	if (!sector) {
+		return 0;
+	}
+
+	SectorWalkCache* cache = nullptr;
+	for (SectorWalkCache& it : sector->walkCaches) {
+		if (it.z == pos.z && it.profile == walkProfile) {
+			cache = &it;
+			break;
+		}
+	}
+
+	if (!cache) {
+		sector->walkCaches.emplace_back();
+		cache = &sector->walkCaches.back();
+		cache->z = pos.z;
+		cache->profile = walkProfile;
+	}
+
+	const size_t index = (pos.x & SECTOR_MASK) + (pos.y & SECTOR_MASK) * SECTOR_SIZE;
+	if (!cache->known.test(index)) {
+		const Tile* tile = sector->tiles[pos.z][pos.x & SECTOR_MASK][pos.y & SECTOR_MASK];
+		cache->walkable.set(index, tile && tile->queryAdd(0, creature, 1, FLAG_PATHFINDING | FLAG_IGNOREFIELDDAMAGE) == RETURNVALUE_NOERROR);
+		cache->known.set(index);
+	}
+	return cache->walkable.test(index) ? 1 : 0;
+}
+
+void Map::clearWalkCache(const Position& pos)
+{
+	MapSector* sector = getMapSector(pos.x, pos.y);
+	if (!sector) {
+		return;
+	}
+
+	const size_t index = (pos.x & SECTOR_MASK) + (pos.y & SECTOR_MASK) * SECTOR_SIZE;
+	for (SectorWalkCache& cache : sector->walkCaches) {
+		if (cache.z == pos.z) {
+			cache.known.reset(index);
+		}
+	}
+}
+
+bool Map::getPathMatching(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp)
+{
+	const Position& startPos = creature.getPosition();
+	if (fpp.fullPathSearch && startPos.z == targetPos.z &&
+			std::max<int32_t>(Position::getDistanceX(startPos, targetPos), Position::getDistanceY(startPos, targetPos)) > MAP_CLUSTERED_PATH_DISTANCE) {
+		if (getPathClustered(creature, targetPos, dirList, pathCondition, fpp)) {
+			return true;
+		}
+	}
+	return getPathMatchingFrom(creature, startPos, targetPos, dirList, pathCondition, fpp, MAP_MAX_CLOSED_NODES);
+}
+
+bool Map::getPathClustered(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp)
+{
+	const Position& startPos = creature.getPosition();
+
+	std::vector<Position> route;
+	if (!pathClusters.findRoute(*this, startPos, targetPos, route)) {
+		return false;
+	}
+
+	//the legs keep the search options of the caller, only the target is the exact waypoint
+	FindPathParams legParams = fpp;
+	legParams.minTargetDist = 0;
+	legParams.maxTargetDist = 0;
+
+	//dirList is walked from the back, so the legs are added from the last one
+	const size_t listSize = dirList.size();
+	for (size_t i = route.size(); i-- > 0;) {
+		const Position& legStart = (i == 0 ? startPos : route[i - 1]);
+		bool found;
+		if (i == route.size() - 1) {
+			found = getPathMatchingFrom(creature, legStart, targetPos, dirList, pathCondition, fpp, SECTOR_SIZE * SECTOR_SIZE);
+		} else {
+			found = getPathMatchingFrom(creature, legStart, route[i], dirList, FrozenPathingConditionCall(route[i]), legParams, SECTOR_SIZE * SECTOR_SIZE);
+		}
+
+		if (!found) {
+			dirList.resize(listSize);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Map::getPathMatchingFrom(const Creature& creature, const Position& startPos, const Position& targetPos, std::vector<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp, int32_t maxClosedNodes)
+{
+	Position pos = startPos;
 	Position endPos;
 
 	AStarNodes nodes(pos.x, pos.y, AStarNodes::getTileWalkCost(creature, getTile(pos.x, pos.y, pos.z)));
@@ -810,8 +999,6 @@ bool Map::getPathMatching(const Creature& creature, const Position& targetPos, s
 		{-1, 0}, {0, 1}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}, {-1, 1}
 	};
 
-	const Position startPos = pos;
-
 	const int_fast32_t sX = std::abs(targetPos.getX() - pos.getX());
 	const int_fast32_t sY = std::abs(targetPos.getY() - pos.getY());
 
@@ -912,7 +1099,7 @@ bool Map::getPathMatching(const Creature& creature, const Position& targetPos, s
 			}
 		}
 		nodes.closeNode(n);
-	} while (nodes.getClosedNodes() < 100);
+	} while (nodes.getClosedNodes() < maxClosedNodes);
 	if (!found) {
 		return false;
 	}
@@ -956,7 +1143,7 @@ bool Map::getPathMatching(const Creature& creature, const Position& targetPos, s
 	return true;
 }
 
-bool Map::getPathMatchingCond(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const
+bool Map::getPathMatchingCond(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp)
 {
 	Position pos = creature.getPosition();
 	Position endPos;
@@ -1175,8 +1362,31 @@ AStarNodes::AStarNodes(uint32_t x, uint32_t y, int_fast32_t extraCost): openNode
 
 bool AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f, int_fast32_t heuristic, int_fast32_t extraCost)
 {
-	if (curNode >= MAX_NODES) {
-		return false;
+	if (useHeap) {
+		if (curNode >= MAX_NODES_EXTENDED) {
+			return false;
+		}
+
+		int32_t retNode = curNode++;
+		if (retNode >= MAX_NODES) {
+			if ((retNode % MAX_NODES) == 0) {
+				extraNodes.emplace_back(new AStarNode[MAX_NODES]);
+			}
+			extraOpenNodes.push_back(true);
+		} else {
+			openNodes[retNode] = true;
+		}
+
+		AStarNode& node = *getNode(retNode);
+		node.parent = parent;
+		node.x = x;
+		node.y = y;
+		node.f = f;
+		node.g = heuristic;
+		node.c = extraCost;
+		insertHash((x << 16) | y, retNode);
+		pushHeap(retNode);
+		return true;
 	}
 
 	int32_t retNode = curNode++;
@@ -1193,11 +1403,30 @@ bool AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_f
 	#if defined(__SSE2__)
 	calculatedNodes[retNode] = f + heuristic;
 	#endif
+
+	if (curNode >= ASTAR_HEAP_THRESHOLD) {
+		switchToHeap();
+	}
 	return true;
 }
 
 AStarNode* AStarNodes::getBestNode()
 {
+	if (useHeap) {
+		//entries of closed or re-opened nodes are left behind and skipped here
+		while (!openHeap.empty()) {
+			const HeapEntry& top = openHeap.front();
+			AStarNode* node = getNode(top.index);
+			if (isOpen(top.index) && node->f + node->g == top.cost) {
+				return node;
+			}
+
+			std::pop_heap(openHeap.begin(), openHeap.end(), std::greater<HeapEntry>());
+			openHeap.pop_back();
+		}
+		return nullptr;
+	}
+
 	//Branchless best node search
 	#if defined(__AVX512F__)
 	const __m512i increment = _mm512_set1_epi32(16);
@@ -1313,6 +1542,14 @@ AStarNode* AStarNodes::getBestNode()
 
 void AStarNodes::closeNode(AStarNode* node)
 {
+	if (useHeap) {
+		int32_t index = getNodeIndex(node);
+		assert(index != -1);
+		setOpen(index, false);
+		++closedNodes;
+		return;
+	}
+
 	size_t index = node - nodes;
 	assert(index < MAX_NODES);
 	#if defined(__SSE2__)
@@ -1324,6 +1561,15 @@ void AStarNodes::closeNode(AStarNode* node)
 
 void AStarNodes::openNode(AStarNode* node)
 {
+	if (useHeap) {
+		int32_t index = getNodeIndex(node);
+		assert(index != -1);
+		closedNodes -= (isOpen(index) ? 0 : 1);
+		setOpen(index, true);
+		pushHeap(index);
+		return;
+	}
+
 	size_t index = node - nodes;
 	assert(index < MAX_NODES);
 	#if defined(__SSE2__)
@@ -1341,6 +1587,16 @@ int32_t AStarNodes::getClosedNodes() const
 AStarNode* AStarNodes::getNodeByPosition(uint32_t x, uint32_t y)
 {
 	uint32_t xy = (x << 16) | y;
+	if (useHeap) {
+		const uint32_t mask = hashIndices.size() - 1;
+		for (uint32_t slot = (xy * 2654435761U) & mask; hashIndices[slot] != -1; slot = (slot + 1) & mask) {
+			if (hashKeys[slot] == xy) {
+				return getNode(hashIndices[slot]);
+			}
+		}
+		return nullptr;
+	}
+
 	#if defined(__SSE2__)
 	const __m128i key = _mm_set1_epi32(xy);
 
@@ -1384,6 +1640,99 @@ AStarNode* AStarNodes::getNodeByPosition(uint32_t x, uint32_t y)
 	#endif
 }
 
+AStarNode* AStarNodes::getNode(int32_t index)
+{
+	if (index < MAX_NODES) {
+		return &nodes[index];
+	}
+
+	index -= MAX_NODES;
+	return &extraNodes[index / MAX_NODES][index % MAX_NODES];
+}
+
+int32_t AStarNodes::getNodeIndex(const AStarNode* node) const
+{
+	std::less<const AStarNode*> less;
+	if (!less(node, nodes) && less(node, nodes + MAX_NODES)) {
+		return node - nodes;
+	}
+
+	for (size_t chunk = 0, size = extraNodes.size(); chunk < size; ++chunk) {
+		const AStarNode* chunkNodes = extraNodes[chunk].get();
+		if (!less(node, chunkNodes) && less(node, chunkNodes + MAX_NODES)) {
+			return MAX_NODES * (chunk + 1) + (node - chunkNodes);
+		}
+	}
+	return -1;
+}
+
+bool AStarNodes::isOpen(int32_t index) const
+{
+	if (index < MAX_NODES) {
+		return openNodes[index];
+	}
+	return extraOpenNodes[index - MAX_NODES];
+}
+
+void AStarNodes::setOpen(int32_t index, bool open)
+{
+	if (index < MAX_NODES) {
+		openNodes[index] = open;
+	} else {
+		extraOpenNodes[index - MAX_NODES] = open;
+	}
+}
+
+void AStarNodes::switchToHeap()
+{
+	useHeap = true;
+
+	hashKeys.assign(MAX_NODES * 2, 0);
+	hashIndices.assign(MAX_NODES * 2, -1);
+	hashSize = 0;
+	openHeap.reserve(curNode * 2);
+	for (int32_t i = 0; i < curNode; ++i) {
+		insertHash(nodesTable[i], i);
+		if (openNodes[i]) {
+			openHeap.push_back(HeapEntry{nodes[i].f + nodes[i].g, i});
+		}
+	}
+	std::make_heap(openHeap.begin(), openHeap.end(), std::greater<HeapEntry>());
+}
+
+void AStarNodes::pushHeap(int32_t index)
+{
+	const AStarNode* node = getNode(index);
+	openHeap.push_back(HeapEntry{node->f + node->g, index});
+	std::push_heap(openHeap.begin(), openHeap.end(), std::greater<HeapEntry>());
+}
+
+void AStarNodes::insertHash(uint32_t xy, int32_t index)
+{
+	//keep the load factor under one half so the probe sequences stay short
+	if ((hashSize + 1) * 2 > static_cast<int32_t>(hashIndices.size())) {
+		std::vector<uint32_t> oldKeys = std::move(hashKeys);
+		std::vector<int32_t> oldIndices = std::move(hashIndices);
+		hashKeys.assign(oldKeys.size() * 2, 0);
+		hashIndices.assign(oldIndices.size() * 2, -1);
+		hashSize = 0;
+		for (size_t i = 0, size = oldIndices.size(); i < size; ++i) {
+			if (oldIndices[i] != -1) {
+				insertHash(oldKeys[i], oldIndices[i]);
+			}
+		}
+	}
+
+	const uint32_t mask = hashIndices.size() - 1;
+	uint32_t slot = (xy * 2654435761U) & mask;
+	while (hashIndices[slot] != -1) {
+		slot = (slot + 1) & mask;
+	}
+	hashKeys[slot] = xy;
+	hashIndices[slot] = index;
+	++hashSize;
+}
+
 inline int_fast32_t AStarNodes::getMapWalkCost(AStarNode* node, const Position& neighborPos)
 {
 	//diagonal movement extra cost
@@ -29,12 +29,14 @@
 #include "town.h"
 #include "house.h"
 #include "spawn.h"
+#include "pathclusters.h"
 
 class Creature;
 class Player;
 class Game;
 class Tile;
 class Map;
+struct StagedTileArea;
 
 static constexpr int32_t MAP_MAX_LAYERS = 16;
 
@@ -46,6 +48,16 @@ struct AStarNode {
 };
 
 static constexpr int32_t MAX_NODES = 512;
+//Nodes a search may create once it has moved to the heap based containers
+static constexpr int32_t MAX_NODES_EXTENDED = MAX_NODES * 8;
+//Node count at which the linear scans are replaced by a binary heap and a position hash
+static constexpr int32_t ASTAR_HEAP_THRESHOLD = 256;
+static_assert(ASTAR_HEAP_THRESHOLD <= MAX_NODES, "The linear containers must switch before they are full");
+
+//Closed nodes allowed when searching a path without the cluster graph
+static constexpr int32_t MAP_MAX_CLOSED_NODES = 100;
+//Routes farther than this go through the cluster graph
+static constexpr int32_t MAP_CLUSTERED_PATH_DISTANCE = 12;
 
 static constexpr int32_t MAP_NORMALWALKCOST = 10;
 static constexpr int32_t MAP_DIAGONALWALKCOST = 25;
@@ -66,6 +78,24 @@ class AStarNodes
 		static inline int_fast32_t getTileWalkCost(const Creature& creature, const Tile* tile);
 
 	private:
+		struct HeapEntry {
+			int_fast32_t cost;
+			int32_t index;
+
+			bool operator>(const HeapEntry& other) const {
+				return cost > other.cost || (cost == other.cost && index > other.index);
+			}
+		};
+
+		AStarNode* getNode(int32_t index);
+		int32_t getNodeIndex(const AStarNode* node) const;
+		bool isOpen(int32_t index) const;
+		void setOpen(int32_t index, bool open);
+
+		void switchToHeap();
+		void pushHeap(int32_t index);
+		void insertHash(uint32_t xy, int32_t index);
+
 		#if defined(__SSE2__)
 		alignas(16) uint32_t nodesTable[MAX_NODES];
 		alignas(64) int32_t calculatedNodes[MAX_NODES];
@@ -77,6 +107,15 @@ class AStarNodes
 		int32_t closedNodes;
 		int32_t curNode;
 		bool openNodes[MAX_NODES];
+
+		//only used after switchToHeap, small searches never allocate
+		std::vector<std::unique_ptr<AStarNode[]>> extraNodes;
+		std::vector<bool> extraOpenNodes;
+		std::vector<HeapEntry> openHeap;
+		std::vector<uint32_t> hashKeys;
+		std::vector<int32_t> hashIndices;
+		int32_t hashSize = 0;
+		bool useHeap = false;
 };
 
 using SpectatorCache = std::map<Position, SpectatorVector>;
@@ -88,6 +127,14 @@ static constexpr int32_t SECTOR_MASK = (SECTOR_SIZE - 1);
 
 class FrozenPathingConditionCall;
 
+//Walkability of one sector floor, shared by every creature with the same walk profile
+struct SectorWalkCache {
+	std::bitset<SECTOR_SIZE * SECTOR_SIZE> known;
+	std::bitset<SECTOR_SIZE * SECTOR_SIZE> walkable;
+	uint8_t z;
+	uint8_t profile;
+};
+
 class MapSector
 {
 	public:
@@ -114,6 +161,7 @@ class MapSector
 		MapSector* sectorE = nullptr;
 		CreatureVector creature_list;
 		CreatureVector player_list;
+		std::vector<SectorWalkCache> walkCaches;
 		Tile* tiles[MAP_MAX_LAYERS][SECTOR_SIZE][SECTOR_SIZE] = {};
 		uint32_t floorBits = 0;
 
@@ -133,6 +181,13 @@ class Map
 		static constexpr int32_t maxViewportX = (CLIENT_MAP_WIDTH_OFFSET + 1); //min value: maxClientViewportX + 1(needs to be at least + 1 from Monster::canSee)
 		static constexpr int32_t maxViewportY = (CLIENT_MAP_HEIGHT_OFFFSET + 1); //min value: maxClientViewportY + 1(needs to be at least + 1 from Monster::canSee)
 
+		Map() = default;
+		~Map();
+
+		// non-copyable
+		Map(const Map&) = delete;
+		Map& operator=(const Map&) = delete;
+
 		uint32_t clean() const;
 
 		/**
@@ -140,6 +195,8 @@ class Map
 		  * \returns true if the map was loaded successfully
 		  */
 		bool loadMap(const std::string& identifier, bool loadHouses);
+		//whether the main map is loaded from its snapshot when that is current
+		static bool isSnapshotEnabled();
 
 		/**
 		  * Save a map.
@@ -154,16 +211,28 @@ class Map
 		MapSector* createMapSector(uint32_t x, uint32_t y);
 
 		/**
-		  * Gets a map sector.
+		  * Gets a map sector, building it first if a lazy map load left it pending.
 		  * \returns A pointer to that map sector.
 		  */
 		MapSector* getMapSector(uint32_t x, uint32_t y);
+		//only what is built already, pending sectors hold no creatures
 		const MapSector* getMapSector(uint32_t x, uint32_t y) const;
 
 		/**
-		  * Get a single tile.
+		  * Builds up to count of the sectors left pending by a lazy map load.
+		  * \returns the number of sectors still pending
+		  */
+		size_t loadPendingSectors(size_t count);
+
+		/**
+		  * Get a single tile, building its sector first if it is pending.
 		  * \returns A pointer to that tile.
 		  */
+		Tile* getTile(uint16_t x, uint16_t y, uint8_t z);
+		Tile* getTile(const Position& pos) {
+			return getTile(pos.x, pos.y, pos.z);
+		}
+		//tiles of pending sectors are not returned
 		Tile* getTile(uint16_t x, uint16_t y, uint8_t z) const;
 		Tile* getTile(const Position& pos) const {
 			return getTile(pos.x, pos.y, pos.z);
@@ -207,7 +276,7 @@ class Map
 		  *	\returns The result if you can throw there or not
 		  */
 		bool canThrowObjectTo(const Position& fromPos, const Position& toPos, bool checkLineOfSight = true,
-		                      int32_t rangex = Map::maxClientViewportX, int32_t rangey = Map::maxClientViewportY) const;
+		                      int32_t rangex = Map::maxClientViewportX, int32_t rangey = Map::maxClientViewportY);
 
 		/**
 		  * Checks if path is clear from fromPos to toPos
@@ -217,27 +286,38 @@ class Map
 		  *	\param floorCheck if true then view is not clear if fromPos.z is not the same as toPos.z
 		  *	\returns The result if there is no obstacles
 		  */
-		bool isSightClear(const Position& fromPos, const Position& toPos, bool floorCheck) const;
-		bool checkSightLine(const Position& fromPos, const Position& toPos) const;
+		bool isSightClear(const Position& fromPos, const Position& toPos, bool floorCheck);
+		bool checkSightLine(const Position& fromPos, const Position& toPos);
 
-		const Tile* canWalkTo(const Creature& creature, const Position& pos) const;
+		const Tile* canWalkTo(const Creature& creature, const Position& pos);
+
+		/**
+		  * Gets the cached walkability of a tile for the given walk profile.
+		  * \returns 1 if the creature can walk there, 0 otherwise
+		  */
+		int32_t getWalkCache(const Creature& creature, uint8_t walkProfile, const Position& pos);
+		void clearWalkCache(const Position& pos);
 
 		bool getPathMatching(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList,
-			const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const;
+			const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp);
 		bool getPathMatchingCond(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList,
-			const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const;
+			const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp);
 
 		std::map<std::string, Position> waypoints;
 
 		Spawns spawns;
 		Towns towns;
 		Houses houses;
+		PathClusters pathClusters;
 
 	private:
 		SpectatorCache spectatorCache;
 		SpectatorCache playersSpectatorCache;
 
 		robin_hood::unordered_map<uint32_t, MapSector> mapSectors;
+		//staged tiles of the sectors nothing has used yet, see IOMap::loadMap
+		robin_hood::unordered_map<uint32_t, std::unique_ptr<StagedTileArea>> pendingSectors;
+		bool pendingSectorsLegacy = false;
 
 		std::string spawnfile;
 		std::string housefile;
@@ -245,14 +325,28 @@ class Map
 		uint32_t width = 0;
 		uint32_t height = 0;
 
+		//looks a sector up without building it if it is pending
+		MapSector* findMapSector(uint32_t x, uint32_t y);
+		const MapSector* findMapSector(uint32_t x, uint32_t y) const;
+		//builds the sector if it is pending, returns false if it was not
+		bool loadPendingSector(uint32_t index);
+
 		// Actually scans the map for spectators
 		void getSpectatorsInternal(SpectatorVector& spectators, const Position& centerPos,
 		                           int32_t minRangeX, int32_t maxRangeX,
 		                           int32_t minRangeY, int32_t maxRangeY,
 		                           int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const;
 
+		bool getPathMatchingFrom(const Creature& creature, const Position& startPos, const Position& targetPos, std::vector<Direction>& dirList,
+			const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp, int32_t maxClosedNodes);
+		// Walks the waypoints found by pathClusters, refining every leg with the regular A* search
+		bool getPathClustered(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList,
+			const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp);
+
 		friend class Game;
 		friend class IOMap;
+		friend class IOMapSnapshot;
+		friend class PathClusters;
 };
 
 #endif
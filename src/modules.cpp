@@ -104,8 +104,7 @@ bool Modules::eventOnRecvByte(Player* player, uint8_t recvbyte, NetworkMessage&
 	lua_State* L = scriptInterface.getLuaState();
 	scriptInterface.pushFunction(it->second);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<NetworkMessage>(L, &msg);
 	LuaScriptInterface::setWeakMetatable(L, -1, "NetworkMessage");
@@ -102,6 +102,27 @@ bool Monster::canWalkOnFieldType(CombatType_t combatType) const
 	}
 }
 
+uint8_t Monster::getWalkProfile() const
+{
+	//everything Tile::queryAdd looks at when a monster is pathfinding
+	uint8_t profile = 0;
+	if (canPushCreatures() && !isSummon()) {
+		profile |= 1 << 0;
+	}
+
+	if (canPushItems()) {
+		profile |= 1 << 1;
+	}
+
+	static constexpr CombatType_t fieldTypes[] = {COMBAT_ENERGYDAMAGE, COMBAT_FIREDAMAGE, COMBAT_EARTHDAMAGE};
+	for (size_t i = 0; i < 3; ++i) {
+		if (ignoreFieldDamage || isImmune(fieldTypes[i]) || canWalkOnFieldType(fieldTypes[i])) {
+			profile |= 1 << (i + 2);
+		}
+	}
+	return profile;
+}
+
 void Monster::onAttackedCreatureDisappear(bool)
 {
 	attackTicks = 0;
@@ -126,8 +147,7 @@ void Monster::onCreatureAppear(Creature* creature, bool isLogin)
 		lua_State* L = scriptInterface->getLuaState();
 		scriptInterface->pushFunction(mType->info.creatureAppearEvent);
 
-		LuaScriptInterface::pushUserdata<Monster>(L, this);
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::pushUserdata<Monster>(L, this, LuaData_Monster);
 
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
 		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -168,8 +188,7 @@ void Monster::onRemoveCreature(Creature* creature, bool isLogout)
 		lua_State* L = scriptInterface->getLuaState();
 		scriptInterface->pushFunction(mType->info.creatureDisappearEvent);
 
-		LuaScriptInterface::pushUserdata<Monster>(L, this);
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::pushUserdata<Monster>(L, this, LuaData_Monster);
 
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
 		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -210,8 +229,7 @@ void Monster::onCreatureMove(Creature* creature, const Tile* newTile, const Posi
 		lua_State* L = scriptInterface->getLuaState();
 		scriptInterface->pushFunction(mType->info.creatureMoveEvent);
 
-		LuaScriptInterface::pushUserdata<Monster>(L, this);
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::pushUserdata<Monster>(L, this, LuaData_Monster);
 
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
 		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -292,8 +310,7 @@ void Monster::onCreatureSay(Creature* creature, SpeakClasses type, const std::st
 		lua_State* L = scriptInterface->getLuaState();
 		scriptInterface->pushFunction(mType->info.creatureSayEvent);
 
-		LuaScriptInterface::pushUserdata<Monster>(L, this);
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::pushUserdata<Monster>(L, this, LuaData_Monster);
 
 		LuaScriptInterface::pushUserdata<Creature>(L, creature);
 		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
@@ -637,7 +654,7 @@ bool Monster::selectTarget(Creature* creature)
 
 	if (isHostile() || isSummon()) {
 		if (setAttackedCreature(creature) && !isSummon()) {
-			g_dispatcher().addTask(std::bind(&Game::checkCreatureAttack, &g_game(), getID()));
+			g_dispatcher().addTask(std::bind(&Game::checkCreatureAttack, &g_game(), getHandle()));
 		}
 	}
 	return setFollowCreature(creature);
@@ -711,8 +728,7 @@ void Monster::onThink(uint32_t interval)
 		lua_State* L = scriptInterface->getLuaState();
 		scriptInterface->pushFunction(mType->info.thinkEvent);
 
-		LuaScriptInterface::pushUserdata<Monster>(L, this);
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::pushUserdata<Monster>(L, this, LuaData_Monster);
 
 		lua_pushnumber(L, interval);
 
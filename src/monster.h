@@ -271,6 +271,7 @@ class Monster final : public Creature
 		bool useCacheMap() const override {
 			return !randomStepping;
 		}
+		uint8_t getWalkProfile() const override;
 
 		friend class LuaScriptInterface;
 };
@@ -88,15 +88,36 @@ bool Monsters::loadFromXml(bool reloading /*= false*/)
 
 	loaded = true;
 
+	std::vector<pugi::xml_node> monsterNodes;
+	std::vector<std::string> files;
 	for (auto monsterNode : doc.child("monsters").children()) {
-		std::string name = asLowerCaseString(monsterNode.attribute("name").as_string());
-		std::string file = "data/monster/" + std::string(monsterNode.attribute("file").as_string());
-		loadMonster(file, name, reloading);
-
-		pugi::xml_attribute attrRaceId = monsterNode.attribute("raceid");
-		if (attrRaceId) {
-			uint16_t raceId = pugi::cast<uint16_t>(attrRaceId.value());
-			monsterRaces[raceId][pugi::cast<uint16_t>(monsterNode.attribute("id").value())] = monsterNode.attribute("name").as_string();
+		monsterNodes.push_back(monsterNode);
+		files.push_back("data/monster/" + std::string(monsterNode.attribute("file").as_string()));
+	}
+
+	//the files are parsed in parallel batches, building the monster types stays serial
+	//as it creates spells, conditions and loads scripts
+	std::vector<pugi::xml_document> monsterDocs(std::min<size_t>(MONSTERS_PARSED_FILES, monsterNodes.size()));
+	std::vector<pugi::xml_parse_result> results(monsterDocs.size());
+	for (size_t first = 0; first < monsterNodes.size(); first += MONSTERS_PARSED_FILES) {
+		int32_t batchSize = static_cast<int32_t>(std::min<size_t>(MONSTERS_PARSED_FILES, monsterNodes.size() - first));
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int32_t i = 0; i < batchSize; ++i) {
+			monsterDocs[i].reset();
+			results[i] = monsterDocs[i].load_file(files[first + i].c_str());
+		}
+
+		for (int32_t i = 0; i < batchSize; ++i) {
+			const pugi::xml_node& monsterNode = monsterNodes[first + i];
+			std::string name = asLowerCaseString(monsterNode.attribute("name").as_string());
+			loadMonster(monsterDocs[i], results[i], files[first + i], name, reloading);
+
+			pugi::xml_attribute attrRaceId = monsterNode.attribute("raceid");
+			if (attrRaceId) {
+				uint16_t raceId = pugi::cast<uint16_t>(attrRaceId.value());
+				monsterRaces[raceId][pugi::cast<uint16_t>(monsterNode.attribute("id").value())] = monsterNode.attribute("name").as_string();
+			}
 		}
 	}
 	return true;
@@ -781,12 +802,10 @@ bool Monsters::deserializeSpell(MonsterSpell* spell, spellBlock_t& sb, const std
 	return true;
 }
 
-MonsterType* Monsters::loadMonster(const std::string& file, const std::string& monsterName, bool reloading /*= false*/)
+MonsterType* Monsters::loadMonster(const pugi::xml_document& doc, const pugi::xml_parse_result& result, const std::string& file, const std::string& monsterName, bool reloading /*= false*/)
 {
 	MonsterType* mType = nullptr;
 
-	pugi::xml_document doc;
-	pugi::xml_parse_result result = doc.load_file(file.c_str());
 	if (!result) {
 		printXMLError("Error - Monsters::loadMonster", file, result);
 		return nullptr;
@@ -259,7 +259,7 @@ class Monsters
 		                                    int32_t maxDamage, int32_t minDamage, int32_t startDamage, uint32_t tickInterval);
 		bool deserializeSpell(const pugi::xml_node& node, spellBlock_t& sb, const std::string& description = "");
 
-		MonsterType* loadMonster(const std::string& file, const std::string& monsterName, bool reloading = false);
+		MonsterType* loadMonster(const pugi::xml_document& doc, const pugi::xml_parse_result& result, const std::string& file, const std::string& monsterName, bool reloading = false);
 
 		void loadLootContainer(const pugi::xml_node& node, LootBlock&);
 		bool loadLootItem(const pugi::xml_node& node, LootBlock&);
@@ -272,6 +272,9 @@ class Monsters
 		bool loaded = false;
 };
 
+//Monster files parsed in parallel before their types are built
+static constexpr size_t MONSTERS_PARSED_FILES = 256;
+
 constexpr auto g_monsters = &Monsters::getInstance;
 
 #endif
@@ -333,7 +333,7 @@ MoveEvent* MoveEvents::getEvent(const Tile* tile, MoveEvent_t eventType)
 	return nullptr;
 }
 
-uint32_t MoveEvents::onCreatureMove(Creature* creature, const Tile* tile, MoveEvent_t eventType)
+uint32_t MoveEvents::onCreatureMove(Creature* creature, Tile* tile, MoveEvent_t eventType)
 {
 	const Position& pos = tile->getPosition();
 
@@ -357,6 +357,9 @@ uint32_t MoveEvents::onCreatureMove(Creature* creature, const Tile* tile, MoveEv
 
 		moveEvent = getEvent(tileItem, eventType);
 		if (moveEvent) {
+			if (tileItem->isShared()) {
+				tileItem = tile->unshareGround();
+			}
 			ret &= moveEvent->fireStepEvent(creature, tileItem, pos);
 		}
 	}
@@ -416,6 +419,9 @@ uint32_t MoveEvents::onItemMove(Item* item, Tile* tile, bool isAdd)
 
 		moveEvent = getEvent(tileItem, eventType2);
 		if (moveEvent) {
+			if (tileItem->isShared()) {
+				tileItem = tile->unshareGround();
+			}
 			ret &= moveEvent->fireAddRemItem(item, tileItem, tile->getPosition());
 		}
 	}
@@ -896,8 +902,7 @@ bool MoveEvent::executeEquip(Player* player, Item* item, slots_t slot, bool isCh
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(scriptId);
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 	LuaScriptInterface::pushThing(L, item);
 	lua_pushnumber(L, slot);
 	LuaScriptInterface::pushBoolean(L, isCheck);
@@ -21,6 +21,7 @@
 
 #include "npc.h"
 #include "game.h"
+#include "luabytecodecache.h"
 #include "pugicast.h"
 
 extern LuaEnvironment g_luaEnvironment;
@@ -105,7 +106,7 @@ bool Npc::load()
 void Npc::reset()
 {
 	loaded = false;
-	isIdle = true;
+	isIdle = spectators.empty();
 	walkTicks = 1500;
 	pushable = true;
 	floorChange = false;
@@ -344,7 +345,8 @@ void Npc::onThink(uint32_t interval)
 {
 	Creature::onThink(interval);
 
-	if (npcEventHandler) {
+	//with nobody in range and no one to let go of, the script has nothing to react to
+	if (npcEventHandler && (!isIdle || focusCreature != 0)) {
 		npcEventHandler->onThink();
 	}
 
@@ -584,12 +586,26 @@ bool NpcScriptInterface::initState()
 	lua_newtable(luaState);
 	eventTableRef = luaL_ref(luaState, LUA_REGISTRYINDEX);
 	runningEventId = EVENT_ID_USER;
+
+	lua_newtable(luaState);
+#if LUA_VERSION_NUM >= 502
+	lua_pushglobaltable(luaState);
+#else
+	lua_pushvalue(luaState, LUA_GLOBALSINDEX);
+#endif
+	lua_setfield(luaState, -2, "__index");
+	environmentMetatableRef = luaL_ref(luaState, LUA_REGISTRYINDEX);
 	return true;
 }
 
 bool NpcScriptInterface::closeState()
 {
 	libLoaded = false;
+	compiledScripts.clear();
+	if (luaState && environmentMetatableRef != -1) {
+		luaL_unref(luaState, LUA_REGISTRYINDEX, environmentMetatableRef);
+		environmentMetatableRef = -1;
+	}
 	LuaScriptInterface::closeState();
 	return true;
 }
@@ -609,6 +625,88 @@ bool NpcScriptInterface::loadNpcLib(const std::string& file)
 	return true;
 }
 
+int32_t NpcScriptInterface::loadNpcScript(const std::string& file, Npc* npc)
+{
+	auto it = compiledScripts.find(file);
+	if (it == compiledScripts.end()) {
+		if (!g_luaBytecodeCache().load(luaState, file) && luaL_loadfile(luaState, file.c_str()) != 0) {
+			lastLuaError = popString(luaState);
+			return -1;
+		}
+
+		std::string bytecode;
+		if (!dumpFunction(luaState, bytecode)) {
+			lua_pop(luaState, 1);
+			lastLuaError = "Unable to compile " + file;
+			return -1;
+		}
+		compiledScripts.emplace(file, std::move(bytecode));
+	} else if (luaL_loadbuffer(luaState, it->second.data(), it->second.size(), ("@" + file).c_str()) != 0) {
+		lastLuaError = popString(luaState);
+		return -1;
+	}
+
+	loadingFile = file;
+
+	lua_newtable(luaState);
+	lua_rawgeti(luaState, LUA_REGISTRYINDEX, environmentMetatableRef);
+	lua_setmetatable(luaState, -2);
+	lua_pushvalue(luaState, -1);
+	int32_t environment = luaL_ref(luaState, LUA_REGISTRYINDEX);
+#if LUA_VERSION_NUM >= 502
+	//_ENV is the first upvalue of a main chunk
+	if (!lua_setupvalue(luaState, -2, 1)) {
+		lua_pop(luaState, 1);
+	}
+#else
+	lua_setfenv(luaState, -2);
+#endif
+
+	if (!reserveScriptEnv()) {
+		lua_pop(luaState, 1);
+		releaseNpcEnvironment(environment);
+		return -1;
+	}
+
+	ScriptEnvironment* env = getScriptEnv();
+	env->setScriptId(EVENT_ID_LOADING, this);
+	env->setNpc(npc);
+
+	if (protectedCall(luaState, 0, 0) != 0) {
+		reportError(nullptr, popString(luaState));
+		resetScriptEnv();
+		releaseNpcEnvironment(environment);
+		return -1;
+	}
+
+	resetScriptEnv();
+	return environment;
+}
+
+int32_t NpcScriptInterface::getNpcEvent(int32_t environment, const std::string& eventName)
+{
+	//raw access, a global function of the same name does not count
+	lua_rawgeti(luaState, LUA_REGISTRYINDEX, environment);
+	pushString(luaState, eventName);
+	lua_rawget(luaState, -2);
+	lua_remove(luaState, -2);
+	if (!isFunction(luaState, -1)) {
+		lua_pop(luaState, 1);
+		return -1;
+	}
+
+	int32_t eventId = getEvent();
+	if (eventId != -1) {
+		cacheFiles[eventId] = loadingFile + ":" + eventName;
+	}
+	return eventId;
+}
+
+void NpcScriptInterface::releaseNpcEnvironment(int32_t environment)
+{
+	luaL_unref(luaState, LUA_REGISTRYINDEX, environment);
+}
+
 void NpcScriptInterface::registerFunctions()
 {
 	//npc exclusive functions
@@ -1117,18 +1215,21 @@ int NpcScriptInterface::luaNpcCloseShopWindow(lua_State* L)
 NpcEventsHandler::NpcEventsHandler(const std::string& file, Npc* npc) :
 	npc(npc), scriptInterface(npc->getScriptInterface())
 {
-	loaded = scriptInterface->loadFile("data/npc/scripts/" + file, npc) == 0;
+	int32_t environment = scriptInterface->loadNpcScript("data/npc/scripts/" + file, npc);
+	loaded = environment != -1;
 	if (!loaded) {
 		std::cout << "[Warning - NpcScript::NpcScript] Can not load script: " << file << std::endl;
 		std::cout << scriptInterface->getLastLuaError() << std::endl;
 	} else {
-		creatureSayEvent = scriptInterface->getEvent("onCreatureSay");
-		creatureDisappearEvent = scriptInterface->getEvent("onCreatureDisappear");
-		creatureAppearEvent = scriptInterface->getEvent("onCreatureAppear");
-		creatureMoveEvent = scriptInterface->getEvent("onCreatureMove");
-		playerCloseChannelEvent = scriptInterface->getEvent("onPlayerCloseChannel");
-		playerEndTradeEvent = scriptInterface->getEvent("onPlayerEndTrade");
-		thinkEvent = scriptInterface->getEvent("onThink");
+		creatureSayEvent = scriptInterface->getNpcEvent(environment, "onCreatureSay");
+		creatureDisappearEvent = scriptInterface->getNpcEvent(environment, "onCreatureDisappear");
+		creatureAppearEvent = scriptInterface->getNpcEvent(environment, "onCreatureAppear");
+		creatureMoveEvent = scriptInterface->getNpcEvent(environment, "onCreatureMove");
+		playerCloseChannelEvent = scriptInterface->getNpcEvent(environment, "onPlayerCloseChannel");
+		playerEndTradeEvent = scriptInterface->getNpcEvent(environment, "onPlayerEndTrade");
+		thinkEvent = scriptInterface->getNpcEvent(environment, "onThink");
+		//the event functions keep the environment alive
+		scriptInterface->releaseNpcEnvironment(environment);
 	}
 }
 
@@ -1252,8 +1353,7 @@ void NpcEventsHandler::onPlayerTrade(Player* player, int32_t callback, uint16_t
 
 	lua_State* L = scriptInterface->getLuaState();
 	LuaScriptInterface::pushCallback(L, callback);
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 	lua_pushnumber(L, itemId);
 	lua_pushnumber(L, count);
 	lua_pushnumber(L, amount);
@@ -1280,8 +1380,7 @@ void NpcEventsHandler::onPlayerCloseChannel(Player* player)
 
 	lua_State* L = scriptInterface->getLuaState();
 	scriptInterface->pushFunction(playerCloseChannelEvent);
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 	scriptInterface->callFunction(1);
 }
 
@@ -1303,8 +1402,7 @@ void NpcEventsHandler::onPlayerEndTrade(Player* player)
 
 	lua_State* L = scriptInterface->getLuaState();
 	scriptInterface->pushFunction(playerEndTradeEvent);
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 	scriptInterface->callFunction(1);
 }
 
@@ -41,6 +41,16 @@ class NpcScriptInterface final : public LuaScriptInterface
 
 		bool loadNpcLib(const std::string& file);
 
+		/**
+		  * Runs an npc script in an environment table of its own, globals are read through to the shared state.
+		  * Each file is compiled once, further npcs using it only instantiate the compiled chunk.
+		  * \returns registry reference of the environment, -1 if the script could not be run
+		  */
+		int32_t loadNpcScript(const std::string& file, Npc* npc);
+		//takes an event function out of an environment from loadNpcScript
+		int32_t getNpcEvent(int32_t environment, const std::string& eventName);
+		void releaseNpcEnvironment(int32_t environment);
+
 	private:
 		void registerFunctions();
 
@@ -69,6 +79,11 @@ class NpcScriptInterface final : public LuaScriptInterface
 		bool closeState() override;
 
 		bool libLoaded;
+
+		//bytecode of the npc scripts by file name
+		std::unordered_map<std::string, std::string> compiledScripts;
+		//{__index = _G} for the npc environments
+		int32_t environmentMetatableRef = -1;
 };
 
 class NpcEventsHandler
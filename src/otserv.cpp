@@ -33,6 +33,7 @@
 #include "protocolstatus.h"
 #include "databasemanager.h"
 #include "databasetasks.h"
+#include "luaworkers.h"
 #include "scripts.h"
 #include <fstream>
 
@@ -80,10 +81,12 @@ int main(int argc, char* argv[])
 		serviceManager.run();
 	} else {
     spdlog::error("No services running. The server is NOT online.");
+		g_luaWorkers().shutdown();
 		g_databaseTasks().shutdown();
 		g_dispatcher().shutdown();
 	}
 
+	g_luaWorkers().join();
 	g_databaseTasks().join();
 	g_dispatcher().join();
 	g_database().end();
@@ -189,18 +192,29 @@ void mainLoader(int, char*[], ServiceManager* services)
 		return;
 	}
 	g_databaseTasks().start();
+	g_luaWorkers().start(std::max<int32_t>(0, g_config().getNumber(ConfigManager::LUA_WORKER_THREADS)));
 
 	DatabaseManager::updateDatabase();
 	if (g_config().getBoolean(ConfigManager::OPTIMIZE_DATABASE) && !DatabaseManager::optimizeTables()) {
 		spdlog::warn("No tables were optimized.");
 	}
 
+	//time spent by every loader, printed once the server is up
+	std::vector<std::pair<std::string, int64_t>> loaderTimings;
+	int64_t loaderStart = OTSYS_TIME();
+	auto loaderDone = [&](const char* loader) {
+		int64_t now = OTSYS_TIME();
+		loaderTimings.emplace_back(loader, now - loaderStart);
+		loaderStart = now;
+	};
+
 	//load vocations
 	spdlog::info("Loading vocations");
 	if (!g_vocations().loadFromXml()) {
 		startupErrorMessage("Unable to load vocations!");
 		return;
 	}
+	loaderDone("Vocations");
 
 	// load item data
 	spdlog::info("Loading items from OTB");
@@ -208,59 +222,73 @@ void mainLoader(int, char*[], ServiceManager* services)
 		startupErrorMessage("Unable to load items (OTB)!");
 		return;
 	}
+	loaderDone("Items (OTB)");
+
+	//the map tree only depends on the file, read it while the rest of the data is loaded
+	//placed after the items, which are needed to tell whether the map snapshot is used instead
+	g_game().preloadMainMap(g_config().getString(ConfigManager::MAP_NAME));
 
 	spdlog::info("Loading items from XML");
 	if (!Item::items.loadFromXml()) {
 		startupErrorMessage("Unable to load items (XML)!");
 		return;
 	}
+	loaderDone("Items (XML)");
 
 	spdlog::info("Loading global.lua");
 	if (g_luaEnvironment.loadFile("data/global.lua") == -1) {
 		spdlog::warn("Cannot load data/global.lua");
 	}
+	loaderDone("global.lua");
 
 	spdlog::info("Loading lua libs");
 	if (!g_scripts().loadScripts("scripts/lib", true, false)) {
 		startupErrorMessage("Unable to load lua libs!");
 		return;
 	}
+	loaderDone("Lua libs");
 
 	spdlog::info("Loading modules");
 	if (!g_modules().load()) {
 		startupErrorMessage("Failed to load modules");
 		return;
 	}
+	loaderDone("Modules");
 
 	spdlog::info("Loading lua scripts");
 	if (!g_scripts().loadScripts("scripts", false, false)) {
 		startupErrorMessage("Failed to load lua scripts");
 		return;
 	}
+	loaderDone("Lua scripts");
 
 	spdlog::info("Loading monsters");
 	if (!g_monsters().loadFromXml()) {
 		startupErrorMessage("Unable to load monsters!");
 		return;
 	}
+	loaderDone("Monsters");
 
 	spdlog::info("Loading lua monsters scripts");
 	if (!g_scripts().loadScripts("monster", false, false)) {
 		startupErrorMessage("Failed to load lua monsters scripts");
 		return;
 	}
+	loaderDone("Lua monsters");
 
 	spdlog::info("Loading outfits");
 	if (!Outfits::getInstance().loadFromXml()) {
 		startupErrorMessage("Unable to load outfits!");
 		return;
 	}
+	loaderDone("Outfits");
 
 	spdlog::info("Loading events");
 	if (!g_events().load()) {
 		startupErrorMessage("Unable to load events!");
 		return;
 	}
+	loaderDone("Events");
 
 
 	std::string worldType = asLowerCaseString(g_config().getString(ConfigManager::WORLD_TYPE));
@@ -280,12 +308,14 @@ void mainLoader(int, char*[], ServiceManager* services)
 		return;
 	}
 	spdlog::info("World type set as {}!", asUpperCaseString(worldType));
+	loaderStart = OTSYS_TIME();
 
 	spdlog::info("Loading map");
 	if (!g_game().loadMainMap(g_config().getString(ConfigManager::MAP_NAME))) {
 		startupErrorMessage("Failed to load map");
 		return;
 	}
+	loaderDone("Map");
 
 	spdlog::info("Initializing gamestate");
 	g_game().setGameState(GAME_STATE_INIT);
@@ -318,6 +348,11 @@ void mainLoader(int, char*[], ServiceManager* services)
 	IOMarket::getInstance().updateStatistics();
 #endif
 
+	spdlog::info("Startup loader timings:");
+	for (const auto& timing : loaderTimings) {
+		spdlog::info("  {:<16} {:>8} ms", timing.first, timing.second);
+	}
+
 	spdlog::info("Loaded all modules, server starting up...");
 
 #ifndef _WIN32
@@ -0,0 +1,396 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include <bitset>
+#include <queue>
+
+#include "pathclusters.h"
+#include "map.h"
+
+namespace {
+	constexpr int32_t CLUSTER_TILES = SECTOR_SIZE * SECTOR_SIZE;
+
+	//borders with a longer opening get an entrance on each end instead of one in the middle
+	constexpr int32_t CLUSTER_WIDE_ENTRANCE = 6;
+
+	constexpr uint64_t ROUTE_START_NODE = std::numeric_limits<uint64_t>::max();
+	constexpr uint64_t ROUTE_GOAL_NODE = ROUTE_START_NODE - 1;
+
+	using ClusterGrid = std::bitset<CLUSTER_TILES>;
+
+	uint32_t getClusterKey(uint16_t x, uint16_t y, uint8_t z)
+	{
+		return (x / SECTOR_SIZE) | ((y / SECTOR_SIZE) << 12) | (static_cast<uint32_t>(z) << 24);
+	}
+
+	uint32_t getClusterKey(const Position& pos)
+	{
+		return getClusterKey(pos.x, pos.y, pos.z);
+	}
+
+	int32_t getGridIndex(const Position& pos)
+	{
+		return (pos.x & SECTOR_MASK) + (pos.y & SECTOR_MASK) * SECTOR_SIZE;
+	}
+
+	bool isWalkable(Map& map, int32_t x, int32_t y, uint8_t z)
+	{
+		if (x < 0 || y < 0 || x > std::numeric_limits<uint16_t>::max() || y > std::numeric_limits<uint16_t>::max()) {
+			return false;
+		}
+
+		const Tile* tile = map.getTile(x, y, z);
+		return tile && tile->getGround() && !tile->hasFlag(PATHCLUSTER_BLOCKING_FLAGS);
+	}
+
+	void fillClusterGrid(Map& map, uint32_t key, ClusterGrid& grid)
+	{
+		const uint16_t baseX = (key & 0xFFF) * SECTOR_SIZE;
+		const uint16_t baseY = ((key >> 12) & 0xFFF) * SECTOR_SIZE;
+		const uint8_t z = key >> 24;
+
+		grid.reset();
+		for (int32_t y = 0; y < SECTOR_SIZE; ++y) {
+			for (int32_t x = 0; x < SECTOR_SIZE; ++x) {
+				if (isWalkable(map, baseX + x, baseY + y, z)) {
+					grid.set(x + y * SECTOR_SIZE);
+				}
+			}
+		}
+	}
+
+	//Dijkstra over the cluster tiles, the starting tile is always accepted so
+	//targets standing on blocking tiles (counters, depots) can still be reached
+	void getWalkCosts(const ClusterGrid& grid, int32_t from, std::vector<int32_t>& costs)
+	{
+		using QueueEntry = std::pair<int32_t, int32_t>;
+		std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+		costs.assign(CLUSTER_TILES, -1);
+		costs[from] = 0;
+		queue.emplace(0, from);
+		while (!queue.empty()) {
+			const QueueEntry entry = queue.top();
+			queue.pop();
+			if (entry.first > costs[entry.second]) {
+				continue;
+			}
+
+			const int32_t x = entry.second % SECTOR_SIZE;
+			const int32_t y = entry.second / SECTOR_SIZE;
+			for (int32_t dy = -1; dy <= 1; ++dy) {
+				for (int32_t dx = -1; dx <= 1; ++dx) {
+					const int32_t nx = x + dx;
+					const int32_t ny = y + dy;
+					if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= SECTOR_SIZE || ny >= SECTOR_SIZE) {
+						continue;
+					}
+
+					const int32_t index = nx + ny * SECTOR_SIZE;
+					if (!grid.test(index)) {
+						continue;
+					}
+
+					const int32_t cost = entry.first + ((dx != 0 && dy != 0) ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST);
+					if (costs[index] == -1 || cost < costs[index]) {
+						costs[index] = cost;
+						queue.emplace(cost, index);
+					}
+				}
+			}
+		}
+	}
+
+	//Both clusters sharing a border scan it in the same order, so they always agree on the entrance pairs
+	template<typename Entrance>
+	void addBorderEntrances(Map& map, const ClusterGrid& grid, std::vector<Entrance>& entrances, const Position& origin, int32_t stepX, int32_t stepY, int32_t crossX, int32_t crossY)
+	{
+		auto addEntrance = [&](int32_t i) {
+			Entrance entrance;
+			entrance.pos = Position(origin.x + stepX * i, origin.y + stepY * i, origin.z);
+			entrance.partner = Position(entrance.pos.x + crossX, entrance.pos.y + crossY, origin.z);
+			entrances.push_back(entrance);
+		};
+
+		int32_t runStart = -1;
+		for (int32_t i = 0; i <= SECTOR_SIZE; ++i) {
+			bool open = false;
+			if (i < SECTOR_SIZE) {
+				const int32_t x = origin.x + stepX * i;
+				const int32_t y = origin.y + stepY * i;
+				open = grid.test(getGridIndex(Position(x, y, origin.z))) && isWalkable(map, x + crossX, y + crossY, origin.z);
+			}
+
+			if (open) {
+				if (runStart == -1) {
+					runStart = i;
+				}
+				continue;
+			}
+
+			if (runStart == -1) {
+				continue;
+			}
+
+			const int32_t length = i - runStart;
+			if (length >= CLUSTER_WIDE_ENTRANCE) {
+				addEntrance(runStart);
+				addEntrance(i - 1);
+			} else {
+				addEntrance(runStart + (length - 1) / 2);
+			}
+			runStart = -1;
+		}
+	}
+
+	struct RouteNode {
+		uint64_t parent;
+		int32_t g;
+	};
+
+	struct OpenRouteNode {
+		int32_t f;
+		int32_t g;
+		uint64_t id;
+
+		bool operator>(const OpenRouteNode& other) const {
+			return f > other.f;
+		}
+	};
+
+	int32_t getRouteHeuristic(const Position& pos, const Position& goalPos)
+	{
+		//diagonal steps cost more than two straight ones, so the manhattan distance never overestimates
+		return MAP_NORMALWALKCOST * (Position::getDistanceX(pos, goalPos) + Position::getDistanceY(pos, goalPos));
+	}
+}
+
+void PathClusters::build(Map& map)
+{
+	clusters.clear();
+	onDemand = false;
+	for (const auto& it : map.mapSectors) {
+		const uint16_t x = (it.first & 0xFFFF) * SECTOR_SIZE;
+		const uint16_t y = (it.first >> 16) * SECTOR_SIZE;
+		for (uint8_t z = 0; z < MAP_MAX_LAYERS; ++z) {
+			if (it.second.getFloor(z)) {
+				const uint32_t key = getClusterKey(x, y, z);
+				buildCluster(map, key, clusters[key]);
+			}
+		}
+	}
+}
+
+void PathClusters::invalidate(const Position& pos)
+{
+	if (clusters.empty()) {
+		return;
+	}
+
+	auto markDirty = [this](int32_t x, int32_t y, uint8_t z) {
+		if (x < 0 || y < 0 || x > std::numeric_limits<uint16_t>::max() || y > std::numeric_limits<uint16_t>::max()) {
+			return;
+		}
+
+		auto it = clusters.find(getClusterKey(x, y, z));
+		if (it != clusters.end()) {
+			it->second.dirty = true;
+		}
+	};
+
+	markDirty(pos.x, pos.y, pos.z);
+
+	//the entrances on a border depend on the tiles of both clusters
+	const int32_t localX = pos.x & SECTOR_MASK;
+	const int32_t localY = pos.y & SECTOR_MASK;
+	if (localX == 0) {
+		markDirty(pos.x - 1, pos.y, pos.z);
+	} else if (localX == SECTOR_MASK) {
+		markDirty(pos.x + 1, pos.y, pos.z);
+	}
+
+	if (localY == 0) {
+		markDirty(pos.x, pos.y - 1, pos.z);
+	} else if (localY == SECTOR_MASK) {
+		markDirty(pos.x, pos.y + 1, pos.z);
+	}
+}
+
+PathClusters::Cluster& PathClusters::getCluster(Map& map, uint32_t key)
+{
+	Cluster& cluster = clusters[key];
+	if (cluster.dirty) {
+		buildCluster(map, key, cluster);
+	}
+	return cluster;
+}
+
+void PathClusters::buildCluster(Map& map, uint32_t key, Cluster& cluster)
+{
+	cluster.entrances.clear();
+	cluster.costs.clear();
+	cluster.dirty = false;
+
+	ClusterGrid grid;
+	fillClusterGrid(map, key, grid);
+	if (grid.none()) {
+		return;
+	}
+
+	const uint16_t baseX = (key & 0xFFF) * SECTOR_SIZE;
+	const uint16_t baseY = ((key >> 12) & 0xFFF) * SECTOR_SIZE;
+	const uint8_t z = key >> 24;
+	const int32_t last = SECTOR_SIZE - 1;
+
+	//north, south, west and east borders
+	addBorderEntrances(map, grid, cluster.entrances, Position(baseX, baseY, z), 1, 0, 0, -1);
+	addBorderEntrances(map, grid, cluster.entrances, Position(baseX, baseY + last, z), 1, 0, 0, 1);
+	addBorderEntrances(map, grid, cluster.entrances, Position(baseX, baseY, z), 0, 1, -1, 0);
+	addBorderEntrances(map, grid, cluster.entrances, Position(baseX + last, baseY, z), 0, 1, 1, 0);
+
+	const size_t entrances = cluster.entrances.size();
+	cluster.costs.assign(entrances * entrances, -1);
+
+	std::vector<int32_t> walkCosts;
+	for (size_t i = 0; i < entrances; ++i) {
+		getWalkCosts(grid, getGridIndex(cluster.entrances[i].pos), walkCosts);
+		for (size_t j = 0; j < entrances; ++j) {
+			cluster.costs[i * entrances + j] = walkCosts[getGridIndex(cluster.entrances[j].pos)];
+		}
+	}
+}
+
+bool PathClusters::findRoute(Map& map, const Position& startPos, const Position& goalPos, std::vector<Position>& route)
+{
+	if ((clusters.empty() && !onDemand) || startPos.z != goalPos.z) {
+		return false;
+	}
+
+	const uint32_t startKey = getClusterKey(startPos);
+	const uint32_t goalKey = getClusterKey(goalPos);
+	if (startKey == goalKey) {
+		return false;
+	}
+
+	const Cluster& startCluster = getCluster(map, startKey);
+	const Cluster& goalCluster = getCluster(map, goalKey);
+	if (startCluster.entrances.empty() || goalCluster.entrances.empty()) {
+		return false;
+	}
+
+	ClusterGrid grid;
+	std::vector<int32_t> startCosts;
+	fillClusterGrid(map, startKey, grid);
+	getWalkCosts(grid, getGridIndex(startPos), startCosts);
+
+	std::vector<int32_t> goalCosts;
+	fillClusterGrid(map, goalKey, grid);
+	getWalkCosts(grid, getGridIndex(goalPos), goalCosts);
+
+	robin_hood::unordered_map<uint64_t, RouteNode> nodes;
+	std::priority_queue<OpenRouteNode, std::vector<OpenRouteNode>, std::greater<OpenRouteNode>> openNodes;
+
+	auto getNodePosition = [&](uint64_t id) -> const Position& {
+		if (id == ROUTE_START_NODE) {
+			return startPos;
+		} else if (id == ROUTE_GOAL_NODE) {
+			return goalPos;
+		}
+		return clusters.find(id >> 16)->second.entrances[id & 0xFFFF].pos;
+	};
+
+	auto relax = [&](uint64_t parent, uint64_t id, int32_t g, const Position& pos) {
+		auto it = nodes.find(id);
+		if (it != nodes.end() && it->second.g <= g) {
+			return;
+		}
+
+		nodes[id] = RouteNode{parent, g};
+		openNodes.push(OpenRouteNode{g + getRouteHeuristic(pos, goalPos), g, id});
+	};
+
+	nodes[ROUTE_START_NODE] = RouteNode{ROUTE_START_NODE, 0};
+	openNodes.push(OpenRouteNode{getRouteHeuristic(startPos, goalPos), 0, ROUTE_START_NODE});
+
+	int32_t expanded = 0;
+	while (!openNodes.empty()) {
+		const OpenRouteNode current = openNodes.top();
+		openNodes.pop();
+		if (current.g > nodes[current.id].g) {
+			continue;
+		}
+
+		if (current.id == ROUTE_GOAL_NODE) {
+			const size_t routeStart = route.size();
+			for (uint64_t id = ROUTE_GOAL_NODE; id != ROUTE_START_NODE; id = nodes[id].parent) {
+				route.push_back(getNodePosition(id));
+			}
+			std::reverse(route.begin() + routeStart, route.end());
+			return true;
+		}
+
+		if (++expanded > PATHCLUSTER_MAX_EXPANDED) {
+			return false;
+		}
+
+		if (current.id == ROUTE_START_NODE) {
+			for (size_t i = 0, size = startCluster.entrances.size(); i < size; ++i) {
+				const Position& pos = startCluster.entrances[i].pos;
+				const int32_t cost = startCosts[getGridIndex(pos)];
+				if (cost != -1) {
+					relax(current.id, (static_cast<uint64_t>(startKey) << 16) | i, cost, pos);
+				}
+			}
+			continue;
+		}
+
+		const uint32_t key = current.id >> 16;
+		const size_t index = current.id & 0xFFFF;
+		const Cluster& cluster = clusters.find(key)->second;
+		const Entrance& entrance = cluster.entrances[index];
+
+		const size_t entrances = cluster.entrances.size();
+		for (size_t i = 0; i < entrances; ++i) {
+			const int32_t cost = cluster.costs[index * entrances + i];
+			if (i != index && cost != -1) {
+				relax(current.id, (static_cast<uint64_t>(key) << 16) | i, current.g + cost, cluster.entrances[i].pos);
+			}
+		}
+
+		if (key == goalKey) {
+			const int32_t cost = goalCosts[getGridIndex(entrance.pos)];
+			if (cost != -1) {
+				relax(current.id, ROUTE_GOAL_NODE, current.g + cost, goalPos);
+			}
+		}
+
+		const uint32_t partnerKey = getClusterKey(entrance.partner);
+		const Cluster& partnerCluster = getCluster(map, partnerKey);
+		for (size_t i = 0, size = partnerCluster.entrances.size(); i < size; ++i) {
+			const Entrance& partner = partnerCluster.entrances[i];
+			if (partner.pos == entrance.partner && partner.partner == entrance.pos) {
+				relax(current.id, (static_cast<uint64_t>(partnerKey) << 16) | i, current.g + MAP_NORMALWALKCOST, partner.pos);
+				break;
+			}
+		}
+	}
+	return false;
+}
@@ -0,0 +1,96 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_PATHCLUSTERS_H_763401BAF56D46B5A61D59BEB7ED0B93
+#define FS_PATHCLUSTERS_H_763401BAF56D46B5A61D59BEB7ED0B93
+
+#include "position.h"
+#include "tile.h"
+
+class Map;
+
+//Tile flags that make a tile permanently unwalkable for the abstract graph,
+//anything that can be moved away (parcels, creatures, fields) is left to the local search
+static constexpr uint32_t PATHCLUSTER_BLOCKING_FLAGS = TILESTATE_IMMOVABLEBLOCKSOLID | TILESTATE_IMMOVABLEBLOCKPATH | TILESTATE_FLOORCHANGE | TILESTATE_TELEPORT;
+
+//Upper bound of abstract nodes expanded by a single route query
+static constexpr int32_t PATHCLUSTER_MAX_EXPANDED = 8192;
+
+/**
+  * Hierarchical path finding graph.
+  * Every map sector floor is a cluster, the entrances are the walkable tile pairs
+  * crossing a cluster border and the edges inside a cluster hold the precomputed walk cost
+  * between its entrances. Long routes are searched on this graph and then refined
+  * by the regular A* search between consecutive waypoints.
+  */
+class PathClusters
+{
+	public:
+		/**
+		  * Builds every cluster of the loaded map.
+		  */
+		void build(Map& map);
+
+		/**
+		  * Starts without any cluster, each one is built when a route first goes through it.
+		  */
+		void buildOnDemand() {
+			clusters.clear();
+			onDemand = true;
+		}
+
+		/**
+		  * Marks the cluster holding pos (and its neighbour when pos is on the border) for rebuild.
+		  */
+		void invalidate(const Position& pos);
+
+		/**
+		  * Finds the waypoints of a route between two tiles on the same floor.
+		  * \param route receives the entrances to walk through, the last element is goalPos
+		  * \returns false if both tiles are in the same cluster or no route exists
+		  */
+		bool findRoute(Map& map, const Position& startPos, const Position& goalPos, std::vector<Position>& route);
+
+		void clear() {
+			clusters.clear();
+		}
+
+	private:
+		struct Entrance {
+			Position pos;
+			//tile across the cluster border
+			Position partner;
+		};
+
+		struct Cluster {
+			std::vector<Entrance> entrances;
+			//entrances.size() squared matrix of walk costs, -1 if unreachable
+			std::vector<int32_t> costs;
+			bool dirty = true;
+		};
+
+		Cluster& getCluster(Map& map, uint32_t key);
+		static void buildCluster(Map& map, uint32_t key, Cluster& cluster);
+
+		//node based so references stay valid while neighbour clusters are rebuilt during a search
+		robin_hood::unordered_node_map<uint32_t, Cluster> clusters;
+		bool onDemand = false;
+};
+
+#endif
@@ -3349,7 +3349,7 @@ bool Player::setAttackedCreature(Creature* creature)
 	}
 
 	if (creature) {
-		g_dispatcher().addTask(std::bind(&Game::checkCreatureAttack, &g_game(), getID()));
+		g_dispatcher().addTask(std::bind(&Game::checkCreatureAttack, &g_game(), getHandle()));
 	}
 	return true;
 }
@@ -3406,9 +3406,9 @@ void Player::doAttacking(uint32_t)
 		}
 
 		if (!classicSpeed) {
-			setNextActionTask(std::max<uint32_t>(SERVER_BEAT_MILISECONDS, delay), std::bind(&Game::checkCreatureAttack, &g_game(), getID()));
+			setNextActionTask(std::max<uint32_t>(SERVER_BEAT_MILISECONDS, delay), std::bind(&Game::checkCreatureAttack, &g_game(), getHandle()));
 		} else {
-			g_dispatcher().addEvent(std::max<uint32_t>(SERVER_BEAT_MILISECONDS, delay), std::bind(&Game::checkCreatureAttack, &g_game(), getID()));
+			g_dispatcher().addEvent(std::max<uint32_t>(SERVER_BEAT_MILISECONDS, delay), std::bind(&Game::checkCreatureAttack, &g_game(), getHandle()));
 		}
 
 		if (result) {
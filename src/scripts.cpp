@@ -21,6 +21,7 @@
 
 #include "scripts.h"
 #include "configmanager.h"
+#include "luabytecodecache.h"
 
 #ifdef __cpp_lib_filesystem
 #include <filesystem>
@@ -71,6 +72,14 @@ bool Scripts::loadScripts(std::string folderName, bool isLib, bool reload)
 		}
 	}
 	sort(v.begin(), v.end());
+
+	std::vector<std::string> files;
+	files.reserve(v.size());
+	for (const auto& path : v) {
+		files.push_back(path.string());
+	}
+	g_luaBytecodeCache().prepare(files);
+
 	std::string redir;
 	for (auto it = v.begin(); it != v.end(); ++it) {
 		const std::string scriptFile = it->string();
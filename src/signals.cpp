@@ -36,6 +36,7 @@
 #include "monster.h"
 #include "events.h"
 #include "databasetasks.h"
+#include "luaprofiler.h"
 
 extern LuaEnvironment g_luaEnvironment;
 
@@ -48,6 +49,7 @@ Signals::Signals(boost::asio::io_service& service) :
 	set.add(SIGTERM);
 #ifndef _WIN32
 	set.add(SIGUSR1);
+	set.add(SIGUSR2);
 	set.add(SIGHUP);
 #else
 	// This must be a blocking call as Windows calls it in a new thread and terminates
@@ -90,6 +92,9 @@ void Signals::dispatchSignalHandler(int signal)
 		case SIGUSR1: //Saves game state
 			g_dispatcher().addTask(sigusr1Handler);
 			break;
+		case SIGUSR2: //Starts or stops the Lua profiler
+			g_dispatcher().addTask(sigusr2Handler);
+			break;
 #else
 		case SIGBREAK: //Shuts the server down
 			g_dispatcher().addTask(sigbreakHandler);
@@ -124,6 +129,19 @@ void Signals::sigusr1Handler()
 	g_game().saveGameState();
 }
 
+void Signals::sigusr2Handler()
+{
+	//Dispatcher thread
+	LuaProfiler& profiler = g_luaProfiler();
+	if (profiler.isRunning()) {
+		std::cout << "SIGUSR2 received, stopping the Lua profiler..." << std::endl;
+		profiler.stop(g_luaEnvironment.getLuaState());
+	} else {
+		std::cout << "SIGUSR2 received, starting the Lua profiler..." << std::endl;
+		profiler.start(g_luaEnvironment.getLuaState(), true);
+	}
+}
+
 void Signals::sighupHandler()
 {
 	//Dispatcher thread
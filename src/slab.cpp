@@ -0,0 +1,60 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "slab.h"
+
+SlabAllocator::SlabAllocator(std::string name) : name(std::move(name))
+{
+	getRegistry().push_back(this);
+}
+
+SlabAllocator::~SlabAllocator()
+{
+	auto& registry = getRegistry();
+	registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+
+	for (char* chunk : chunks) {
+		operator delete(chunk);
+	}
+}
+
+std::vector<const SlabAllocator*>& SlabAllocator::getRegistry()
+{
+	//allocators are used by static objects too, so neither they nor this list are ever destroyed
+	static auto* registry = new std::vector<const SlabAllocator*>();
+	return *registry;
+}
+
+void SlabAllocator::refill(size_t sizeClass)
+{
+	const size_t objectSize = (sizeClass + 1) * SLAB_GRANULARITY;
+	char* chunk = static_cast<char*>(operator new(SLAB_CHUNK_SIZE));
+	chunks.push_back(chunk);
+
+	//thread the chunk into the free list back to front so objects are handed out in address order
+	FreeNode* head = freeLists[sizeClass];
+	for (size_t offset = (SLAB_CHUNK_SIZE / objectSize) * objectSize; offset != 0; offset -= objectSize) {
+		FreeNode* node = reinterpret_cast<FreeNode*>(chunk + offset - objectSize);
+		node->next = head;
+		head = node;
+	}
+	freeLists[sizeClass] = head;
+}
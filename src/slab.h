@@ -0,0 +1,117 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2020  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_SLAB_H_5D0C7A4E9B1F4E2A8C3D6F7B0A1E2C3D
+#define FS_SLAB_H_5D0C7A4E9B1F4E2A8C3D6F7B0A1E2C3D
+
+static constexpr size_t SLAB_GRANULARITY = 16;
+static constexpr size_t SLAB_SIZE_CLASSES = 16; //objects up to 256 bytes, bigger ones go to operator new
+static constexpr size_t SLAB_CHUNK_SIZE = 64 * 1024;
+
+/*
+ * Pooling allocator for the objects the dispatcher creates and destroys all the time (items, tiles, attributes).
+ * Unlike LockfreePoolingAllocator it is not thread safe and serves every object size of a class hierarchy:
+ * requests are rounded up to size classes of SLAB_GRANULARITY bytes and carved from SLAB_CHUNK_SIZE slabs.
+ * Slabs are never handed back, freed objects are reused by the next allocation of the same size class,
+ * which keeps them out of the general heap and stops it from fragmenting over a long uptime.
+ */
+class SlabAllocator
+{
+	public:
+		explicit SlabAllocator(std::string name);
+		~SlabAllocator();
+
+		// non-copyable
+		SlabAllocator(const SlabAllocator&) = delete;
+		SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+		void* allocate(size_t size) {
+			++allocations;
+
+			size_t sizeClass = getSizeClass(size);
+			if (sizeClass >= SLAB_SIZE_CLASSES) {
+				return operator new(size);
+			}
+
+			FreeNode*& head = freeLists[sizeClass];
+			if (!head) {
+				refill(sizeClass);
+			}
+
+			FreeNode* node = head;
+			head = node->next;
+			return node;
+		}
+
+		void deallocate(void* p, size_t size) {
+			if (!p) {
+				return;
+			}
+
+			++deallocations;
+
+			size_t sizeClass = getSizeClass(size);
+			if (sizeClass >= SLAB_SIZE_CLASSES) {
+				operator delete(p);
+				return;
+			}
+
+			FreeNode* node = static_cast<FreeNode*>(p);
+			node->next = freeLists[sizeClass];
+			freeLists[sizeClass] = node;
+		}
+
+		const std::string& getName() const {
+			return name;
+		}
+		uint64_t getAllocations() const {
+			return allocations;
+		}
+		uint64_t getDeallocations() const {
+			return deallocations;
+		}
+		size_t getReservedBytes() const {
+			return chunks.size() * SLAB_CHUNK_SIZE;
+		}
+
+		static const std::vector<const SlabAllocator*>& getAllocators() {
+			return getRegistry();
+		}
+
+	private:
+		struct FreeNode {
+			FreeNode* next;
+		};
+
+		static constexpr size_t getSizeClass(size_t size) {
+			return (size - 1) / SLAB_GRANULARITY;
+		}
+
+		static std::vector<const SlabAllocator*>& getRegistry();
+
+		void refill(size_t sizeClass);
+
+		std::string name;
+		std::array<FreeNode*, SLAB_SIZE_CLASSES> freeLists = {};
+		uint64_t allocations = 0;
+		uint64_t deallocations = 0;
+		std::vector<char*> chunks;
+};
+
+#endif
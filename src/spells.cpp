@@ -71,6 +71,7 @@ TalkActionResult_t Spells::playerSaySpell(Player* player, std::string& words, co
 
 void Spells::clearMaps(bool fromLua)
 {
+	instantIndexOutdated = true;
 	for (auto instant = instants.begin(); instant != instants.end(); ) {
 		if (fromLua == instant->second->fromLua) {
 			instant = instants.erase(instant);
@@ -123,6 +124,7 @@ bool Spells::registerEvent(Event_ptr event, const pugi::xml_node&)
 
 		std::string words = instant->getWords();
 		auto result = instants.emplace(words, std::move(instptr));
+		instantIndexOutdated = true;
 		if (!result.second) {
 			std::cout << "[Warning - Spells::registerEvent] Duplicate registered instant spell with words: " << words << std::endl;
 		}
@@ -148,6 +150,7 @@ bool Spells::registerInstantLuaEvent(InstantSpell* event)
 	if (instant) {
 		std::string words = instant->getWords();
 		auto result = instants.emplace(words, std::move(instant));
+		instantIndexOutdated = true;
 		if (!result.second) {
 			std::cout << "[Warning - Spells::registerInstantLuaEvent] Duplicate registered instant spell with words: " << words << std::endl;
 		}
@@ -229,24 +232,44 @@ InstantSpell* Spells::getInstantSpell(const std::string& words)
 
 InstantSpell* Spells::getInstantSpellById(uint32_t spellId)
 {
-	for (auto& it : instants) {
-		if (it.second->getId() == spellId) {
-			return it.second.get();
-		}
+	updateInstantIndex();
+
+	auto it = instantsById.find(spellId);
+	if (it != instantsById.end()) {
+		return it->second;
 	}
 	return nullptr;
 }
 
 InstantSpell* Spells::getInstantSpellByName(const std::string& name)
 {
-	for (auto& it : instants) {
-		if (strcasecmp(it.second->getName().c_str(), name.c_str()) == 0) {
-			return it.second.get();
-		}
+	updateInstantIndex();
+
+	auto it = instantsByName.find(asLowerCaseString(name));
+	if (it != instantsByName.end()) {
+		return it->second;
 	}
 	return nullptr;
 }
 
+void Spells::updateInstantIndex()
+{
+	if (!instantIndexOutdated) {
+		return;
+	}
+
+	instantsByName.clear();
+	instantsById.clear();
+	instantsByName.reserve(instants.size());
+	instantsById.reserve(instants.size());
+	for (auto& it : instants) {
+		InstantSpell* instant = it.second.get();
+		instantsByName.emplace(asLowerCaseString(instant->getName()), instant);
+		instantsById.emplace(instant->getId(), instant);
+	}
+	instantIndexOutdated = false;
+}
+
 Position Spells::getCasterPosition(Creature* creature, Direction dir)
 {
 	return getNextPosition(dir, creature->getPosition());
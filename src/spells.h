@@ -79,9 +79,16 @@ class Spells final : public BaseEvents
 		Event_ptr getEvent(const std::string& nodeName) override;
 		bool registerEvent(Event_ptr event, const pugi::xml_node& node) override;
 
+		void updateInstantIndex();
+
 		std::map<uint16_t, RuneSpell> runes;
 		robin_hood::unordered_map<std::string, InstantSpell_ptr> instants;
 
+		//lower case name and id lookups of the instants, rebuilt on first use after instants changed
+		robin_hood::unordered_map<std::string, InstantSpell*> instantsByName;
+		robin_hood::unordered_map<uint32_t, InstantSpell*> instantsById;
+		bool instantIndexOutdated = true;
+
 		friend class CombatSpell;
 		LuaScriptInterface scriptInterface { "Spell Interface" };
 };
@@ -145,8 +145,7 @@ bool TalkAction::executeSay(Player* player, const std::string& param, SpeakClass
 
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushUserdata<Player>(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushUserdata<Player>(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushString(L, words);
 	LuaScriptInterface::pushString(L, param);
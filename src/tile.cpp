@@ -29,10 +29,31 @@
 #include "movement.h"
 #include "teleport.h"
 #include "trashholder.h"
+#include "slab.h"
 
 StaticTile real_nullptr_tile(0xFFFF, 0xFFFF, 0xFF);
 Tile& Tile::nullptr_tile = real_nullptr_tile;
 
+namespace {
+
+SlabAllocator& getTileAllocator()
+{
+	static auto* allocator = new SlabAllocator("Tile");
+	return *allocator;
+}
+
+}
+
+void* Tile::operator new(size_t size)
+{
+	return getTileAllocator().allocate(size);
+}
+
+void Tile::operator delete(void* p, size_t size)
+{
+	getTileAllocator().deallocate(p, size);
+}
+
 bool Tile::hasProperty(ITEMPROPERTY prop) const
 {
 	if (ground && ground->hasProperty(prop)) {
@@ -378,6 +399,7 @@ void Tile::onAddTileItem(Item* item)
 	#endif
 
 	setTileFlags(item);
+	onItemsChanged();
 
 	const Position& cylinderMapPos = getPosition();
 
@@ -390,11 +412,6 @@ void Tile::onAddTileItem(Item* item)
 			tmpPlayer->sendAddTileItem(this, cylinderMapPos, item);
 		}
 	}
-
-	//event methods
-	for (Creature* spectator : spectators) {
-		spectator->onAddTileItem(this, cylinderMapPos);
-	}
 }
 
 void Tile::onUpdateTileItem(Item* oldItem, const ItemType& oldType, Item* newItem, const ItemType& newType)
@@ -419,6 +436,8 @@ void Tile::onUpdateTileItem(Item* oldItem, const ItemType& oldType, Item* newIte
 	}
 	#endif
 
+	onItemsChanged();
+
 	const Position& cylinderMapPos = getPosition();
 
 	SpectatorVector spectators;
@@ -449,6 +468,7 @@ void Tile::onRemoveTileItem(const SpectatorVector& spectators, const std::vector
 	#endif
 
 	resetTileFlags(item);
+	onItemsChanged();
 
 	const Position& cylinderMapPos = getPosition();
 	const ItemType& iType = Item::items[item->getID()];
@@ -828,6 +848,7 @@ void Tile::addThing(int32_t, Thing* thing)
 	Creature* creature = thing->getCreature();
 	if (creature) {
 		g_game().map.clearSpectatorCache(creature->getPlayer());
+		g_game().map.clearWalkCache(tilePos);
 		creature->setParent(this);
 		CreatureVector* creatures = makeCreatures();
 		creatures->insert(creatures->begin(), creature);
@@ -850,6 +871,8 @@ void Tile::addThing(int32_t, Thing* thing)
 				ground = item;
 				onAddTileItem(item);
 			} else {
+				//the old ground is released and passed to the remove notifications below
+				unshareGround();
 				const ItemType& oldType = Item::items[ground->getID()];
 
 				Item* oldGround = ground;
@@ -1030,6 +1053,7 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 			auto it = std::find(creatures->begin(), creatures->end(), thing);
 			if (it != creatures->end()) {
 				g_game().map.clearSpectatorCache(creature->getPlayer());
+				g_game().map.clearWalkCache(tilePos);
 				creatures->erase(it);
 			}
 		}
@@ -1360,6 +1384,8 @@ void Tile::postAddNotification(Thing* thing, const Cylinder* oldParent, int32_t
 		item = thing->getItem();
 		if (item) {
 			item->incrementReferenceCounter();
+			//items added to containers on this tile are only announced here
+			onItemsChanged();
 		}
 	}
 
@@ -1417,6 +1443,7 @@ void Tile::postRemoveNotification(Thing* thing, const Cylinder* newParent, int32
 	} else {
 		Item* item = thing->getItem();
 		if (item) {
+			onItemsChanged();
 			g_moveEvents().onItemMove(item, this, false);
 		}
 	}
@@ -1434,6 +1461,7 @@ void Tile::internalAddThing(uint32_t, Thing* thing)
 	Creature* creature = thing->getCreature();
 	if (creature) {
 		g_game().map.clearSpectatorCache(creature->getPlayer());
+		g_game().map.clearWalkCache(tilePos);
 		CreatureVector* creatures = makeCreatures();
 		creatures->insert(creatures->begin(), creature);
 	} else {
@@ -1480,8 +1508,9 @@ void Tile::internalAddThing(uint32_t, Thing* thing)
 
 void Tile::setTileFlags(const Item* item)
 {
+	const uint32_t oldFlags = flags;
+	const ItemType& it = Item::items[item->getID()];
 	if (!hasFlag(TILESTATE_FLOORCHANGE)) {
-		const ItemType& it = Item::items[item->getID()];
 		if (it.floorChange != 0) {
 			setFlag(it.floorChange);
 		}
@@ -1539,10 +1568,16 @@ void Tile::setTileFlags(const Item* item)
 	if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
 		setFlag(TILESTATE_SUPPORTS_HANGABLE);
 	}
+
+	if (it.isGroundTile() || ((oldFlags ^ flags) & PATHCLUSTER_BLOCKING_FLAGS) != 0) {
+		g_game().map.pathClusters.invalidate(tilePos);
+	}
+	g_game().map.clearWalkCache(tilePos);
 }
 
 void Tile::resetTileFlags(const Item* item)
 {
+	const uint32_t oldFlags = flags;
 	const ItemType& it = Item::items[item->getID()];
 	if (it.floorChange != 0) {
 		resetFlag(TILESTATE_FLOORCHANGE);
@@ -1680,6 +1715,11 @@ void Tile::resetTileFlags(const Item* item)
 	if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
 		resetFlag(TILESTATE_SUPPORTS_HANGABLE);
 	}
+
+	if (it.isGroundTile() || ((oldFlags ^ flags) & PATHCLUSTER_BLOCKING_FLAGS) != 0) {
+		g_game().map.pathClusters.invalidate(tilePos);
+	}
+	g_game().map.clearWalkCache(tilePos);
 }
 
 bool Tile::isMoveableBlocking() const
@@ -1687,11 +1727,11 @@ bool Tile::isMoveableBlocking() const
 	return !ground || hasFlag(TILESTATE_BLOCKSOLID);
 }
 
-Item* Tile::getUseItem(int32_t index) const
+Item* Tile::getUseItem(int32_t index)
 {
 	const TileItemVector* items = getItemList();
 	if (!items || items->size() == 0) {
-		return ground;
+		return unshareGround();
 	}
 
 	#if CLIENT_VERSION >= 1230
@@ -1699,7 +1739,7 @@ Item* Tile::getUseItem(int32_t index) const
 	// Cipsoft probably omits creatures in stackpos for some micro-optimizations to avoid unnecessary cache-misses
 	if (ground) {
 		if (index == 0) {
-			return ground;
+			return unshareGround();
 		}
 
 		--index;
@@ -1715,9 +1755,22 @@ Item* Tile::getUseItem(int32_t index) const
 	}
 	#else
 	if (Thing* thing = getThing(index)) {
+		if (thing == ground) {
+			return unshareGround();
+		}
 		return thing->getItem();
 	}
 	#endif
 
 	return nullptr;
 }
+
+Item* Tile::unshareGround()
+{
+	if (ground && ground->isShared()) {
+		Item* item = ground->clone();
+		item->setParent(this);
+		ground = item;
+	}
+	return ground;
+}
@@ -203,9 +203,15 @@ class Tile : public Cylinder
 		static Tile& nullptr_tile;
 		Tile(uint16_t x, uint16_t y, uint8_t z) : tilePos(x, y, z) {}
 		virtual ~Tile() {
-			delete ground;
+			if (ground && !ground->isShared()) {
+				delete ground;
+			}
 		};
 
+		//every tile class is served by one slab allocator, see slab.h
+		static void* operator new(size_t size);
+		static void operator delete(void* p, size_t size);
+
 		// non-copyable
 		Tile(const Tile&) = delete;
 		Tile& operator=(const Tile&) = delete;
@@ -238,6 +244,7 @@ class Tile : public Cylinder
 		Item* getTopTopItem() const;
 		Item* getTopDownItem() const;
 		bool isMoveableBlocking() const;
+		//may return the shared ground, it is only meant for reading, use unshareGround before handing it to scripts
 		Thing* getTopVisibleThing(const Creature* creature);
 		Item* getItemByTopOrder(int32_t topOrder);
 
@@ -325,15 +332,24 @@ class Tile : public Cylinder
 			return false;
 		}
 
-		Item* getUseItem(int32_t index) const;
+		Item* getUseItem(int32_t index);
 
+		//the ground may be shared with other tiles, use unshareGround before handing it to anything that keeps or changes it
 		Item* getGround() const {
 			return ground;
 		}
+		/**
+		  * Replaces a shared ground with a copy owned by this tile.
+		  * \returns the ground of this tile
+		  */
+		Item* unshareGround();
 		void setGround(Item* item) {
 			ground = item;
 		}
 
+		//called when an item on this tile or inside one of its containers was added, changed or removed
+		virtual void onItemsChanged() {}
+
 	private:
 		void onAddTileItem(Item* item);
 		void onUpdateTileItem(Item* oldItem, const ItemType& oldType, Item* newItem, const ItemType& newType);
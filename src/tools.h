@@ -30,6 +30,8 @@ void printXMLError(const std::string& where, const std::string& fileName, const
 
 std::string transformToSHA1(const std::string& input);
 std::string generateToken(const std::string& key, uint32_t ticks);
+//64 bit FNV-1a, for telling cached copies of files apart
+uint64_t hashBytes(const char* data, size_t size);
 
 void replaceString(std::string& str, const std::string& sought, const std::string& replacement);
 void trim_right(std::string& source, char t);
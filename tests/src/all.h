@@ -20,6 +20,7 @@
 #include "../../src/container.h"
 #include "../../src/creature.h"
 #include "../../src/creatureevent.h"
+#include "../../src/creaturehandles.h"
 #include "../../src/cylinder.h"
 #include "../../src/database.h"
 #include "../../src/databasemanager.h"
@@ -68,6 +69,7 @@
 #include "../../src/scripts.h"
 #include "../../src/server.h"
 #include "../../src/signals.h"
+#include "../../src/slab.h"
 #include "../../src/spawn.h"
 #include "../../src/spells.h"
 #include "../../src/talkaction.h"
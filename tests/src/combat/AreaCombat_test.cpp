@@ -0,0 +1,53 @@
+#include "../all.h"
+
+static bool hasOffset(const std::vector<AreaOffset>& offsets, int16_t x, int16_t y) {
+  return std::any_of(offsets.begin(), offsets.end(), [x, y](const AreaOffset& offset) {
+    return offset.x == x && offset.y == y;
+  });
+}
+
+TEST_SUITE( "CombatTest - AreaCombat" ) {
+	TEST_CASE("Beam offsets are compiled for every straight direction") {
+    AreaCombat area;
+    area.setupArea(3, 0);
+
+    const auto& north = area.getOffsets(DIRECTION_NORTH);
+    REQUIRE(north.size() == 3);
+    CHECK(north[0].x == 0);
+    CHECK(north[0].y == -2);
+    CHECK(north[2].y == 0);
+
+    const auto& south = area.getOffsets(DIRECTION_SOUTH);
+    REQUIRE(south.size() == 3);
+    CHECK(south[0].y == 0);
+    CHECK(south[2].y == 2);
+
+    CHECK(hasOffset(area.getOffsets(DIRECTION_EAST), 2, 0));
+    CHECK(hasOffset(area.getOffsets(DIRECTION_WEST), -2, 0));
+    CHECK(area.getOffsets(DIRECTION_NORTHEAST).empty());
+  }
+
+	TEST_CASE("Ring offsets keep the matrix row order") {
+    AreaCombat area;
+    area.setupArea(3);
+
+    const auto& offsets = area.getOffsets(DIRECTION_NORTH);
+    REQUIRE(offsets.size() == 9);
+    CHECK(hasOffset(offsets, 0, 0));
+    CHECK(hasOffset(offsets, -1, -1));
+    CHECK(hasOffset(offsets, 1, 1));
+    CHECK_FALSE(hasOffset(offsets, 2, 0));
+
+    for (size_t i = 1; i < offsets.size(); ++i) {
+      CHECK((offsets[i - 1].y < offsets[i].y || (offsets[i - 1].y == offsets[i].y && offsets[i - 1].x < offsets[i].x)));
+    }
+  }
+
+	TEST_CASE("Copied areas keep their compiled offsets") {
+    AreaCombat area;
+    area.setupArea(3, 1);
+
+    AreaCombat copy(area);
+    CHECK(copy.getOffsets(DIRECTION_WEST).size() == area.getOffsets(DIRECTION_WEST).size());
+  }
+}
@@ -0,0 +1,58 @@
+#include "../all.h"
+
+TEST_SUITE( "CreatureTest - CreatureHandleTable" ) {
+	TEST_CASE("Handles resolve until the creature is removed") {
+    CreatureHandleTable table;
+    Creature* first = reinterpret_cast<Creature*>(0x1000);
+    Creature* second = reinterpret_cast<Creature*>(0x2000);
+
+    CreatureHandle firstHandle = table.add(first);
+    CreatureHandle secondHandle = table.add(second);
+    CHECK(CreatureHandleTable::isHandle(firstHandle));
+    CHECK(table.get(firstHandle) == first);
+    CHECK(table.get(secondHandle) == second);
+    CHECK(table.size() == 2);
+
+    table.remove(firstHandle);
+    CHECK(table.get(firstHandle) == nullptr);
+    CHECK(table.get(secondHandle) == second);
+    CHECK(table.size() == 1);
+
+    //removing twice does not touch the slot again
+    table.remove(firstHandle);
+    CHECK(table.size() == 1);
+  }
+
+	TEST_CASE("Reused slots get a new generation") {
+    CreatureHandleTable table;
+    Creature* first = reinterpret_cast<Creature*>(0x1000);
+    Creature* second = reinterpret_cast<Creature*>(0x2000);
+
+    CreatureHandle oldHandle = table.add(first);
+    table.remove(oldHandle);
+    CreatureHandle newHandle = table.add(second);
+    CHECK(static_cast<uint32_t>(newHandle) == static_cast<uint32_t>(oldHandle));
+    CHECK(newHandle != oldHandle);
+    CHECK(table.get(oldHandle) == nullptr);
+    CHECK(table.get(newHandle) == second);
+  }
+
+	TEST_CASE("Creature ids and unknown handles do not resolve") {
+    CreatureHandleTable table;
+    table.add(reinterpret_cast<Creature*>(0x1000));
+    CHECK_FALSE(CreatureHandleTable::isHandle(0x40000000));
+    CHECK(table.get(0) == nullptr);
+    CHECK(table.get((static_cast<CreatureHandle>(1) << 32) | 5) == nullptr);
+  }
+
+	TEST_CASE("Handles fit in a double") {
+    CreatureHandleTable table;
+    CreatureHandle handle = table.add(reinterpret_cast<Creature*>(0x1000));
+    for (uint32_t i = 0; i < 3; ++i) {
+      table.remove(handle);
+      handle = table.add(reinterpret_cast<Creature*>(0x1000));
+    }
+    CHECK(handle < (static_cast<CreatureHandle>(1) << 53));
+    CHECK(static_cast<CreatureHandle>(static_cast<double>(handle)) == handle);
+  }
+}
@@ -0,0 +1,36 @@
+#include "../all.h"
+
+TEST_SUITE( "EventsTest - parseTrivialMethod" ) {
+	TEST_CASE("Constant returns are trivial") {
+    TrivialMethod method;
+    REQUIRE(Events::parseTrivialMethod("function Creature:onAreaCombat(tile, isAggressive)\n\treturn RETURNVALUE_NOERROR\nend\n", method));
+    CHECK(method.value == "RETURNVALUE_NOERROR");
+    CHECK(method.argument == -1);
+
+    REQUIRE(Events::parseTrivialMethod("function Party:onDisband() return true end -- nothing to do", method));
+    CHECK(method.value == "true");
+  }
+
+	TEST_CASE("Empty bodies are trivial") {
+    TrivialMethod method;
+    REQUIRE(Events::parseTrivialMethod("function Player:onItemMoved(item, count)\nend\n", method));
+    CHECK(method.value.empty());
+  }
+
+	TEST_CASE("Returned parameters are counted after self") {
+    TrivialMethod method;
+    REQUIRE(Events::parseTrivialMethod("function Player:onLoseExperience(exp)\n\treturn exp\nend\n", method));
+    CHECK(method.argument == 1);
+
+    REQUIRE(Events::parseTrivialMethod("function Player.onGainExperience(self, source, exp, rawExp) return exp end", method));
+    CHECK(method.argument == 2);
+  }
+
+	TEST_CASE("Anything else is not trivial") {
+    TrivialMethod method;
+    CHECK_FALSE(Events::parseTrivialMethod("function Player:onTurn(direction)\n\tself:say(\"hi\")\n\treturn true\nend\n", method));
+    CHECK_FALSE(Events::parseTrivialMethod("function Party:onShareExperience(exp)\n\treturn exp * 2\nend\n", method));
+    CHECK_FALSE(Events::parseTrivialMethod("function Player:onLookInShop(itemType, count)\n\treturn true\nend\nprint(1)\n", method));
+    CHECK_FALSE(Events::parseTrivialMethod("function Monster:onDropLoot(corpse)\n\t--[[ disabled\n\tcorpse:remove()\n\t]]\nend\n", method));
+  }
+}
@@ -0,0 +1,107 @@
+#include "../all.h"
+
+namespace {
+
+//the chunks get the monster as vararg, which is also reachable where the VM exposes varargs
+#if LUA_VERSION_NUM >= 502 || defined(LUAJIT_VERSION_NUM)
+constexpr size_t VARARG_USES = 1;
+#else
+constexpr size_t VARARG_USES = 0;
+#endif
+
+void pushMonster(lua_State* L, Monster* monster)
+{
+	LuaScriptInterface::pushUserdata<Monster>(L, monster);
+	lua_createtable(L, 0, 1);
+	lua_pushnumber(L, LuaData_Monster);
+	lua_rawseti(L, -2, 't');
+	lua_setmetatable(L, -2);
+}
+
+//starts a coroutine running chunk with the monster as its argument, the chunk yields once and returns whether it still sees the monster
+lua_State* startThread(lua_State* L, const char* chunk, Monster* monster)
+{
+	lua_State* thread = lua_newthread(L);
+	REQUIRE(luaL_loadstring(thread, chunk) == 0);
+	pushMonster(thread, monster);
+	REQUIRE(LuaScriptInterface::resumeCoroutine(thread, 1) == LUA_YIELD);
+	return thread;
+}
+
+}
+
+TEST_SUITE( "LuaTest - ThreadObjects" ) {
+	TEST_CASE("Creatures removed while the coroutine waits are cleared") {
+    lua_State* L = luaL_newstate();
+    luaL_openlibs(L);
+
+    MonsterType type;
+    Monster* monster = new Monster(&type);
+    monster->incrementReferenceCounter();
+
+    lua_State* thread = startThread(L, "local monster = ... ; coroutine.yield() ; return monster ~= nil", monster);
+
+    LuaThreadObjects objects;
+    LuaScriptInterface::pinThreadObjects(thread, objects);
+    REQUIRE(objects.creatures.size() == 1 + VARARG_USES);
+
+    //the coroutine keeps the monster alive after the game lets go of it
+    monster->setRemoved();
+    monster->decrementReferenceCounter();
+
+    LuaScriptInterface::releaseThreadObjects(thread, objects);
+    CHECK(objects.creatures.empty());
+
+    REQUIRE(LuaScriptInterface::resumeCoroutine(thread, 0) == 0);
+    CHECK_FALSE(lua_toboolean(thread, -1));
+    lua_close(L);
+  }
+
+	TEST_CASE("Creatures that still exist are kept, upvalues included") {
+    lua_State* L = luaL_newstate();
+    luaL_openlibs(L);
+
+    MonsterType type;
+    Monster* monster = new Monster(&type);
+    monster->incrementReferenceCounter();
+
+    lua_State* thread = startThread(L, "local monster = ... ; local function f() coroutine.yield() ; return monster ~= nil end ; local seen = f() ; return seen", monster);
+
+    LuaThreadObjects objects;
+    LuaScriptInterface::pinThreadObjects(thread, objects);
+    //local of the chunk and upvalue of f
+    CHECK(objects.creatures.size() == 2 + VARARG_USES);
+
+    LuaScriptInterface::releaseThreadObjects(thread, objects);
+    REQUIRE(LuaScriptInterface::resumeCoroutine(thread, 0) == 0);
+    CHECK(lua_toboolean(thread, -1));
+
+    monster->decrementReferenceCounter();
+    lua_close(L);
+  }
+
+	TEST_CASE("Creatures kept in tables and closures are cleared when removed") {
+    lua_State* L = luaL_newstate();
+    luaL_openlibs(L);
+
+    MonsterType type;
+    Monster* monster = new Monster(&type);
+    monster->incrementReferenceCounter();
+
+    lua_State* thread = startThread(L, "local t ; do local m = ... ; t = {list = {m}, get = function() return m end} end ; coroutine.yield() ; return t.list[1], t.get()", monster);
+
+    LuaThreadObjects objects;
+    LuaScriptInterface::pinThreadObjects(thread, objects);
+    //the table entry and the upvalue of the closure in it hold the same userdata
+    REQUIRE(objects.creatures.size() == 2 + VARARG_USES);
+
+    monster->setRemoved();
+    monster->decrementReferenceCounter();
+
+    LuaScriptInterface::releaseThreadObjects(thread, objects);
+    REQUIRE(LuaScriptInterface::resumeCoroutine(thread, 0) == 0);
+    CHECK(LuaScriptInterface::getUserdata<Monster>(thread, -2) == nullptr);
+    CHECK(LuaScriptInterface::getUserdata<Monster>(thread, -1) == nullptr);
+    lua_close(L);
+  }
+}
@@ -0,0 +1,60 @@
+#include "../all.h"
+
+static void fillNodes(AStarNodes& nodes, int32_t count) {
+  //the start node costs nothing, close it so the created nodes can be compared
+  AStarNode* start = nodes.getNodeByPosition(1000, 1000);
+  nodes.closeNode(start);
+  for (int32_t i = 1; i < count; ++i) {
+    //costs go down as nodes are added so the newest node is always the best one
+    REQUIRE(nodes.createOpenNode(start, 1000 + (i % 64), 1100 + (i / 64), 100000 - i, 0, 0));
+  }
+}
+
+TEST_SUITE( "MapTest - AStarNodes" ) {
+	TEST_CASE("Best node is kept across the switch to the heap") {
+    AStarNodes nodes(1000, 1000, 0);
+    fillNodes(nodes, ASTAR_HEAP_THRESHOLD - 1);
+
+    AStarNode* best = nodes.getBestNode();
+    REQUIRE(best != nullptr);
+    CHECK(best->f == 100000 - (ASTAR_HEAP_THRESHOLD - 2));
+
+    REQUIRE(nodes.createOpenNode(best, 900, 900, 50, 0, 0));
+    AStarNode* node = nodes.getBestNode();
+    REQUIRE(node != nullptr);
+    CHECK(node->x == 900);
+
+    nodes.closeNode(node);
+    CHECK(nodes.getBestNode() == best);
+    CHECK(nodes.getNodeByPosition(900, 900) == node);
+    CHECK(nodes.getNodeByPosition(1000, 1000) != nullptr);
+    CHECK(nodes.getNodeByPosition(999, 999) == nullptr);
+  }
+
+	TEST_CASE("Searches can grow past MAX_NODES") {
+    AStarNodes nodes(1000, 1000, 0);
+    fillNodes(nodes, MAX_NODES + 100);
+
+    AStarNode* last = nodes.getNodeByPosition(1000 + ((MAX_NODES + 99) % 64), 1100 + ((MAX_NODES + 99) / 64));
+    REQUIRE(last != nullptr);
+    CHECK(last->f == 100000 - (MAX_NODES + 99));
+    CHECK(nodes.getBestNode() == last);
+
+    nodes.closeNode(last);
+    CHECK(nodes.getClosedNodes() == 2);
+    CHECK(nodes.getBestNode() != last);
+  }
+
+	TEST_CASE("Re-opened nodes are ordered by their new cost") {
+    AStarNodes nodes(1000, 1000, 0);
+    fillNodes(nodes, ASTAR_HEAP_THRESHOLD + 10);
+
+    AStarNode* node = nodes.getNodeByPosition(1001, 1100);
+    REQUIRE(node != nullptr);
+    nodes.closeNode(node);
+    node->f = 0;
+    nodes.openNode(node);
+    CHECK(nodes.getClosedNodes() == 1);
+    CHECK(nodes.getBestNode() == node);
+  }
+}
@@ -0,0 +1,97 @@
+#include "../all.h"
+
+static constexpr uint16_t CLUSTER_TEST_BASE = 64 * SECTOR_SIZE;
+static constexpr uint8_t CLUSTER_TEST_FLOOR = 7;
+
+//walkable area of three sectors in a row and one sector high
+static void fillArea(Map& map, uint16_t wallX = 0, uint16_t gapY = 0) {
+  for (uint16_t x = CLUSTER_TEST_BASE; x < CLUSTER_TEST_BASE + 3 * SECTOR_SIZE; ++x) {
+    for (uint16_t y = CLUSTER_TEST_BASE; y < CLUSTER_TEST_BASE + SECTOR_SIZE; ++y) {
+      if (x == wallX && y != gapY) {
+        continue;
+      }
+
+      Tile* tile = new StaticTile(x, y, CLUSTER_TEST_FLOOR);
+      tile->setGround(new Item(100));
+      map.setTile(x, y, CLUSTER_TEST_FLOOR, tile);
+    }
+  }
+}
+
+//every leg must stay inside one cluster or step across a border, otherwise the legs cannot be stitched
+static void checkLegs(Map& map, const Position& startPos, const std::vector<Position>& route) {
+  Position legStart = startPos;
+  for (const Position& pos : route) {
+    CHECK(pos.z == startPos.z);
+    CHECK(map.getTile(pos) != nullptr);
+
+    const bool sameCluster = pos.x / SECTOR_SIZE == legStart.x / SECTOR_SIZE && pos.y / SECTOR_SIZE == legStart.y / SECTOR_SIZE;
+    const bool borderStep = std::max<int32_t>(Position::getDistanceX(pos, legStart), Position::getDistanceY(pos, legStart)) == 1;
+    CHECK((sameCluster || borderStep));
+    legStart = pos;
+  }
+}
+
+TEST_SUITE( "MapTest - PathClusters" ) {
+	TEST_CASE("Route crosses every sector between start and goal") {
+    Map map;
+    fillArea(map);
+
+    PathClusters clusters;
+    clusters.buildOnDemand();
+
+    const Position startPos(CLUSTER_TEST_BASE + 2, CLUSTER_TEST_BASE + 5, CLUSTER_TEST_FLOOR);
+    const Position goalPos(CLUSTER_TEST_BASE + 3 * SECTOR_SIZE - 3, CLUSTER_TEST_BASE + 10, CLUSTER_TEST_FLOOR);
+    std::vector<Position> route;
+    REQUIRE(clusters.findRoute(map, startPos, goalPos, route));
+
+    //at least one entrance pair on each of the two borders, then the goal
+    REQUIRE(route.size() >= 5);
+    CHECK(route.back() == goalPos);
+    checkLegs(map, startPos, route);
+  }
+
+	TEST_CASE("Route is found through the opening of a wall inside a sector") {
+    const uint16_t wallX = CLUSTER_TEST_BASE + SECTOR_SIZE + SECTOR_SIZE / 2;
+    const uint16_t gapY = CLUSTER_TEST_BASE + SECTOR_SIZE - 2;
+
+    Map map;
+    fillArea(map, wallX, gapY);
+
+    PathClusters clusters;
+    clusters.buildOnDemand();
+
+    const Position startPos(CLUSTER_TEST_BASE + 2, CLUSTER_TEST_BASE + 1, CLUSTER_TEST_FLOOR);
+    const Position goalPos(CLUSTER_TEST_BASE + 3 * SECTOR_SIZE - 3, CLUSTER_TEST_BASE + 1, CLUSTER_TEST_FLOOR);
+    std::vector<Position> route;
+    REQUIRE(clusters.findRoute(map, startPos, goalPos, route));
+    CHECK(route.back() == goalPos);
+    checkLegs(map, startPos, route);
+  }
+
+	TEST_CASE("No route through a closed wall") {
+    //the opening is outside of the area, so the wall is closed
+    Map map;
+    fillArea(map, CLUSTER_TEST_BASE + SECTOR_SIZE + SECTOR_SIZE / 2, CLUSTER_TEST_BASE + SECTOR_SIZE);
+
+    PathClusters clusters;
+    clusters.buildOnDemand();
+
+    const Position startPos(CLUSTER_TEST_BASE + 2, CLUSTER_TEST_BASE + 1, CLUSTER_TEST_FLOOR);
+    const Position goalPos(CLUSTER_TEST_BASE + 3 * SECTOR_SIZE - 3, CLUSTER_TEST_BASE + 1, CLUSTER_TEST_FLOOR);
+    std::vector<Position> route;
+    CHECK_FALSE(clusters.findRoute(map, startPos, goalPos, route));
+  }
+
+	TEST_CASE("Tiles in the same sector are left to the regular search") {
+    Map map;
+    fillArea(map);
+
+    PathClusters clusters;
+    clusters.buildOnDemand();
+
+    std::vector<Position> route;
+    CHECK_FALSE(clusters.findRoute(map, Position(CLUSTER_TEST_BASE + 1, CLUSTER_TEST_BASE + 1, CLUSTER_TEST_FLOOR), Position(CLUSTER_TEST_BASE + 14, CLUSTER_TEST_BASE + 14, CLUSTER_TEST_FLOOR), route));
+    CHECK(route.empty());
+  }
+}
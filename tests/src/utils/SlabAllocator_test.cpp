@@ -0,0 +1,42 @@
+#include "../all.h"
+
+TEST_SUITE( "UtilsTest - SlabAllocator" ) {
+	TEST_CASE("Freed objects are reused by their size class") {
+    SlabAllocator allocator("test");
+    void* first = allocator.allocate(40);
+    void* second = allocator.allocate(40);
+    CHECK(first != second);
+    CHECK(allocator.getReservedBytes() == SLAB_CHUNK_SIZE);
+
+    allocator.deallocate(first, 40);
+    //33..48 bytes share a size class
+    CHECK(allocator.allocate(33) == first);
+
+    //a different size class gets its own slab
+    void* large = allocator.allocate(200);
+    CHECK(large != first);
+    CHECK(allocator.getReservedBytes() == 2 * SLAB_CHUNK_SIZE);
+
+    allocator.deallocate(second, 40);
+    allocator.deallocate(first, 33);
+    allocator.deallocate(large, 200);
+    CHECK(allocator.getAllocations() == 4);
+    CHECK(allocator.getDeallocations() == 4);
+  }
+
+	TEST_CASE("Oversized objects bypass the slabs") {
+    SlabAllocator allocator("oversized");
+    size_t size = SLAB_GRANULARITY * SLAB_SIZE_CLASSES + 1;
+    void* p = allocator.allocate(size);
+    REQUIRE(p != nullptr);
+    CHECK(allocator.getReservedBytes() == 0);
+    allocator.deallocate(p, size);
+    CHECK(allocator.getDeallocations() == 1);
+  }
+
+	TEST_CASE("Allocators are listed for the runtime stats") {
+    SlabAllocator allocator("listed");
+    const auto& allocators = SlabAllocator::getAllocators();
+    CHECK(std::find(allocators.begin(), allocators.end(), &allocator) != allocators.end());
+  }
+}